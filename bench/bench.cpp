@@ -0,0 +1,97 @@
+// ==========================================================================
+// Microbenchmark Runner
+//
+// bench.out, built and run by make bench: times the text and geometry
+// pipeline piece by piece with runMicrobenchmarks() from boilerplate.cpp
+// and writes the results as JSON (bench.json by default).
+//
+// Every heap allocation of the program goes through the operator new
+// below, so each benchmark also reports what it allocates.
+//
+// Usage: bench.out [--trials n] [--warmup n] [--filter text] [--json file]
+// ==========================================================================
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "MemoryAccount.h"
+#include "Microbench.h"
+
+using namespace std;
+
+// in boilerplate.cpp, built for this program without its main()
+void runMicrobenchmarks(Microbench *bench, bool gl);
+
+// --------------------------------------------------------------------------
+// Allocation counting
+
+void *operator new(size_t size)
+{
+    microbenchAllocations.fetch_add(1, memory_order_relaxed);
+    microbenchAllocatedBytes.fetch_add(size, memory_order_relaxed);
+    if (void *memory = malloc(size ? size : 1)) return memory;
+    throw bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+// --------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    int warmup = 3, trials = 30;
+    string filter, json = "bench.json";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        if (option == "--trials") trials = atoi(argv[i + 1]);
+        else if (option == "--warmup") warmup = atoi(argv[i + 1]);
+        else if (option == "--filter") filter = argv[i + 1];
+        else if (option == "--json") json = argv[i + 1];
+        else {
+            cout << "unknown option " << option << endl;
+            return -1;
+        }
+    }
+
+    // upload benchmarks need a context, but no window on screen
+    GLFWwindow *window = 0;
+    if (glfwInit()) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+        window = glfwCreateWindow(64, 64, "bench", 0, 0);
+    }
+    if (window) {
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGL()) {
+            glfwDestroyWindow(window);
+            window = 0;
+        }
+    }
+    if (!window) cout << "no OpenGL 4.1 context, skipping the upload benchmarks" << endl;
+
+    Microbench bench(warmup, trials);
+    bench.SetFilter(filter);
+    cout << "running microbenchmarks: " << warmup << " warm-up passes and " << trials << " trials each" << endl;
+    runMicrobenchmarks(&bench, window != 0);
+
+    cout << endl;
+    bench.Print();
+    PrintMemoryReport("after the benchmarks");
+    bool written = bench.WriteJson(json);
+    if (written) cout << "results written to " << json << endl;
+
+    if (window) glfwDestroyWindow(window);
+    glfwTerminate();
+    return written ? 0 : -1;
+}
@@ -0,0 +1,188 @@
+// ==========================================================================
+// Bezier Segment Math
+//
+// Evaluation, derivatives and exact bounds for the MySegment type defined in
+// GlyphExtractor.h. The formulas match shaders/tessEval.glsl so that CPU
+// queries agree with what is drawn on screen.
+// ==========================================================================
+
+#include "Bezier.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+MySegment SegmentFromPatch(const vec2 *patch)
+{
+    MySegment segment(patch[3] == vec2(0.0f) ? 2 : 3);
+    for (unsigned int i = 0; i <= segment.degree; ++i)
+        SetSegmentPoint(&segment, i, patch[i]);
+    return segment;
+}
+
+void AppendCubicPatch(const MySegment &segment, std::vector<vec2> *patches, const vec2 &offset)
+{
+    vec2 p0 = SegmentPoint(segment, 0) + offset;
+    vec2 p1 = SegmentPoint(segment, 1) + offset;
+
+    if (segment.degree == 3) {
+        patches->push_back(p0);
+        patches->push_back(p1);
+        patches->push_back(SegmentPoint(segment, 2) + offset);
+        patches->push_back(SegmentPoint(segment, 3) + offset);
+    }
+    else if (segment.degree == 2) {
+        vec2 p2 = SegmentPoint(segment, 2) + offset;
+        patches->push_back(p0);
+        patches->push_back(p0 + 2.0f/3.0f * (p1 - p0));
+        patches->push_back(p2 + 2.0f/3.0f * (p1 - p2));
+        patches->push_back(p2);
+    }
+    else if (segment.degree == 1) {
+        patches->push_back(p0);
+        patches->push_back(mix(p0, p1, 1.0f/3.0f));
+        patches->push_back(mix(p0, p1, 2.0f/3.0f));
+        patches->push_back(p1);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+vec2 EvaluateSegment(const MySegment &segment, float t)
+{
+    float s = 1.0f - t;
+    vec2 p0 = SegmentPoint(segment, 0);
+
+    switch (segment.degree) {
+    case 1:
+        return s*p0 + t*SegmentPoint(segment, 1);
+    case 2:
+        return s*s*p0 + 2*t*s*SegmentPoint(segment, 1) + t*t*SegmentPoint(segment, 2);
+    case 3:
+        return s*s*s*p0 + 3*t*s*s*SegmentPoint(segment, 1)
+             + 3*t*t*s*SegmentPoint(segment, 2) + t*t*t*SegmentPoint(segment, 3);
+    default:
+        return p0;
+    }
+}
+
+vec2 EvaluateDerivative(const MySegment &segment, float t)
+{
+    float s = 1.0f - t;
+    vec2 d0 = SegmentPoint(segment, 1) - SegmentPoint(segment, 0);
+
+    switch (segment.degree) {
+    case 1:
+        return d0;
+    case 2:
+        return 2*s*d0 + 2*t*(SegmentPoint(segment, 2) - SegmentPoint(segment, 1));
+    case 3:
+        return 3*s*s*d0
+             + 6*s*t*(SegmentPoint(segment, 2) - SegmentPoint(segment, 1))
+             + 3*t*t*(SegmentPoint(segment, 3) - SegmentPoint(segment, 2));
+    default:
+        return vec2(0.0f);
+    }
+}
+
+vec2 EvaluateSecondDerivative(const MySegment &segment, float t)
+{
+    vec2 p0 = SegmentPoint(segment, 0);
+    vec2 p1 = SegmentPoint(segment, 1);
+
+    switch (segment.degree) {
+    case 2:
+        return 2.0f*(SegmentPoint(segment, 2) - 2.0f*p1 + p0);
+    case 3: {
+        vec2 p2 = SegmentPoint(segment, 2);
+        vec2 p3 = SegmentPoint(segment, 3);
+        return 6*(1-t)*(p2 - 2.0f*p1 + p0) + 6*t*(p3 - 2.0f*p2 + p1);
+    }
+    default:
+        return vec2(0.0f);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+int SegmentExtrema(const MySegment &segment, int axis, float roots[2])
+{
+    const float *c = axis == 0 ? segment.x : segment.y;
+    int count = 0;
+
+    if (segment.degree == 2)
+    {
+        // derivative is linear: 2(1-t)(c1-c0) + 2t(c2-c1)
+        float denominator = c[0] - 2*c[1] + c[2];
+        if (denominator != 0) {
+            float t = (c[0] - c[1]) / denominator;
+            if (t > 0 && t < 1) roots[count++] = t;
+        }
+    }
+    else if (segment.degree == 3)
+    {
+        // derivative / 3 = a t^2 + b t + k in power basis
+        float a = -c[0] + 3*c[1] - 3*c[2] + c[3];
+        float b = 2*(c[0] - 2*c[1] + c[2]);
+        float k = c[1] - c[0];
+
+        if (fabs(a) < 1e-12f) {
+            if (b != 0) {
+                float t = -k / b;
+                if (t > 0 && t < 1) roots[count++] = t;
+            }
+        }
+        else {
+            float discriminant = b*b - 4*a*k;
+            if (discriminant >= 0) {
+                // numerically stable form of the quadratic formula
+                float q = -0.5f * (b + (b < 0 ? -1 : 1) * sqrt(discriminant));
+                float t0 = q / a;
+                float t1 = (q != 0) ? k / q : t0;
+                if (t0 > 0 && t0 < 1) roots[count++] = t0;
+                if (t1 > 0 && t1 < 1 && t1 != t0) roots[count++] = t1;
+            }
+        }
+    }
+
+    return count;
+}
+
+void SegmentBounds(const MySegment &segment, vec2 *lo, vec2 *hi)
+{
+    vec2 p0 = SegmentPoint(segment, 0);
+    vec2 pn = SegmentPoint(segment, segment.degree);
+    *lo = min(p0, pn);
+    *hi = max(p0, pn);
+
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        float roots[2];
+        int count = SegmentExtrema(segment, axis, roots);
+        for (int i = 0; i < count; ++i)
+        {
+            vec2 p = EvaluateSegment(segment, roots[i]);
+            (*lo)[axis] = std::min((*lo)[axis], p[axis]);
+            (*hi)[axis] = std::max((*hi)[axis], p[axis]);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+float SegmentArcLength(const MySegment &segment, float t0, float t1)
+{
+    static const float nodes[5] = { 0.0f, -0.5384693101f, 0.5384693101f, -0.9061798459f, 0.9061798459f };
+    static const float weights[5] = { 0.5688888889f, 0.4786286705f, 0.4786286705f, 0.2369268851f, 0.2369268851f };
+
+    float half = 0.5f * (t1 - t0);
+    float middle = 0.5f * (t1 + t0);
+    float length = 0;
+    for (int i = 0; i < 5; ++i)
+        length += weights[i] * glm::length(EvaluateDerivative(segment, middle + half * nodes[i]));
+    return half * length;
+}
+
+// --------------------------------------------------------------------------
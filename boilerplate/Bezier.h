@@ -0,0 +1,71 @@
+// ==========================================================================
+// Bezier Segment Math
+//
+// Evaluation, derivatives and exact bounds for the MySegment type defined in
+// GlyphExtractor.h. The formulas match shaders/tessEval.glsl so that CPU
+// queries agree with what is drawn on screen.
+// ==========================================================================
+#ifndef BEZIER_H
+#define BEZIER_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// Control point access
+
+// returns control point i of a segment
+inline glm::vec2 SegmentPoint(const MySegment &segment, int i)
+{
+    return glm::vec2(segment.x[i], segment.y[i]);
+}
+
+// sets control point i of a segment
+inline void SetSegmentPoint(MySegment *segment, int i, const glm::vec2 &p)
+{
+    segment->x[i] = p.x;
+    segment->y[i] = p.y;
+}
+
+// builds a segment from a 4 vertex patch, using the tessEval.glsl convention
+// that a fourth vertex of exactly (0,0) marks a quadratic
+MySegment SegmentFromPatch(const glm::vec2 *patch);
+
+// appends a segment as an exact 4 vertex cubic patch, degree elevating lines
+// and quadratics, plus an offset added to every vertex
+void AppendCubicPatch(const MySegment &segment, std::vector<glm::vec2> *patches,
+                      const glm::vec2 &offset = glm::vec2(0.0f));
+
+// --------------------------------------------------------------------------
+// Evaluation
+
+// position at parameter t in [0,1]
+glm::vec2 EvaluateSegment(const MySegment &segment, float t);
+
+// first and second derivatives with respect to t
+glm::vec2 EvaluateDerivative(const MySegment &segment, float t);
+glm::vec2 EvaluateSecondDerivative(const MySegment &segment, float t);
+
+// --------------------------------------------------------------------------
+// Extrema and bounds
+
+// finds the parameters in (0,1) where the derivative along axis (0=x, 1=y)
+// vanishes; returns how many were written to roots (at most 2)
+int SegmentExtrema(const MySegment &segment, int axis, float roots[2]);
+
+// computes the exact axis-aligned bounding box of the curve itself (not of its
+// control polygon) by evaluating the endpoints and the derivative roots
+void SegmentBounds(const MySegment &segment, glm::vec2 *lo, glm::vec2 *hi);
+
+// --------------------------------------------------------------------------
+// Arc length
+
+// length of the curve between parameters t0 and t1, by 5 point Gauss-Legendre
+// quadrature of |B'(t)|; split long ranges for more accuracy
+float SegmentArcLength(const MySegment &segment, float t0 = 0.0f, float t1 = 1.0f);
+
+// --------------------------------------------------------------------------
+#endif // BEZIER_H
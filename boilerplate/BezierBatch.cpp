@@ -0,0 +1,398 @@
+// ==========================================================================
+// Batch Bezier Evaluation and CPU Reference Rendering
+//
+// This module evaluates many quadratic and cubic segments at many parameter
+// values at once, with the Bernstein formulas used by shaders/tessEval.glsl,
+// and uses that evaluator to rasterise patch scenes without OpenGL.
+// ==========================================================================
+
+#include "BezierBatch.h"
+#include "Bezier.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+#include <stb/stb_image_write.h>
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+// Structure-of-arrays containers
+
+void ControlPointSoA::Clear()
+{
+    for (int i = 0; i < 4; ++i) {
+        x[i].clear();
+        y[i].clear();
+    }
+}
+
+void SegmentBatch::Clear()
+{
+    quadratics.Clear();
+    cubics.Clear();
+}
+
+void SegmentBatch::Add(const MySegment &segment)
+{
+    if (segment.degree == 0) return;
+
+    ControlPointSoA &soa = (segment.degree == 3) ? cubics : quadratics;
+    for (unsigned int i = 0; i <= segment.degree; ++i) {
+        soa.x[i].push_back(segment.x[i]);
+        soa.y[i].push_back(segment.y[i]);
+    }
+
+    // a line is exactly the quadratic whose middle control is its midpoint
+    if (segment.degree == 1) {
+        soa.x[2].push_back(segment.x[1]);
+        soa.y[2].push_back(segment.y[1]);
+        soa.x[1].back() = 0.5f * (segment.x[0] + segment.x[1]);
+        soa.y[1].back() = 0.5f * (segment.y[0] + segment.y[1]);
+    }
+}
+
+void SegmentBatch::AddPatches(const vec2 *vertices, size_t count)
+{
+    for (size_t i = 0; i + 4 <= count; i += 4)
+        Add(SegmentFromPatch(vertices + i));
+}
+
+// --------------------------------------------------------------------------
+// Bernstein weights at t = j/steps, identical to tessEval.glsl
+
+static void Weights(int degree, float t, float w[4])
+{
+    float s = 1 - t;
+    if (degree == 2) {
+        w[0] = s*s;     w[1] = 2*t*s;   w[2] = t*t;     w[3] = 0;
+    }
+    else {
+        w[0] = s*s*s;   w[1] = 3*t*s*s; w[2] = 3*t*t*s; w[3] = t*t*t;
+    }
+}
+
+// evaluates segments [begin, end) one at a time; also finishes SIMD tails
+static void EvaluateScalar(const ControlPointSoA &soa, int steps, size_t begin, size_t end,
+                           float *outX, float *outY)
+{
+    size_t n = soa.Count();
+    int terms = soa.degree + 1;
+
+    for (int j = 0; j <= steps; ++j)
+    {
+        float w[4];
+        Weights(soa.degree, float(j) / steps, w);
+        float *rowX = outX + j * n;
+        float *rowY = outY + j * n;
+
+        for (size_t s = begin; s < end; ++s)
+        {
+            float px = 0, py = 0;
+            for (int i = 0; i < terms; ++i) {
+                px += w[i] * soa.x[i][s];
+                py += w[i] * soa.y[i][s];
+            }
+            rowX[s] = px;
+            rowY[s] = py;
+        }
+    }
+}
+
+#ifdef BATCH_X86
+
+// 4 segments per iteration; SSE2 is part of the x86-64 baseline
+static size_t EvaluateSSE2(const ControlPointSoA &soa, int steps, float *outX, float *outY)
+{
+    size_t n = soa.Count();
+    size_t vectorEnd = n - n % 4;
+    int terms = soa.degree + 1;
+
+    for (int j = 0; j <= steps; ++j)
+    {
+        float w[4];
+        Weights(soa.degree, float(j) / steps, w);
+        __m128 wv[4];
+        for (int i = 0; i < 4; ++i) wv[i] = _mm_set1_ps(w[i]);
+
+        float *rowX = outX + j * n;
+        float *rowY = outY + j * n;
+
+        for (size_t s = 0; s < vectorEnd; s += 4)
+        {
+            __m128 px = _mm_mul_ps(wv[0], _mm_loadu_ps(&soa.x[0][s]));
+            __m128 py = _mm_mul_ps(wv[0], _mm_loadu_ps(&soa.y[0][s]));
+            for (int i = 1; i < terms; ++i) {
+                px = _mm_add_ps(px, _mm_mul_ps(wv[i], _mm_loadu_ps(&soa.x[i][s])));
+                py = _mm_add_ps(py, _mm_mul_ps(wv[i], _mm_loadu_ps(&soa.y[i][s])));
+            }
+            _mm_storeu_ps(rowX + s, px);
+            _mm_storeu_ps(rowY + s, py);
+        }
+    }
+    return vectorEnd;
+}
+
+// 8 segments per iteration, compiled for AVX2+FMA and only called after a
+// runtime check, so the rest of the program keeps the baseline instruction set
+__attribute__((target("avx2,fma")))
+static size_t EvaluateAVX2(const ControlPointSoA &soa, int steps, float *outX, float *outY)
+{
+    size_t n = soa.Count();
+    size_t vectorEnd = n - n % 8;
+    int terms = soa.degree + 1;
+
+    for (int j = 0; j <= steps; ++j)
+    {
+        float w[4];
+        Weights(soa.degree, float(j) / steps, w);
+        __m256 wv[4];
+        for (int i = 0; i < 4; ++i) wv[i] = _mm256_set1_ps(w[i]);
+
+        float *rowX = outX + j * n;
+        float *rowY = outY + j * n;
+
+        for (size_t s = 0; s < vectorEnd; s += 8)
+        {
+            __m256 px = _mm256_mul_ps(wv[0], _mm256_loadu_ps(&soa.x[0][s]));
+            __m256 py = _mm256_mul_ps(wv[0], _mm256_loadu_ps(&soa.y[0][s]));
+            for (int i = 1; i < terms; ++i) {
+                px = _mm256_fmadd_ps(wv[i], _mm256_loadu_ps(&soa.x[i][s]), px);
+                py = _mm256_fmadd_ps(wv[i], _mm256_loadu_ps(&soa.y[i][s]), py);
+            }
+            _mm256_storeu_ps(rowX + s, px);
+            _mm256_storeu_ps(rowY + s, py);
+        }
+    }
+    return vectorEnd;
+}
+
+#endif // BATCH_X86
+
+// --------------------------------------------------------------------------
+
+bool BatchPathSupported(BatchPath path)
+{
+    switch (path) {
+    case BATCH_SCALAR:
+    case BATCH_BEST:
+        return true;
+#ifdef BATCH_X86
+    case BATCH_SSE2:
+        return true;
+    case BATCH_AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    default:
+        return false;
+    }
+}
+
+const char *BatchPathName(BatchPath path)
+{
+    switch (path) {
+    case BATCH_SCALAR:  return "scalar";
+    case BATCH_SSE2:    return "sse2";
+    case BATCH_AVX2:    return "avx2";
+    default:            return "best";
+    }
+}
+
+void EvaluateBatch(const ControlPointSoA &soa, int steps, float *outX, float *outY, BatchPath path)
+{
+    if (path == BATCH_BEST)
+        path = BatchPathSupported(BATCH_AVX2) ? BATCH_AVX2
+             : BatchPathSupported(BATCH_SSE2) ? BATCH_SSE2 : BATCH_SCALAR;
+
+    size_t done = 0;
+#ifdef BATCH_X86
+    if (path == BATCH_AVX2) done = EvaluateAVX2(soa, steps, outX, outY);
+    else if (path == BATCH_SSE2) done = EvaluateSSE2(soa, steps, outX, outY);
+#endif
+    EvaluateScalar(soa, steps, done, soa.Count(), outX, outY);
+}
+
+// --------------------------------------------------------------------------
+// CPU reference rasteriser
+
+ReferenceRenderer::ReferenceRenderer(int width, int height)
+    : m_width(width), m_height(height), m_pixels(3 * width * height, 0)
+{}
+
+void ReferenceRenderer::Clear(const vec3 &colour)
+{
+    for (int i = 0; i < m_width * m_height; ++i)
+        for (int c = 0; c < 3; ++c)
+            m_pixels[3*i + c] = (unsigned char)(clamp(colour[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+vec2 ReferenceRenderer::ToPixel(const mat4 &transform, float x, float y) const
+{
+    vec4 ndc = transform * vec4(x, y, 0, 1);
+    return vec2((ndc.x * 0.5f + 0.5f) * m_width, (0.5f - ndc.y * 0.5f) * m_height);
+}
+
+void ReferenceRenderer::Plot(int x, int y, const vec3 &colour)
+{
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height) return;
+    unsigned char *pixel = &m_pixels[3 * (y * m_width + x)];
+    for (int c = 0; c < 3; ++c)
+        pixel[c] = (unsigned char)(clamp(colour[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+void ReferenceRenderer::Line(vec2 a, vec2 b, const vec3 &ca, const vec3 &cb)
+{
+    // one sample per pixel along the major axis, like a 1 pixel wide GL line
+    vec2 d = b - a;
+    int steps = std::max(1, int(ceil(std::max(fabs(d.x), fabs(d.y)))));
+    for (int i = 0; i <= steps; ++i)
+    {
+        float u = float(i) / steps;
+        vec2 p = a + u * d;
+        Plot(int(floor(p.x)), int(floor(p.y)), mix(ca, cb, u));
+    }
+}
+
+void ReferenceRenderer::DrawSoA(const ControlPointSoA &soa, const vector<vec3> &startColours,
+                                const vector<vec3> &endColours, const mat4 &transform, int steps)
+{
+    size_t n = soa.Count();
+    if (n == 0) return;
+
+    m_x.resize((steps + 1) * n);
+    m_y.resize(m_x.size());
+    EvaluateBatch(soa, steps, m_x.data(), m_y.data());
+
+    for (size_t s = 0; s < n; ++s)
+    {
+        vec2 previous = ToPixel(transform, m_x[s], m_y[s]);
+        for (int j = 1; j <= steps; ++j)
+        {
+            vec2 next = ToPixel(transform, m_x[j*n + s], m_y[j*n + s]);
+            // colour is interpolated between the first two patch vertices, as in tessEval
+            Line(previous, next, mix(startColours[s], endColours[s], float(j-1) / steps),
+                                 mix(startColours[s], endColours[s], float(j) / steps));
+            previous = next;
+        }
+    }
+}
+
+void ReferenceRenderer::DrawPatches(const vec2 *vertices, const vec3 *colours, size_t count,
+                                    const mat4 &transform, int steps)
+{
+    SegmentBatch batch;
+    vector<vec3> quadraticColours[2], cubicColours[2];
+    for (size_t i = 0; i + 4 <= count; i += 4)
+    {
+        MySegment segment = SegmentFromPatch(vertices + i);
+        batch.Add(segment);
+        vector<vec3> *target = segment.degree == 3 ? cubicColours : quadraticColours;
+        target[0].push_back(colours[i]);
+        target[1].push_back(colours[i + 1]);
+    }
+
+    const ControlPointSoA *batches[2] = { &batch.quadratics, &batch.cubics };
+    const vector<vec3> *start[2] = { &quadraticColours[0], &cubicColours[0] };
+    const vector<vec3> *end[2] = { &quadraticColours[1], &cubicColours[1] };
+    for (int b = 0; b < 2; ++b)
+        DrawSoA(*batches[b], *start[b], *end[b], transform, steps);
+}
+
+void ReferenceRenderer::DrawLineStrip(const vec2 *vertices, const vec3 *colours, size_t count,
+                                      const mat4 &transform)
+{
+    for (size_t i = 0; i + 1 < count; ++i)
+        Line(ToPixel(transform, vertices[i].x, vertices[i].y),
+             ToPixel(transform, vertices[i+1].x, vertices[i+1].y), colours[i], colours[i+1]);
+}
+
+void ReferenceRenderer::DrawLines(const vec2 *vertices, const vec3 *colours, size_t count,
+                                  const mat4 &transform)
+{
+    for (size_t i = 0; i + 1 < count; i += 2)
+        Line(ToPixel(transform, vertices[i].x, vertices[i].y),
+             ToPixel(transform, vertices[i+1].x, vertices[i+1].y), colours[i], colours[i+1]);
+}
+
+void ReferenceRenderer::DrawPoints(const vec2 *vertices, const vec3 *colours, size_t count,
+                                   const mat4 &transform, int size)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        vec2 p = ToPixel(transform, vertices[i].x, vertices[i].y);
+        int x0 = int(floor(p.x - 0.5f * size + 0.5f));
+        int y0 = int(floor(p.y - 0.5f * size + 0.5f));
+        for (int y = y0; y < y0 + size; ++y)
+            for (int x = x0; x < x0 + size; ++x)
+                Plot(x, y, colours[i]);
+    }
+}
+
+bool ReferenceRenderer::WritePng(const string &filename) const
+{
+    if (!stbi_write_png(filename.c_str(), m_width, m_height, 3, m_pixels.data(), 3 * m_width)) {
+        cout << "ERROR: could not write image " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// Benchmark
+
+void BenchmarkBezierBatch(size_t segments, int steps, int trials)
+{
+    SegmentBatch batch;
+    srand(453);
+    for (size_t i = 0; i < segments; ++i)
+    {
+        MySegment segment(2 + i % 2);
+        for (unsigned int k = 0; k <= segment.degree; ++k) {
+            segment.x[k] = rand() / float(RAND_MAX);
+            segment.y[k] = rand() / float(RAND_MAX);
+        }
+        batch.Add(segment);
+    }
+
+    size_t largest = std::max(batch.quadratics.Count(), batch.cubics.Count());
+    vector<float> outX((steps + 1) * largest), outY((steps + 1) * largest);
+
+    cout << "Bezier batch: " << segments << " segments x " << steps + 1 << " samples" << endl;
+
+    double scalarRate = 0;
+    BatchPath paths[3] = { BATCH_SCALAR, BATCH_SSE2, BATCH_AVX2 };
+    for (int p = 0; p < 3; ++p)
+    {
+        if (!BatchPathSupported(paths[p])) {
+            cout << "  " << BatchPathName(paths[p]) << ": not supported on this CPU" << endl;
+            continue;
+        }
+
+        // best of several trials, after one warm-up pass
+        double best = 1e30;
+        for (int trial = 0; trial <= trials; ++trial)
+        {
+            chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+            EvaluateBatch(batch.quadratics, steps, outX.data(), outY.data(), paths[p]);
+            EvaluateBatch(batch.cubics, steps, outX.data(), outY.data(), paths[p]);
+            double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+            if (trial > 0) best = std::min(best, seconds);
+        }
+
+        double rate = segments / best;
+        if (paths[p] == BATCH_SCALAR) scalarRate = rate;
+        cout << "  " << BatchPathName(paths[p]) << ": " << rate / 1e6 << " M segments/s";
+        if (scalarRate > 0 && paths[p] != BATCH_SCALAR) cout << " (" << rate / scalarRate << "x scalar)";
+        cout << endl;
+    }
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,130 @@
+// ==========================================================================
+// Batch Bezier Evaluation and CPU Reference Rendering
+//
+// This module evaluates many quadratic and cubic segments at many parameter
+// values at once, with the Bernstein formulas used by shaders/tessEval.glsl:
+//  - SegmentBatch holds a structure-of-arrays copy of segment control points,
+//    one array per coordinate per control point
+//  - EvaluateBatch() vectorises across segments: SSE2 on every x86-64 CPU,
+//    AVX2+FMA when the running CPU supports it, scalar code elsewhere
+//  - ReferenceRenderer rasterises patch scenes into an RGB image with no GL,
+//    drawing the same 64-segment isolines the tessellator would
+//  - BenchmarkBezierBatch() reports segments per second for each code path
+// ==========================================================================
+#ifndef BEZIERBATCH_H
+#define BEZIERBATCH_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// Structure-of-arrays control points for segments of a single degree
+
+struct ControlPointSoA
+{
+    int degree;                 // 2 or 3
+    std::vector<float> x[4];    // x[i][s] is control point i of segment s
+    std::vector<float> y[4];
+
+    ControlPointSoA(int d = 3) : degree(d)
+    {}
+
+    size_t Count() const { return x[0].size(); }
+    void Clear();
+};
+
+// A batch of segments, split by degree so every lane does the same work
+struct SegmentBatch
+{
+    ControlPointSoA quadratics;
+    ControlPointSoA cubics;
+
+    SegmentBatch() : quadratics(2), cubics(3)
+    {}
+
+    void Clear();
+
+    // adds a segment; lines are stored as quadratics with a midpoint control
+    void Add(const MySegment &segment);
+
+    // adds 4 vertex patches using the tessEval.glsl quadratic convention
+    void AddPatches(const glm::vec2 *vertices, size_t count);
+
+    size_t Count() const { return quadratics.Count() + cubics.Count(); }
+};
+
+// --------------------------------------------------------------------------
+// Evaluation
+
+enum BatchPath
+{
+    BATCH_SCALAR,
+    BATCH_SSE2,
+    BATCH_AVX2,
+    BATCH_BEST      // the fastest path the running CPU supports
+};
+
+// true if the running CPU can execute the given path
+bool BatchPathSupported(BatchPath path);
+const char *BatchPathName(BatchPath path);
+
+// evaluates every segment at t = j/steps for j = 0..steps; results are stored
+// sample-major: point j of segment s is (outX[j*n + s], outY[j*n + s]) where
+// n = soa.Count(), so outX and outY must each hold (steps+1)*n floats
+void EvaluateBatch(const ControlPointSoA &soa, int steps, float *outX, float *outY,
+                   BatchPath path = BATCH_BEST);
+
+// --------------------------------------------------------------------------
+// CPU reference rasteriser
+
+class ReferenceRenderer
+{
+    int m_width, m_height;
+    std::vector<unsigned char> m_pixels;    // RGB, top row first
+
+    // scratch buffers for batch evaluation
+    std::vector<float> m_x, m_y;
+
+    glm::vec2 ToPixel(const glm::mat4 &transform, float x, float y) const;
+    void Plot(int x, int y, const glm::vec3 &colour);
+    void Line(glm::vec2 a, glm::vec2 b, const glm::vec3 &ca, const glm::vec3 &cb);
+    void DrawSoA(const ControlPointSoA &soa, const std::vector<glm::vec3> &startColours,
+                 const std::vector<glm::vec3> &endColours, const glm::mat4 &transform, int steps);
+
+public:
+    ReferenceRenderer(int width, int height);
+
+    void Clear(const glm::vec3 &colour);
+
+    // draws 4 vertex patches as tessellated isolines (GL_PATCHES, type 0)
+    void DrawPatches(const glm::vec2 *vertices, const glm::vec3 *colours, size_t count,
+                     const glm::mat4 &transform, int steps = 64);
+
+    // draws a line strip (type 1) and square points of the given size (type 2)
+    void DrawLineStrip(const glm::vec2 *vertices, const glm::vec3 *colours, size_t count,
+                       const glm::mat4 &transform);
+
+    // draws separate lines between vertex pairs (GL_LINES)
+    void DrawLines(const glm::vec2 *vertices, const glm::vec3 *colours, size_t count,
+                   const glm::mat4 &transform);
+    void DrawPoints(const glm::vec2 *vertices, const glm::vec3 *colours, size_t count,
+                    const glm::mat4 &transform, int size = 5);
+
+    // writes the image as a PNG; returns false on failure
+    bool WritePng(const std::string &filename) const;
+
+    const unsigned char *Pixels() const { return m_pixels.data(); }
+};
+
+// --------------------------------------------------------------------------
+// Benchmark
+
+// times each supported path on random segments and prints segments/s
+void BenchmarkBezierBatch(size_t segments = 1 << 16, int steps = 64, int trials = 5);
+
+// --------------------------------------------------------------------------
+#endif // BEZIERBATCH_H
@@ -0,0 +1,116 @@
+// ==========================================================================
+// 2D Camera Support Code
+//
+// This module defines a Camera class that owns the view transform shared by
+// every shader program. The view matrix lives in a std140 uniform block
+// ("Camera") so that panning and zooming only ever rewrite 64 bytes of
+// uniform data; vertex buffers are never touched.
+// ==========================================================================
+
+#include "Camera.h"
+#include "GLState.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace glm;
+
+// limits keep the view matrix well conditioned
+static const float MIN_ZOOM = 1.0f / 64.0f;
+static const float MAX_ZOOM = 4096.0f;
+
+// --------------------------------------------------------------------------
+
+Camera::Camera()
+    : m_uniformBuffer(0), m_pan(0.0f), m_zoom(1.0f), m_dirty(true)
+{}
+
+bool Camera::Initialize()
+{
+    glGenBuffers(1, &m_uniformBuffer);
+    BindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(mat4), 0, GL_DYNAMIC_DRAW);
+    BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    BindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, m_uniformBuffer);
+
+    m_dirty = true;
+    return glGetError() == GL_NO_ERROR;
+}
+
+void Camera::Destroy()
+{
+    DeleteBuffers(1, &m_uniformBuffer);
+    m_uniformBuffer = 0;
+}
+
+void Camera::AttachProgram(GLuint program) const
+{
+    // GLSL 4.10 has no layout(binding=) for blocks, so bind by index instead
+    GLuint blockIndex = glGetUniformBlockIndex(program, "Camera");
+    if (blockIndex == GL_INVALID_INDEX) {
+        cout << "Camera WARNING: program " << program
+             << " has no Camera uniform block" << endl;
+        return;
+    }
+    glUniformBlockBinding(program, blockIndex, CAMERA_BLOCK_BINDING);
+}
+
+// --------------------------------------------------------------------------
+
+void Camera::Pan(const vec2 &deltaNdc)
+{
+    m_pan -= deltaNdc / m_zoom;
+    m_dirty = true;
+}
+
+void Camera::ZoomAt(const vec2 &ndc, float factor)
+{
+    vec2 anchor = ScreenToWorld(ndc);
+    m_zoom = clamp(m_zoom * factor, MIN_ZOOM, MAX_ZOOM);
+
+    // shift so the anchor lands back under the same screen position
+    m_pan = anchor - ndc / m_zoom;
+    m_dirty = true;
+}
+
+void Camera::Reset()
+{
+    m_pan = vec2(0.0f);
+    m_zoom = 1.0f;
+    m_dirty = true;
+}
+
+void Camera::SetView(const vec2 &centre, float zoom)
+{
+    if (centre == m_pan && zoom == m_zoom) return;
+    m_pan = centre;
+    m_zoom = zoom;
+    m_dirty = true;
+}
+
+vec2 Camera::ScreenToWorld(const vec2 &ndc) const
+{
+    return m_pan + ndc / m_zoom;
+}
+
+mat4 Camera::ViewMatrix() const
+{
+    mat4 view = scale(mat4(1.0f), vec3(m_zoom, m_zoom, 1.0f));
+    return translate(view, vec3(-m_pan, 0.0f));
+}
+
+void Camera::Update()
+{
+    if (!m_dirty) return;
+
+    mat4 view = ViewMatrix();
+    BindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(mat4), value_ptr(view));
+    BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    m_dirty = false;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+// ==========================================================================
+// 2D Camera Support Code
+//
+// This module defines a Camera class that owns the view transform shared by
+// every shader program. The view matrix lives in a std140 uniform block
+// ("Camera") so that panning and zooming only ever rewrite 64 bytes of
+// uniform data; vertex buffers are never touched.
+//
+// Per-object placement is done separately through each program's "model"
+// uniform (see Geometry::model in the main program).
+// ==========================================================================
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// binding point the "Camera" uniform block of every program is attached to
+const GLuint CAMERA_BLOCK_BINDING = 0;
+
+// --------------------------------------------------------------------------
+// This class tracks pan and zoom and mirrors them into a uniform buffer.
+
+class Camera
+{
+    GLuint      m_uniformBuffer;
+
+    glm::vec2   m_pan;      // world position shown at the centre of the window
+    float       m_zoom;     // scale factor from world to normalized device units
+    bool        m_dirty;    // true if the uniform buffer is out of date
+
+public:
+    Camera();
+
+    // creates the uniform buffer and attaches it to CAMERA_BLOCK_BINDING
+    bool Initialize();
+
+    // deallocates the uniform buffer
+    void Destroy();
+
+    // points the "Camera" uniform block of a program at our binding point
+    void AttachProgram(GLuint program) const;
+
+    // moves the view by a displacement given in normalized device units
+    void Pan(const glm::vec2 &deltaNdc);
+
+    // scales the view by factor, keeping the world point under ndc fixed
+    void ZoomAt(const glm::vec2 &ndc, float factor);
+
+    // returns to the identity view
+    void Reset();
+
+    // copies the view of another camera, for example one driven by input on
+    // another thread; the uniform buffer is only rewritten if it changed
+    void SetView(const glm::vec2 &centre, float zoom);
+
+    // converts a normalized device position into world coordinates
+    glm::vec2 ScreenToWorld(const glm::vec2 &ndc) const;
+
+    glm::mat4 ViewMatrix() const;
+    float Zoom() const { return m_zoom; }
+    const glm::vec2 &Centre() const { return m_pan; }
+
+    // uploads the view matrix if it changed since the last call
+    void Update();
+};
+
+// --------------------------------------------------------------------------
+#endif // CAMERA_H
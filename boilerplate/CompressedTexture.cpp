@@ -0,0 +1,605 @@
+// ==========================================================================
+// Block-Compressed Textures
+//
+// KTX and DDS containers, a BC1/BC3/BC4/BC5 block encoder and the offline
+// converter built on them.
+// ==========================================================================
+
+#include "CompressedTexture.h"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include <glm/glm.hpp>
+
+using namespace std;
+using namespace glm;
+
+// S3TC formats are an extension, so glad's core profile header does not name them
+static const GLenum COMPRESSED_RGBA_S3TC_DXT1 = 0x83F1;
+static const GLenum COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+static const char *FORMAT_NAMES[] = { "BC1", "BC3", "BC4", "BC5" };
+
+const char *BlockFormatName(BlockFormat format)
+{
+    return FORMAT_NAMES[format];
+}
+
+bool ParseBlockFormat(const string &name, BlockFormat *format)
+{
+    for (int i = 0; i < BLOCK_FORMAT_COUNT; ++i) {
+        string upper = name;
+        transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        if (upper == FORMAT_NAMES[i]) {
+            *format = BlockFormat(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+GLenum BlockInternalFormat(BlockFormat format)
+{
+    switch (format) {
+    case BLOCK_BC1: return COMPRESSED_RGBA_S3TC_DXT1;
+    case BLOCK_BC3: return COMPRESSED_RGBA_S3TC_DXT5;
+    case BLOCK_BC4: return GL_COMPRESSED_RED_RGTC1;
+    default: return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+bool BlockFormatSupported(BlockFormat format)
+{
+    // BC4 and BC5 are core; BC1 and BC3 are the S3TC extension, which nearly every driver has
+    if (format == BLOCK_BC4 || format == BLOCK_BC5) return true;
+
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+        if (strcmp(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i)), "GL_EXT_texture_compression_s3tc") == 0)
+            return true;
+    return false;
+}
+
+size_t BlockBytes(BlockFormat format)
+{
+    return format == BLOCK_BC1 || format == BLOCK_BC4 ? 8 : 16;
+}
+
+static size_t LevelBytes(BlockFormat format, int width, int height)
+{
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+size_t CompressedImage::Bytes() const
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < levels.size(); ++i)
+        bytes += levels[i].data.size();
+    return bytes;
+}
+
+size_t CompressedImage::UncompressedBytes() const
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < levels.size(); ++i)
+        bytes += 4 * size_t(levels[i].width) * levels[i].height;
+    return bytes;
+}
+
+bool IsCompressedTextureFile(const string &filename)
+{
+    if (filename.size() < 4) return false;
+    string extension = filename.substr(filename.size() - 4);
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".ktx" || extension == ".dds";
+}
+
+// --------------------------------------------------------------------------
+// Vertical flips, block by block: block rows swap, then texel rows inside
+// each block. Exact when the height is a multiple of 4 or under 4 (the
+// small mip levels); other heights would need re-encoding.
+
+static void FlipColourBlock(unsigned char *block, int rows)
+{
+    // 2 bit indices, one byte per row after the two end points
+    reverse(block + 4, block + 4 + rows);
+}
+
+static void FlipAlphaBlock(unsigned char *block, int rows)
+{
+    // 3 bit indices, 12 bits per row after the two end points
+    unsigned long long bits = 0;
+    for (int i = 0; i < 6; ++i)
+        bits |= (unsigned long long)block[2 + i] << (8 * i);
+
+    unsigned long long flipped = bits;
+    for (int row = 0; row < rows; ++row) {
+        unsigned long long mask = 0xFFFull << (12 * (rows - 1 - row));
+        flipped &= ~(0xFFFull << (12 * row));
+        flipped |= ((bits & mask) >> (12 * (rows - 1 - row))) << (12 * row);
+    }
+    for (int i = 0; i < 6; ++i)
+        block[2 + i] = (unsigned char)(flipped >> (8 * i));
+}
+
+static bool FlipLevel(BlockFormat format, CompressedLevel *level)
+{
+    int blocksWide = (level->width + 3) / 4, blocksHigh = (level->height + 3) / 4;
+    size_t blockBytes = BlockBytes(format), rowBytes = blocksWide * blockBytes;
+    int rows = std::min(level->height, 4);
+
+    vector<unsigned char> row(rowBytes);
+    for (int y = 0; y < blocksHigh / 2; ++y) {
+        unsigned char *top = &level->data[y * rowBytes], *bottom = &level->data[(blocksHigh - 1 - y) * rowBytes];
+        memcpy(row.data(), top, rowBytes);
+        memcpy(top, bottom, rowBytes);
+        memcpy(bottom, row.data(), rowBytes);
+    }
+    for (size_t b = 0; b < level->data.size(); b += blockBytes) {
+        unsigned char *block = &level->data[b];
+        if (format == BLOCK_BC1) FlipColourBlock(block, rows);
+        else if (format == BLOCK_BC3) { FlipAlphaBlock(block, rows); FlipColourBlock(block + 8, rows); }
+        else if (format == BLOCK_BC4) FlipAlphaBlock(block, rows);
+        else { FlipAlphaBlock(block, rows); FlipAlphaBlock(block + 8, rows); }
+    }
+    return level->height < 4 || level->height % 4 == 0;
+}
+
+static void FlipImage(CompressedImage *image, const string &filename)
+{
+    bool exact = true;
+    for (size_t i = 0; i < image->levels.size(); ++i)
+        exact = FlipLevel(image->format, &image->levels[i]) && exact;
+    if (!exact)
+        cout << "CompressedTexture: " << filename << " has a height that is not a multiple of 4, "
+             << "its rows are shifted after the flip" << endl;
+}
+
+// --------------------------------------------------------------------------
+// Containers
+
+static const unsigned char KTX_IDENTIFIER[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+static const uint32_t KTX_ENDIAN = 0x04030201;
+
+struct KtxHeader
+{
+    uint32_t endianness, glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat;
+    uint32_t pixelWidth, pixelHeight, pixelDepth, arrayElements, faces, mipmapLevels, keyValueBytes;
+};
+
+static const char DDS_MAGIC[4] = { 'D', 'D', 'S', ' ' };
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDPF_FOURCC = 0x4;
+
+struct DdsHeader
+{
+    uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipmapCount, reserved1[11];
+    uint32_t pfSize, pfFlags, pfFourCC, pfBitCount, pfMasks[4];
+    uint32_t caps[4], reserved2;
+};
+
+struct DdsHeaderDx10
+{
+    uint32_t dxgiFormat, dimension, miscFlags, arraySize, miscFlags2;
+};
+
+static uint32_t FourCC(const char *code)
+{
+    return uint32_t(code[0]) | uint32_t(code[1]) << 8 | uint32_t(code[2]) << 16 | uint32_t(code[3]) << 24;
+}
+
+// reads the levels following offset, each optionally preceded by its size as in KTX
+static bool ReadLevels(const vector<unsigned char> &file, size_t offset, int width, int height, int count,
+                       bool sizePrefix, CompressedImage *image)
+{
+    image->levels.clear();
+    for (int i = 0; i < std::max(count, 1); ++i)
+    {
+        CompressedLevel level;
+        level.width = width;
+        level.height = height;
+        size_t bytes = LevelBytes(image->format, width, height);
+
+        if (sizePrefix) {
+            uint32_t size;
+            if (offset + 4 > file.size()) return false;
+            memcpy(&size, &file[offset], 4);
+            offset += 4;
+            if (size != bytes) return false;
+        }
+        if (offset + bytes > file.size()) return false;
+        level.data.assign(file.begin() + offset, file.begin() + offset + bytes);
+        offset += bytes;
+        image->levels.push_back(level);
+
+        if (width == 1 && height == 1) break;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return true;
+}
+
+static bool ReadKtx(const vector<unsigned char> &file, const string &filename, CompressedImage *image)
+{
+    KtxHeader header;
+    if (file.size() < sizeof(KTX_IDENTIFIER) + sizeof(header)) return false;
+    memcpy(&header, &file[sizeof(KTX_IDENTIFIER)], sizeof(header));
+    if (header.endianness != KTX_ENDIAN) {
+        cout << "CompressedTexture ERROR: " << filename << " has the other byte order" << endl;
+        return false;
+    }
+
+    bool known = false;
+    for (int i = 0; i < BLOCK_FORMAT_COUNT && !known; ++i)
+        if (header.glInternalFormat == BlockInternalFormat(BlockFormat(i))) {
+            image->format = BlockFormat(i);
+            known = true;
+        }
+    if (!known || header.glType != 0 || header.pixelDepth > 1 || header.arrayElements > 0 || header.faces != 1) {
+        cout << "CompressedTexture ERROR: " << filename << " is not a 2D BC1, BC3, BC4 or BC5 texture" << endl;
+        return false;
+    }
+
+    // the orientation key says which way the rows run; without one, OpenGL order is assumed
+    size_t offset = sizeof(KTX_IDENTIFIER) + sizeof(header);
+    size_t end = offset + header.keyValueBytes;
+    bool topDown = false;
+    while (offset + 4 <= end && end <= file.size()) {
+        uint32_t size;
+        memcpy(&size, &file[offset], 4);
+        if (offset + 4 + size > end) break;
+        string pair(file.begin() + offset + 4, file.begin() + offset + 4 + size);
+        if (pair.compare(0, 15, string("KTXorientation\0", 15)) == 0 && pair.find("T=d") != string::npos)
+            topDown = true;
+        offset += 4 + ((size + 3) & ~3u);
+    }
+
+    if (!ReadLevels(file, end, header.pixelWidth, header.pixelHeight, header.mipmapLevels, true, image)) {
+        cout << "CompressedTexture ERROR: " << filename << " is truncated" << endl;
+        return false;
+    }
+    if (topDown) FlipImage(image, filename);
+    return true;
+}
+
+static bool ReadDds(const vector<unsigned char> &file, const string &filename, CompressedImage *image)
+{
+    DdsHeader header;
+    if (file.size() < sizeof(DDS_MAGIC) + sizeof(header)) return false;
+    memcpy(&header, &file[sizeof(DDS_MAGIC)], sizeof(header));
+    size_t offset = sizeof(DDS_MAGIC) + sizeof(header);
+
+    uint32_t fourCC = (header.pfFlags & DDPF_FOURCC) ? header.pfFourCC : 0;
+    bool known = true;
+    if (fourCC == FourCC("DXT1")) image->format = BLOCK_BC1;
+    else if (fourCC == FourCC("DXT5")) image->format = BLOCK_BC3;
+    else if (fourCC == FourCC("ATI1") || fourCC == FourCC("BC4U")) image->format = BLOCK_BC4;
+    else if (fourCC == FourCC("ATI2") || fourCC == FourCC("BC5U")) image->format = BLOCK_BC5;
+    else if (fourCC == FourCC("DX10") && file.size() >= offset + sizeof(DdsHeaderDx10)) {
+        DdsHeaderDx10 extension;
+        memcpy(&extension, &file[offset], sizeof(extension));
+        offset += sizeof(extension);
+
+        // the UNORM and sRGB DXGI formats of each
+        switch (extension.dxgiFormat) {
+        case 71: case 72: image->format = BLOCK_BC1; break;
+        case 77: case 78: image->format = BLOCK_BC3; break;
+        case 80: image->format = BLOCK_BC4; break;
+        case 83: image->format = BLOCK_BC5; break;
+        default: known = false;
+        }
+        known = known && extension.arraySize <= 1;
+    }
+    else known = false;
+
+    if (!known) {
+        cout << "CompressedTexture ERROR: " << filename << " is not a 2D BC1, BC3, BC4 or BC5 texture" << endl;
+        return false;
+    }
+
+    int levels = (header.flags & DDSD_MIPMAPCOUNT) ? header.mipmapCount : 1;
+    if (!ReadLevels(file, offset, header.width, header.height, levels, false, image)) {
+        cout << "CompressedTexture ERROR: " << filename << " is truncated" << endl;
+        return false;
+    }
+    FlipImage(image, filename);
+    return true;
+}
+
+bool LoadCompressedImage(const string &filename, CompressedImage *image)
+{
+    ifstream input(filename.c_str(), ios::binary);
+    if (!input) {
+        cout << "CompressedTexture ERROR: could not open " << filename << endl;
+        return false;
+    }
+    vector<unsigned char> file((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+
+    if (file.size() >= sizeof(KTX_IDENTIFIER) && memcmp(&file[0], KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) == 0)
+        return ReadKtx(file, filename, image);
+    if (file.size() >= sizeof(DDS_MAGIC) && memcmp(&file[0], DDS_MAGIC, sizeof(DDS_MAGIC)) == 0)
+        return ReadDds(file, filename, image);
+
+    cout << "CompressedTexture ERROR: " << filename << " is neither KTX nor DDS" << endl;
+    return false;
+}
+
+bool WriteKtx(const string &filename, const CompressedImage &image)
+{
+    ofstream output(filename.c_str(), ios::binary);
+    if (!output || image.levels.empty()) {
+        cout << "CompressedTexture ERROR: could not write " << filename << endl;
+        return false;
+    }
+
+    // levels are written bottom row first, which the orientation key records
+    const char ORIENTATION[] = "KTXorientation\0S=r,T=u";
+    uint32_t pairBytes = sizeof(ORIENTATION);
+    uint32_t padding = (4 - pairBytes % 4) % 4;
+
+    const GLenum BASE_FORMATS[] = { GL_RGBA, GL_RGBA, GL_RED, GL_RG };
+    KtxHeader header;
+    header.endianness = KTX_ENDIAN;
+    header.glType = 0;
+    header.glTypeSize = 1;
+    header.glFormat = 0;
+    header.glInternalFormat = BlockInternalFormat(image.format);
+    header.glBaseInternalFormat = BASE_FORMATS[image.format];
+    header.pixelWidth = image.levels[0].width;
+    header.pixelHeight = image.levels[0].height;
+    header.pixelDepth = 0;
+    header.arrayElements = 0;
+    header.faces = 1;
+    header.mipmapLevels = image.levels.size();
+    header.keyValueBytes = 4 + pairBytes + padding;
+
+    const char zeros[4] = { 0, 0, 0, 0 };
+    output.write((const char*)KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    output.write((const char*)&header, sizeof(header));
+    output.write((const char*)&pairBytes, 4);
+    output.write(ORIENTATION, pairBytes);
+    output.write(zeros, padding);
+
+    // block sizes are multiples of 4, so levels need no padding
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        uint32_t size = image.levels[i].data.size();
+        output.write((const char*)&size, 4);
+        output.write((const char*)image.levels[i].data.data(), size);
+    }
+    return bool(output);
+}
+
+// --------------------------------------------------------------------------
+// Encoder
+
+static uint16_t PackColour(vec3 c)
+{
+    c = clamp(c, 0.0f, 255.0f);
+    return uint16_t(int(c.r * 31 / 255 + 0.5f) << 11 | int(c.g * 63 / 255 + 0.5f) << 5 | int(c.b * 31 / 255 + 0.5f));
+}
+
+static vec3 UnpackColour(uint16_t c)
+{
+    int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+    return vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// 4 colour mode when opaque, 3 colours and transparent black when some
+// texels have alpha under 128 and transparent is allowed
+static void EncodeColourBlock(const unsigned char rgba[64], bool allowTransparent, unsigned char out[8])
+{
+    vec3 colours[16];
+    bool transparent[16];
+    int opaque = 0;
+    vec3 mean(0.0f);
+    for (int i = 0; i < 16; ++i) {
+        colours[i] = vec3(rgba[4 * i], rgba[4 * i + 1], rgba[4 * i + 2]);
+        transparent[i] = allowTransparent && rgba[4 * i + 3] < 128;
+        if (!transparent[i]) { mean += colours[i]; opaque++; }
+    }
+    bool transparentMode = opaque < 16;
+
+    uint16_t c0 = 0, c1 = 0;
+    if (opaque > 0) {
+        mean /= float(opaque);
+
+        // principal axis of the colours by power iteration on their covariance
+        mat3 covariance(0.0f);
+        for (int i = 0; i < 16; ++i) {
+            if (transparent[i]) continue;
+            vec3 d = colours[i] - mean;
+            covariance += outerProduct(d, d);
+        }
+        vec3 axis(1.0f);
+        for (int k = 0; k < 8; ++k) {
+            vec3 next = covariance * axis;
+            float length = glm::length(next);
+            if (length < 1e-6f) break;
+            axis = next / length;
+        }
+
+        float lo = 1e30f, hi = -1e30f;
+        for (int i = 0; i < 16; ++i) {
+            if (transparent[i]) continue;
+            float t = dot(colours[i] - mean, axis);
+            lo = std::min(lo, t);
+            hi = std::max(hi, t);
+        }
+        c0 = PackColour(mean + hi * axis);
+        c1 = PackColour(mean + lo * axis);
+    }
+
+    // the order of the end points selects the mode
+    if (transparentMode ? c0 > c1 : c0 < c1) swap(c0, c1);
+    vec3 palette[4];
+    palette[0] = UnpackColour(c0);
+    palette[1] = UnpackColour(c1);
+    if (transparentMode) {
+        palette[2] = (palette[0] + palette[1]) / 2.0f;
+        palette[3] = vec3(0.0f);
+    } else {
+        palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+        palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+    }
+
+    out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+    for (int row = 0; row < 4; ++row) {
+        unsigned char bits = 0;
+        for (int column = 0; column < 4; ++column) {
+            int i = 4 * row + column, best = 3;
+            if (!transparent[i] && c0 != c1) {
+                float bestDistance = 1e30f;
+                for (int p = 0; p < (transparentMode ? 3 : 4); ++p) {
+                    vec3 d = colours[i] - palette[p];
+                    if (dot(d, d) < bestDistance) { bestDistance = dot(d, d); best = p; }
+                }
+            } else if (!transparent[i]) {
+                best = 0;
+            }
+            bits |= best << (2 * column);
+        }
+        out[4 + row] = bits;
+    }
+}
+
+// one channel, 8 value mode between its minimum and maximum
+static void EncodeAlphaBlock(const unsigned char values[16], unsigned char out[8])
+{
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; ++i) {
+        lo = std::min(lo, int(values[i]));
+        hi = std::max(hi, int(values[i]));
+    }
+    out[0] = hi;
+    out[1] = lo;
+
+    int palette[8] = { hi, lo };
+    for (int p = 2; p < 8; ++p)
+        palette[p] = ((8 - p) * hi + (p - 1) * lo + 3) / 7;
+
+    unsigned long long bits = 0;
+    for (int i = 0; i < 16 && hi != lo; ++i) {
+        int best = 0;
+        for (int p = 1; p < 8; ++p)
+            if (abs(values[i] - palette[p]) < abs(values[i] - palette[best])) best = p;
+        bits |= (unsigned long long)best << (3 * i);
+    }
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+static void EncodeLevel(const unsigned char *rgba, int width, int height, BlockFormat format, CompressedLevel *level)
+{
+    level->width = width;
+    level->height = height;
+    level->data.resize(LevelBytes(format, width, height));
+    unsigned char *out = level->data.data();
+
+    unsigned char block[64], channel[16];
+    for (int by = 0; by < height; by += 4)
+        for (int bx = 0; bx < width; bx += 4)
+        {
+            // texels past the edge repeat the last row and column
+            for (int y = 0; y < 4; ++y)
+                for (int x = 0; x < 4; ++x)
+                    memcpy(&block[4 * (4 * y + x)],
+                           &rgba[4 * (size_t(std::min(by + y, height - 1)) * width + std::min(bx + x, width - 1))], 4);
+
+            if (format == BLOCK_BC1 || format == BLOCK_BC3) {
+                if (format == BLOCK_BC3) {
+                    for (int i = 0; i < 16; ++i) channel[i] = block[4 * i + 3];
+                    EncodeAlphaBlock(channel, out);
+                    out += 8;
+                }
+                EncodeColourBlock(block, format == BLOCK_BC1, out);
+                out += 8;
+            } else {
+                for (int c = 0; c < (format == BLOCK_BC4 ? 1 : 2); ++c) {
+                    for (int i = 0; i < 16; ++i) channel[i] = block[4 * i + c];
+                    EncodeAlphaBlock(channel, out);
+                    out += 8;
+                }
+            }
+        }
+}
+
+// 2x2 box filter; an odd last row or column is averaged with itself
+static void Downsample(const vector<unsigned char> &rgba, int width, int height, vector<unsigned char> *result)
+{
+    int w = std::max(width / 2, 1), h = std::max(height / 2, 1);
+    result->resize(4 * size_t(w) * h);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+        {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            for (int c = 0; c < 4; ++c) {
+                int sum = rgba[4 * (size_t(y0) * width + x0) + c] + rgba[4 * (size_t(y0) * width + x1) + c] +
+                          rgba[4 * (size_t(y1) * width + x0) + c] + rgba[4 * (size_t(y1) * width + x1) + c];
+                (*result)[4 * (size_t(y) * w + x) + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+}
+
+void CompressImage(const unsigned char *rgba, int width, int height, BlockFormat format, bool mipmaps,
+                   CompressedImage *image)
+{
+    image->format = format;
+    image->levels.clear();
+
+    vector<unsigned char> level(rgba, rgba + 4 * size_t(width) * height), next;
+    while (true) {
+        image->levels.push_back(CompressedLevel());
+        EncodeLevel(level.data(), width, height, format, &image->levels.back());
+        if (!mipmaps || (width == 1 && height == 1)) break;
+
+        Downsample(level, width, height, &next);
+        level.swap(next);
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+}
+
+bool ConvertTexture(const string &input, const string &output, BlockFormat format)
+{
+    // OpenGL order, as InitializeTexture() uploads uncompressed images
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, components;
+    unsigned char *pixels = stbi_load(input.c_str(), &width, &height, &components, 4);
+    if (!pixels) {
+        cout << "CompressedTexture ERROR: could not decode " << input << endl;
+        return false;
+    }
+
+    if (format == BLOCK_FORMAT_COUNT) {
+        const BlockFormat BY_CHANNELS[] = { BLOCK_BC4, BLOCK_BC5, BLOCK_BC1, BLOCK_BC3 };
+        format = BY_CHANNELS[components - 1];
+    }
+
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    CompressedImage image;
+    CompressImage(pixels, width, height, format, true, &image);
+    double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+    stbi_image_free(pixels);
+
+    if (!WriteKtx(output, image)) return false;
+    cout << input << ": " << width << "x" << height << ", " << image.levels.size() << " levels as "
+         << BlockFormatName(format) << " in " << seconds * 1e3 << " ms" << endl;
+    cout << "  " << image.Bytes() << " bytes, " << image.UncompressedBytes() << " as RGBA8 ("
+         << double(image.UncompressedBytes()) / image.Bytes() << "x smaller)" << endl;
+    return true;
+}
+
+// --------------------------------------------------------------------------
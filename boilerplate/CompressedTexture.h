@@ -0,0 +1,92 @@
+// ==========================================================================
+// Block-Compressed Textures
+//
+// This module reads, writes and encodes textures in the BC formats GPUs
+// sample directly, which take 4 to 8 times less memory than 8 bit RGBA:
+//  - BC1: RGB at 4 bits per texel, with optional 1 bit alpha
+//  - BC3: RGBA at 8 bits per texel, alpha stored like BC4
+//  - BC4: one channel at 4 bits per texel
+//  - BC5: two channels at 8 bits per texel (normal maps, for example)
+//
+// Files are KTX (version 1) or DDS containers holding a full mip chain.
+// KTX is written by the converter; DDS is read only, as produced by most
+// texture tools. Levels are kept in OpenGL order, bottom row first: DDS
+// files store the top row first and are flipped block by block when read.
+//
+// The encoder fits each 4x4 block's end points to the principal axis of
+// its colours. It is a converter for offline use, not a real-time one.
+// ==========================================================================
+#ifndef COMPRESSEDTEXTURE_H
+#define COMPRESSEDTEXTURE_H
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// --------------------------------------------------------------------------
+
+enum BlockFormat
+{
+    BLOCK_BC1,
+    BLOCK_BC3,
+    BLOCK_BC4,
+    BLOCK_BC5,
+    BLOCK_FORMAT_COUNT
+};
+
+const char *BlockFormatName(BlockFormat format);
+
+// accepts "bc1" to "bc5" in either case
+bool ParseBlockFormat(const std::string &name, BlockFormat *format);
+
+// the OpenGL internal format; BC1 and BC3 need GL_EXT_texture_compression_s3tc
+GLenum BlockInternalFormat(BlockFormat format);
+
+// true if the current context can sample the format
+bool BlockFormatSupported(BlockFormat format);
+
+// bytes per 4x4 block: 8 for BC1 and BC4, 16 for BC3 and BC5
+size_t BlockBytes(BlockFormat format);
+
+struct CompressedLevel
+{
+    int width, height;
+    std::vector<unsigned char> data;    // rows of blocks, bottom row first
+};
+
+struct CompressedImage
+{
+    BlockFormat format;
+    std::vector<CompressedLevel> levels;    // largest first
+
+    CompressedImage() : format(BLOCK_BC1)
+    {}
+
+    size_t Bytes() const;
+
+    // the same levels as 8 bit RGBA, for comparison
+    size_t UncompressedBytes() const;
+};
+
+// --------------------------------------------------------------------------
+
+// true for .ktx and .dds file names
+bool IsCompressedTextureFile(const std::string &filename);
+
+// reads a KTX or DDS file with a BC1, BC3, BC4 or BC5 payload
+bool LoadCompressedImage(const std::string &filename, CompressedImage *image);
+
+bool WriteKtx(const std::string &filename, const CompressedImage &image);
+
+// encodes 8 bit RGBA pixels, bottom row first, with or without a mip chain
+void CompressImage(const unsigned char *rgba, int width, int height, BlockFormat format, bool mipmaps,
+                   CompressedImage *image);
+
+// converts any image stb_image reads into a mipmapped KTX file and reports
+// the memory saved; BLOCK_FORMAT_COUNT picks the format from the image's
+// channels (grey BC4, grey and alpha BC5, RGB BC1, RGBA BC3)
+bool ConvertTexture(const std::string &input, const std::string &output, BlockFormat format);
+
+// --------------------------------------------------------------------------
+#endif // COMPRESSEDTEXTURE_H
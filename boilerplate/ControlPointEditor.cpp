@@ -0,0 +1,173 @@
+// ==========================================================================
+// Interactive Control Point Editing
+//
+// This module defines a ControlPointEditor class that lets control points be
+// dragged while keeping every vertex buffer that mirrors them up to date.
+// Only the coalesced dirty ranges are uploaded, once per frame.
+// ==========================================================================
+
+#include "ControlPointEditor.h"
+#include "GLState.h"
+#include <algorithm>
+#include <map>
+#include <utility>
+
+using namespace std;
+using namespace glm;
+
+// dirty vertices closer than this are uploaded as one range; re-sending a few
+// clean vertices is cheaper than issuing another glBufferSubData call
+static const int MERGE_GAP = 8;
+
+// --------------------------------------------------------------------------
+
+ControlPointEditor::ControlPointEditor()
+    : m_uploadedBytes(0), m_uploadCalls(0)
+{}
+
+void ControlPointEditor::Clear()
+{
+    m_targets.clear();
+    m_points.clear();
+    m_slotStart.clear();
+    m_slots.clear();
+}
+
+void ControlPointEditor::AddTarget(GLuint buffer, vec2 *vertices, size_t count,
+                                   const unsigned int *patchIndices, size_t patchIndexCount)
+{
+    Target target;
+    target.buffer = buffer;
+    target.vertices = vertices;
+    target.count = count;
+
+    if (patchIndices) {
+        target.useStart.assign(count + 1, 0);
+        for (size_t i = 0; i < patchIndexCount; ++i)
+            ++target.useStart[patchIndices[i] + 1];
+        for (size_t v = 0; v < count; ++v)
+            target.useStart[v + 1] += target.useStart[v];
+
+        target.uses.resize(patchIndexCount);
+        vector<int> next(target.useStart.begin(), target.useStart.end() - 1);
+        for (size_t i = 0; i < patchIndexCount; ++i)
+            target.uses[next[patchIndices[i]]++] = int(i);
+    }
+
+    m_targets.push_back(target);
+}
+
+// true if a vertex is only ever the (0,0) fourth vertex of quadratic patches
+static bool QuadraticMarker(const vec2 *vertices, const vector<int> &useStart,
+                            const vector<int> &uses, size_t index)
+{
+    if (useStart.empty() || vertices[index] != vec2(0.0f)) return false;
+    if (useStart[index] == useStart[index + 1]) return false;
+    for (int u = useStart[index]; u < useStart[index + 1]; ++u)
+        if (uses[u] % 4 != 3) return false;
+    return true;
+}
+
+void ControlPointEditor::Build()
+{
+    // assign each distinct position a logical point, remembering every slot
+    map<pair<float, float>, int> ids;
+    vector<int> pointOfSlot;
+    vector<Slot> slots;
+
+    for (size_t t = 0; t < m_targets.size(); ++t)
+    {
+        const vec2 *vertices = m_targets[t].vertices;
+        for (size_t i = 0; i < m_targets[t].count; ++i)
+        {
+            if (QuadraticMarker(vertices, m_targets[t].useStart, m_targets[t].uses, i))
+                continue;
+
+            pair<float, float> key(vertices[i].x, vertices[i].y);
+            map<pair<float, float>, int>::iterator found = ids.find(key);
+            int id;
+            if (found == ids.end()) {
+                id = int(m_points.size());
+                ids[key] = id;
+                m_points.push_back(vertices[i]);
+            }
+            else id = found->second;
+
+            Slot slot = { int(t), int(i) };
+            slots.push_back(slot);
+            pointOfSlot.push_back(id);
+        }
+    }
+
+    // counting sort of the slots by point gives the compressed row layout
+    m_slotStart.assign(m_points.size() + 1, 0);
+    for (size_t s = 0; s < slots.size(); ++s)
+        ++m_slotStart[pointOfSlot[s] + 1];
+    for (size_t p = 0; p < m_points.size(); ++p)
+        m_slotStart[p + 1] += m_slotStart[p];
+
+    m_slots.resize(slots.size());
+    vector<int> next(m_slotStart.begin(), m_slotStart.end() - 1);
+    for (size_t s = 0; s < slots.size(); ++s)
+        m_slots[next[pointOfSlot[s]]++] = slots[s];
+}
+
+// --------------------------------------------------------------------------
+
+int ControlPointEditor::Pick(const vec2 &p, float radius) const
+{
+    int best = -1;
+    float bestDistance = radius * radius;
+    for (size_t i = 0; i < m_points.size(); ++i)
+    {
+        vec2 d = m_points[i] - p;
+        if (dot(d, d) <= bestDistance) {
+            bestDistance = dot(d, d);
+            best = int(i);
+        }
+    }
+    return best;
+}
+
+void ControlPointEditor::Move(int point, const vec2 &position)
+{
+    m_points[point] = position;
+    for (int s = m_slotStart[point]; s < m_slotStart[point + 1]; ++s)
+    {
+        Target &target = m_targets[m_slots[s].target];
+        target.vertices[m_slots[s].index] = position;
+        target.dirty.push_back(m_slots[s].index);
+    }
+}
+
+void ControlPointEditor::Flush()
+{
+    for (size_t t = 0; t < m_targets.size(); ++t)
+    {
+        Target &target = m_targets[t];
+        if (target.dirty.empty()) continue;
+
+        sort(target.dirty.begin(), target.dirty.end());
+        BindBuffer(GL_ARRAY_BUFFER, target.buffer);
+
+        size_t i = 0;
+        while (i < target.dirty.size())
+        {
+            int begin = target.dirty[i];
+            int end = begin + 1;
+            while (++i < target.dirty.size() && target.dirty[i] <= end + MERGE_GAP)
+                end = std::max(end, target.dirty[i] + 1);
+
+            GLsizeiptr bytes = sizeof(vec2) * (end - begin);
+            glBufferSubData(GL_ARRAY_BUFFER, sizeof(vec2) * begin, bytes,
+                            &target.vertices[begin]);
+            m_uploadedBytes += bytes;
+            ++m_uploadCalls;
+        }
+
+        target.dirty.clear();
+    }
+    BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// --------------------------------------------------------------------------
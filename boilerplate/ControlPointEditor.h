@@ -0,0 +1,108 @@
+// ==========================================================================
+// Interactive Control Point Editing
+//
+// This module defines a ControlPointEditor class that lets control points be
+// dragged while keeping every vertex buffer that mirrors them up to date:
+//  - Each logical control point maps to every buffer slot holding a copy of
+//    it, and through the targets' patch indices to every patch it shapes
+//  - Moving a point writes the CPU copies and records the dirty slots
+//  - Once per frame Flush() coalesces dirty slots into ranges and uploads
+//    only those bytes with glBufferSubData
+//
+// Upload cost per frame is proportional to the points moved, not to the size
+// of the scene.
+// ==========================================================================
+#ifndef CONTROLPOINTEDITOR_H
+#define CONTROLPOINTEDITOR_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// --------------------------------------------------------------------------
+
+class ControlPointEditor
+{
+    // a vertex buffer and the CPU array it was uploaded from
+    struct Target
+    {
+        GLuint buffer;
+        glm::vec2 *vertices;
+        size_t count;
+        std::vector<int> dirty;     // vertex indices written since last Flush
+
+        // positions in the patch index list using each vertex, in the same
+        // compressed row form as the slots below; empty without patch indices
+        std::vector<int> useStart;
+        std::vector<int> uses;
+    };
+
+    // a place a logical control point is stored
+    struct Slot
+    {
+        int target;
+        int index;
+    };
+
+    std::vector<Target> m_targets;
+
+    // logical points, and their slots in compressed row form:
+    // the slots of point i are m_slots[m_slotStart[i] .. m_slotStart[i+1])
+    std::vector<glm::vec2> m_points;
+    std::vector<int> m_slotStart;
+    std::vector<Slot> m_slots;
+
+    size_t m_uploadedBytes;
+    size_t m_uploadCalls;
+
+public:
+    ControlPointEditor();
+
+    // forgets all targets and points
+    void Clear();
+
+    // registers a buffer whose contents mirror count vertices; patchIndices,
+    // if given, lists 4 vertices per Bezier patch, so quadratic markers are
+    // never treated as points and patches can be found from their points
+    void AddTarget(GLuint buffer, glm::vec2 *vertices, size_t count,
+                   const unsigned int *patchIndices = 0, size_t patchIndexCount = 0);
+
+    // builds the logical point map: vertices at identical positions in any
+    // target are the same control point and move together
+    void Build();
+
+    // returns the logical point within radius of p closest to it, or -1
+    int Pick(const glm::vec2 &p, float radius) const;
+
+    // moves a logical point, updating every CPU copy and marking it dirty
+    void Move(int point, const glm::vec2 &position);
+
+    // uploads the coalesced dirty ranges of every target
+    void Flush();
+
+    // calls visit(patch) for every patch a point shapes, so callers can
+    // refresh derived data such as a SegmentBVH
+    template <typename Visitor>
+    void ForEachPatch(int point, Visitor visit) const
+    {
+        for (int s = m_slotStart[point]; s < m_slotStart[point + 1]; ++s)
+        {
+            const Target &target = m_targets[m_slots[s].target];
+            if (target.useStart.empty()) continue;
+            int index = m_slots[s].index;
+            for (int u = target.useStart[index]; u < target.useStart[index + 1]; ++u)
+                visit(target.uses[u] / 4);
+        }
+    }
+
+    size_t PointCount() const { return m_points.size(); }
+    const glm::vec2 &Point(int point) const { return m_points[point]; }
+
+    // running totals, for checking that drags stay cheap
+    size_t UploadedBytes() const { return m_uploadedBytes; }
+    size_t UploadCalls() const { return m_uploadCalls; }
+};
+
+// --------------------------------------------------------------------------
+#endif // CONTROLPOINTEDITOR_H
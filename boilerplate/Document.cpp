@@ -0,0 +1,422 @@
+// ==========================================================================
+// Virtualized Document Viewer
+//
+// This module defines a Document class that renders arbitrarily large text
+// files through the Bezier patch pipeline. Only the lines in view (plus a
+// prefetch margin on either side) are resident on the GPU.
+// ==========================================================================
+
+#include "Document.h"
+#include "Bezier.h"
+#include "Stroke.h"
+#include "GLState.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+using namespace std;
+using namespace glm;
+
+// paragraphs longer than this are laid out in pieces, broken at a space, so
+// reaching a line never lays out, or searches, more than this much text
+static const size_t MAX_PARAGRAPH_BYTES = 16384;
+
+// --------------------------------------------------------------------------
+
+Document::Document()
+    : m_windowBegin(0), m_windowEnd(0), m_windowLines(0), m_firstLine(0), m_lineHeight(1.2f), m_fontScale(0.05f),
+      m_origin(-0.95f, 0.95f), m_scroll(0), m_viewLines(1), m_prefetch(8),
+      m_vertexBuffer(0), m_vertexArray(0), m_patchTexture(0), m_slotCapacity(0)
+{
+    m_layout.SetText(m_text);
+    m_layout.SetWidth(40.0f);
+}
+
+bool Document::Initialize(const vector<string> &fontFiles, int slotCount, int slotCapacity)
+{
+    if (!m_fonts.AddFonts(fontFiles))
+        return false;
+    m_layout.SetFonts(&m_fonts);
+
+    // every slot holds whole patches
+    m_slotCapacity = slotCapacity - slotCapacity % 4;
+    m_slots.assign(slotCount, LineSlot());
+
+    glGenBuffers(1, &m_vertexBuffer);
+    glGenVertexArrays(1, &m_vertexArray);
+    BindVertexArray(m_vertexArray);
+
+    BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * m_slotCapacity * slotCount, 0, GL_DYNAMIC_DRAW);
+    CountGpuBuffer(MEMORY_LAYOUT, m_vertexBuffer, sizeof(vec2) * m_slotCapacity * slotCount);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+    glEnableVertexAttribArray(0);
+
+    // colour attribute stays disabled; Render() sets a constant value instead
+    BindBuffer(GL_ARRAY_BUFFER, 0);
+    BindVertexArray(0);
+
+    m_patchTexture = CreatePatchTexture(m_vertexBuffer);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void Document::Destroy()
+{
+    DeleteVertexArrays(1, &m_vertexArray);
+    ForgetGpuBuffer(m_vertexBuffer);
+    DeleteBuffers(1, &m_vertexBuffer);
+    DeleteTextures(1, &m_patchTexture);
+    m_vertexArray = m_vertexBuffer = m_patchTexture = 0;
+}
+
+// --------------------------------------------------------------------------
+
+void Document::SetText(const string &text)
+{
+    m_text = text;
+    m_layout.SetText(m_text);
+    m_windowBegin = m_windowEnd = m_windowLines = 0;
+    m_firstLine = 0;
+    m_lines.clear();
+    m_scroll = 0;
+    for (size_t i = 0; i < m_slots.size(); ++i)
+        m_slots[i] = LineSlot();
+}
+
+bool Document::LoadFile(const string &filename)
+{
+    ifstream input(filename.c_str(), ios::binary);
+    if (!input) {
+        cout << "Document ERROR: could not open " << filename << endl;
+        return false;
+    }
+    SetText(string(istreambuf_iterator<char>(input), istreambuf_iterator<char>()));
+    return true;
+}
+
+void Document::SetLayout(float fontScale, float wrapWidth, const vec2 &origin)
+{
+    // lines are laid out in EMs, so only the wrap width changes line breaks
+    m_fontScale = fontScale;
+    m_origin = origin;
+    SetWrapWidth(wrapWidth);
+}
+
+size_t Document::SetWrapWidth(float width)
+{
+    if (width == m_layout.Width()) return 0;
+    m_layout.SetWidth(width);
+    return Reflow();
+}
+
+size_t Document::SetAlignment(TextAlignment alignment)
+{
+    if (alignment == m_layout.Alignment()) return 0;
+    m_layout.SetAlignment(alignment);
+    return Reflow();
+}
+
+size_t Document::SetLineBreaking(LineBreaking breaking)
+{
+    if (breaking == m_layout.Breaking()) return 0;
+    m_layout.SetLineBreaking(breaking);
+    return Reflow();
+}
+
+size_t Document::SetHyphenator(const Hyphenator &hyphenator)
+{
+    m_layout.SetHyphenator(hyphenator);
+    return Reflow();
+}
+
+void Document::SetViewHeight(float worldHeight)
+{
+    m_viewLines = std::max(1, int(ceil(worldHeight / (m_lineHeight * m_fontScale))) + 1);
+}
+
+void Document::Scroll(double lines)
+{
+    m_scroll += lines;
+}
+
+// --------------------------------------------------------------------------
+
+const Document::CachedGlyph &Document::Glyph(unsigned int codepoint)
+{
+    CachedGlyph &glyph = codepoint < 128 ? m_glyphs[codepoint] : m_wideGlyphs[codepoint];
+    if (!glyph.loaded)
+    {
+        glyph.loaded = true;
+        if (codepoint >= 32)
+        {
+            MyGlyph outline = m_fonts.ExtractGlyph(codepoint);
+            vector<vec2> patches;
+            for (size_t i = 0; i < outline.contours.size(); ++i)
+                for (size_t j = 0; j < outline.contours[i].size(); ++j)
+                    AppendCubicPatch(outline.contours[i][j], &patches);
+            glyph.patches.assign(patches.begin(), patches.end());
+        }
+    }
+    return glyph;
+}
+
+size_t Document::ParagraphAfter(size_t begin, size_t *end) const
+{
+    // the search stops where a piece would be cut, so one long line is not
+    // searched again for every piece of it
+    size_t limit = std::min(m_text.size(), begin + MAX_PARAGRAPH_BYTES + 1);
+    const char *found = (const char *)memchr(m_text.data() + begin, '\n', limit - begin);
+    if (found) {
+        *end = found - m_text.data();
+        return *end + 1;
+    }
+    if (limit == m_text.size()) {
+        *end = m_text.size();
+        return *end;
+    }
+
+    // the piece keeps the space it breaks at, or ends on a character boundary
+    *end = m_text.rfind(' ', begin + MAX_PARAGRAPH_BYTES);
+    if (*end != string::npos && *end > begin) ++*end;
+    else {
+        *end = begin + MAX_PARAGRAPH_BYTES;
+        while (*end > begin + 1 && (m_text[*end] & 0xC0) == 0x80) --*end;
+    }
+    return *end;
+}
+
+size_t Document::ParagraphBefore(size_t next, size_t *end) const
+{
+    // pieces are only known counting from the start of their line of text
+    size_t lineEnd = next >= 2 ? m_text.rfind('\n', next - 2) : string::npos;
+    size_t begin = lineEnd == string::npos ? 0 : lineEnd + 1;
+    for (size_t after = ParagraphAfter(begin, end); after < next; after = ParagraphAfter(begin, end))
+        begin = after;
+    return begin;
+}
+
+void Document::WantedLines(long *lo, long *hi) const
+{
+    // the view plus a prefetch margin either side, never more than the
+    // slots we have
+    long first = long(floor(m_scroll));
+    *lo = first - m_prefetch;
+    *hi = std::min(first + m_viewLines + m_prefetch, *lo + long(m_slots.size()) - 1);
+}
+
+void Document::FillWindow(long lo, long hi)
+{
+    // a long scroll passes through any number of paragraphs, so those it
+    // leaves behind are dropped as it goes
+    while (m_firstLine + long(m_windowLines) <= hi && m_windowEnd < m_text.size())
+    {
+        size_t end, next = ParagraphAfter(m_windowEnd, &end);
+        size_t paragraph = m_layout.AddParagraph(m_windowEnd, end);
+        m_windowLines += m_layout.Lines(paragraph).size();
+        m_windowEnd = next;
+        DropOutside(lo, hi);
+    }
+    while (m_firstLine > lo && m_windowBegin > 0)
+    {
+        size_t end, begin = ParagraphBefore(m_windowBegin, &end);
+        m_layout.InsertParagraph(begin, end);
+        size_t lines = m_layout.Lines(0).size();
+        m_windowLines += lines;
+        m_firstLine -= long(lines);
+        m_windowBegin = begin;
+        DropOutside(lo, hi);
+    }
+    DropOutside(lo, hi);
+    IndexLines();
+}
+
+void Document::DropOutside(long lo, long hi)
+{
+    // another prefetch margin is kept, so scrolling back and forth over a
+    // paragraph's edge does not lay it out again and again
+    while (m_layout.ParagraphCount() > 1)
+    {
+        size_t lines = m_layout.Lines(0).size();
+        if (m_firstLine + long(lines) > lo - m_prefetch) break;
+        m_layout.RemoveParagraphs(0, 1);
+        m_windowBegin = m_layout.ParagraphBegin(0);
+        m_windowLines -= lines;
+        m_firstLine += long(lines);
+    }
+    while (m_layout.ParagraphCount() > 1)
+    {
+        size_t last = m_layout.ParagraphCount() - 1;
+        size_t lines = m_layout.Lines(last).size();
+        if (m_firstLine + long(m_windowLines - lines) <= hi + m_prefetch) break;
+        m_windowEnd = m_layout.ParagraphBegin(last);
+        m_layout.RemoveParagraphs(last, 1);
+        m_windowLines -= lines;
+    }
+}
+
+void Document::IndexLines()
+{
+    m_lines.clear();
+    for (size_t p = 0; p < m_layout.ParagraphCount(); ++p)
+    {
+        LineRef ref = {p, 0};
+        for (size_t count = m_layout.Lines(p).size(); ref.line < count; ++ref.line)
+            m_lines.push_back(ref);
+    }
+}
+
+size_t Document::Reflow()
+{
+    unsigned long long broken = m_layout.Stats().paragraphsBroken;
+    for (size_t i = 0; i < m_slots.size(); ++i)
+        m_slots[i] = LineSlot();
+    if (m_lines.empty()) return 0;
+
+    // the lines are still indexed as they were: find the top line and the
+    // paragraphs the view and prefetch margins showed, and drop the others
+    long lo, hi;
+    WantedLines(&lo, &hi);
+    long first = long(floor(m_scroll));
+    long lastIndex = long(m_lines.size()) - 1;
+    LineRef top = m_lines[std::min(std::max(first - m_firstLine, 0L), lastIndex)];
+    size_t keepFirst = m_lines[std::min(std::max(lo - m_firstLine, 0L), lastIndex)].paragraph;
+    size_t keepLast = m_lines[std::min(std::max(hi - m_firstLine, 0L), lastIndex)].paragraph;
+    if (keepLast + 1 < m_layout.ParagraphCount()) {
+        m_windowEnd = m_layout.ParagraphBegin(keepLast + 1);
+        m_layout.RemoveParagraphs(keepLast + 1, m_layout.ParagraphCount() - keepLast - 1);
+    }
+    if (keepFirst > 0) {
+        m_layout.RemoveParagraphs(0, keepFirst);
+        m_windowBegin = m_layout.ParagraphBegin(0);
+        top.paragraph -= keepFirst;
+    }
+
+    // break those again, numbering the lines so the top line keeps its number
+    long before = 0;
+    m_windowLines = 0;
+    for (size_t p = 0; p < m_layout.ParagraphCount(); ++p)
+    {
+        size_t lines = m_layout.Lines(p).size();
+        if (p < top.paragraph) before += long(lines);
+        else if (p == top.paragraph) before += long(std::min(top.line, lines - 1));
+        m_windowLines += lines;
+    }
+    m_firstLine = first - before;
+
+    FillWindow(lo, hi);
+    return size_t(m_layout.Stats().paragraphsBroken - broken);
+}
+
+// --------------------------------------------------------------------------
+
+void Document::UploadLine(long line, LineSlot *slot, size_t slotIndex)
+{
+    const LineRef &ref = m_lines[line - m_firstLine];
+    m_layout.PlaceGlyphs(ref.paragraph, ref.line, &m_placed);
+
+    m_scratch.clear();
+    for (size_t i = 0; i < m_placed.size(); ++i)
+    {
+        const CachedGlyph &glyph = Glyph(m_placed[i].codepoint);
+        for (size_t k = 0; k < glyph.patches.size(); ++k)
+            m_scratch.push_back(glyph.patches[k] + vec2(m_placed[i].x, 0));
+    }
+
+    if (m_scratch.size() > size_t(m_slotCapacity)) {
+        cout << "Document WARNING: line " << line << " truncated to "
+             << m_slotCapacity / 4 << " patches" << endl;
+        m_scratch.resize(m_slotCapacity);
+    }
+
+    slot->line = line;
+    slot->used = true;
+    slot->count = m_scratch.size();
+    if (slot->count == 0) return;
+
+    BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(vec2) * m_slotCapacity * slotIndex,
+                    sizeof(vec2) * slot->count, m_scratch.data());
+    BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Document::Update()
+{
+    if (m_text.empty() || m_slots.empty()) return;
+
+    long lo, hi;
+    WantedLines(&lo, &hi);
+    FillWindow(lo, hi);
+
+    // keep the view between the first line of the document and its last
+    long first = long(floor(m_scroll));
+    long last = m_firstLine + long(m_lines.size()) - 1;
+    if (m_windowBegin == 0 && first < m_firstLine) {
+        m_scroll = double(m_firstLine);
+        Update();
+        return;
+    }
+    if (m_windowEnd >= m_text.size() && first > last) {
+        m_scroll = double(last);
+        Update();
+        return;
+    }
+    if (m_lines.empty()) return;
+    lo = std::max(lo, m_firstLine);
+    hi = std::min(hi, last);
+
+    // recycle slots that fell out of range, and note which lines are resident
+    vector<bool> resident(hi - lo + 1, false);
+    for (size_t s = 0; s < m_slots.size(); ++s)
+    {
+        if (!m_slots[s].used) continue;
+        long line = m_slots[s].line;
+        if (line < lo || line > hi)
+            m_slots[s] = LineSlot();
+        else
+            resident[line - lo] = true;
+    }
+
+    // fill free slots with the lines that scrolled into range
+    size_t s = 0;
+    for (long line = lo; line <= hi; ++line)
+    {
+        if (resident[line - lo]) continue;
+        while (s < m_slots.size() && m_slots[s].used) ++s;
+        if (s == m_slots.size()) break;
+        UploadLine(line, &m_slots[s], s);
+    }
+}
+
+void Document::Render(GLuint program) const
+{
+    GLint modelLocation = UniformLocation(program, "model");
+    long first = long(floor(m_scroll));
+    long last = first + m_viewLines;
+
+    UseProgram(program);
+    BindVertexArray(m_vertexArray);
+    SetPatchVertices(4);
+    glVertexAttrib3f(1, 0.9f, 0.9f, 0.9f);
+
+    for (size_t s = 0; s < m_slots.size(); ++s)
+    {
+        const LineSlot &slot = m_slots[s];
+        if (!slot.used || slot.line < first || slot.line > last || slot.count == 0) continue;
+
+        // baseline of this line relative to the (fractional) scroll position
+        float y = m_origin.y - m_fontScale * (m_lineHeight * float(slot.line - m_scroll) + 1.0f);
+        mat4 model = translate(mat4(1.0f), vec3(m_origin.x, y, 0.0f));
+        model = scale(model, vec3(m_fontScale, m_fontScale, 1.0f));
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, value_ptr(model));
+        SetStrokePatches(program, m_patchTexture, GLint(s * m_slotCapacity / 4), slot.count / 4);
+
+        glDrawArrays(GL_PATCHES, GLint(s * m_slotCapacity), slot.count);
+    }
+}
+
+// --------------------------------------------------------------------------
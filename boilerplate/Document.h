@@ -0,0 +1,185 @@
+// ==========================================================================
+// Virtualized Document Viewer
+//
+// This module defines a Document class that renders arbitrarily large text
+// files through the Bezier patch pipeline. Only the lines in view (plus a
+// prefetch margin on either side) are resident on the GPU:
+//  - Text is UTF-8; characters the first font lacks come from the next font
+//    in a fallback chain (see FontSet.h)
+//  - Only the paragraphs around the view are laid out, by a ParagraphLayout:
+//    greedy or optimal line breaks, aligned left, centred or justified (see
+//    ParagraphLayout.h). Paragraphs are laid out as scrolling reaches them
+//    and dropped once it has left them behind
+//  - Changing the width or the settings re-flows the paragraphs around the
+//    view from their cached word widths and keeps the top line in view; the
+//    rest are laid out again when scrolled to
+//  - A single vertex buffer is split into fixed-size line slots; slots of
+//    lines that scroll out of range are recycled for the incoming lines
+//  - Each glyph outline is extracted and converted to patches once, then
+//    copied into every line that uses it
+//
+// Line numbers are counted from wherever the view happened to be when the
+// layout last changed, since the lines before it are not laid out; they go
+// below zero when scrolling back past that point.
+//
+// Scrolling and re-flow cost therefore depend on the viewport, never on the
+// document length; memory beyond the text does too, and GPU memory is
+// slotCount * slotCapacity vertices.
+// ==========================================================================
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "FontSet.h"
+#include "ParagraphLayout.h"
+
+// --------------------------------------------------------------------------
+// This class owns the text, the layout of the paragraphs around the view and
+// the slot buffer.
+
+class Document
+{
+    // patch vertices for one character, in EM units relative to the pen
+    struct CachedGlyph
+    {
+        bool loaded;
+        CountedVector<glm::vec2, MEMORY_GLYPHS> patches;
+
+        CachedGlyph() : loaded(false)
+        {}
+    };
+
+    // a line of one of the laid out paragraphs
+    struct LineRef
+    {
+        size_t paragraph;
+        size_t line;
+    };
+
+    // a region of the vertex buffer holding one laid out line
+    struct LineSlot
+    {
+        long line;          // line held here
+        bool used;
+        GLsizei count;      // number of patch vertices in use
+
+        LineSlot() : line(0), used(false), count(0)
+        {}
+    };
+
+    FontSet m_fonts;
+    CachedGlyph m_glyphs[128];                              // ASCII
+    std::unordered_map<unsigned int, CachedGlyph, std::hash<unsigned int>, std::equal_to<unsigned int>,
+                       CountingAllocator<std::pair<const unsigned int, CachedGlyph>, MEMORY_GLYPHS> >
+        m_wideGlyphs;                                       // everything else
+
+    std::string m_text;
+
+    // the window: consecutive paragraphs around the view, which cover the
+    // bytes from m_windowBegin up to m_windowEnd and hold m_windowLines
+    // lines, numbered on from m_firstLine; m_lines indexes them
+    ParagraphLayout m_layout;
+    size_t m_windowBegin, m_windowEnd;
+    size_t m_windowLines;
+    long m_firstLine;
+    CountedVector<LineRef, MEMORY_LAYOUT> m_lines;
+
+    // layout parameters, in EM units
+    float m_lineHeight;
+    float m_fontScale;      // world units per EM
+    glm::vec2 m_origin;     // world position of the top left corner
+
+    // scroll position as a (fractional) line number, view height in lines,
+    // and the lines laid out either side of the view
+    double m_scroll;
+    int m_viewLines;
+    int m_prefetch;
+
+    GLuint m_vertexBuffer;
+    GLuint m_vertexArray;
+    GLuint m_patchTexture;      // view of m_vertexBuffer for thick strokes
+    GLsizei m_slotCapacity;
+    CountedVector<LineSlot, MEMORY_LAYOUT> m_slots;
+
+    // scratch space reused for building line vertices
+    CountedVector<glm::vec2, MEMORY_LAYOUT> m_scratch;
+    std::vector<PlacedGlyph> m_placed;
+
+    const CachedGlyph &Glyph(unsigned int codepoint);
+
+    // where the paragraph starting at begin ends, and where the next starts;
+    // and where the one before the paragraph starting at next starts
+    size_t ParagraphAfter(size_t begin, size_t *end) const;
+    size_t ParagraphBefore(size_t next, size_t *end) const;
+
+    // the lines wanted resident: the view plus the prefetch margin
+    void WantedLines(long *lo, long *hi) const;
+
+    // lays out paragraphs until the window covers lines lo to hi, as far as
+    // the text goes, drops those well outside and re-indexes the lines
+    void FillWindow(long lo, long hi);
+    void DropOutside(long lo, long hi);
+    void IndexLines();
+
+    // re-breaks the window after a layout change, keeping the top line in
+    // view; returns the number of paragraphs broken again
+    size_t Reflow();
+
+    // lays out one line into a slot and uploads it
+    void UploadLine(long line, LineSlot *slot, size_t slotIndex);
+
+public:
+    Document();
+
+    // loads the fallback chain of fonts, first choice first, and allocates
+    // slotCount slots of slotCapacity vertices
+    bool Initialize(const std::vector<std::string> &fontFiles, int slotCount, int slotCapacity);
+
+    // deallocates GPU resources
+    void Destroy();
+
+    // replaces the document text, discarding the line index and slots
+    void SetText(const std::string &text);
+    bool LoadFile(const std::string &filename);
+
+    // sets the world units per EM, wrap width and top left corner
+    void SetLayout(float fontScale, float wrapWidth, const glm::vec2 &origin);
+
+    // change how lines are broken, re-flowing the paragraphs around the
+    // view; each returns the number of paragraphs broken again
+    size_t SetWrapWidth(float width);
+    size_t SetAlignment(TextAlignment alignment);
+    size_t SetLineBreaking(LineBreaking breaking);
+    size_t SetHyphenator(const Hyphenator &hyphenator);
+
+    float WrapWidth() const { return m_layout.Width(); }
+    TextAlignment Alignment() const { return m_layout.Alignment(); }
+    LineBreaking Breaking() const { return m_layout.Breaking(); }
+
+    // sets the height of the view in world units
+    void SetViewHeight(float worldHeight);
+
+    // scrolls by a (fractional) number of lines; Update() clamps the
+    // position to the document
+    void Scroll(double lines);
+
+    // lays out newly reached paragraphs and refills recycled slots
+    void Update();
+
+    // draws resident lines in view with a patch program taking a "model" uniform
+    void Render(GLuint program) const;
+
+    bool Empty() const { return m_text.empty(); }
+    size_t LinesResident() const { return m_lines.size(); }
+    size_t ParagraphsResident() const { return m_layout.ParagraphCount(); }
+    size_t ByteSize() const { return m_text.size(); }
+};
+
+// --------------------------------------------------------------------------
+#endif // DOCUMENT_H
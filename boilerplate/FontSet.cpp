@@ -0,0 +1,196 @@
+// ==========================================================================
+// UTF-8 Text and Font Fallback
+//
+// UTF-8 decoding and the codepoint -> (font, glyph index) cache used by
+// everything that turns text into outlines.
+// ==========================================================================
+
+#include "FontSet.h"
+#include <iostream>
+
+using namespace std;
+
+// never a valid codepoint, marks unused table entries
+static const unsigned int EMPTY_CODEPOINT = 0xFFFFFFFFu;
+
+static const size_t INITIAL_CAPACITY = 256;
+
+// --------------------------------------------------------------------------
+// UTF-8 decoding
+
+size_t DecodeUtf8(const string &text, size_t offset, unsigned int *codepoint)
+{
+    unsigned char lead = text[offset];
+    *codepoint = REPLACEMENT_CHARACTER;
+
+    if (lead < 0x80) {
+        *codepoint = lead;
+        return 1;
+    }
+
+    // length of the sequence and smallest codepoint it may encode
+    size_t length;
+    unsigned int value, minimum;
+    if ((lead & 0xE0) == 0xC0)      { length = 2; value = lead & 0x1F; minimum = 0x80; }
+    else if ((lead & 0xF0) == 0xE0) { length = 3; value = lead & 0x0F; minimum = 0x800; }
+    else if ((lead & 0xF8) == 0xF0) { length = 4; value = lead & 0x07; minimum = 0x10000; }
+    else return 1;
+
+    if (offset + length > text.size()) return 1;
+    for (size_t i = 1; i < length; ++i)
+    {
+        unsigned char next = text[offset + i];
+        if ((next & 0xC0) != 0x80) return 1;
+        value = (value << 6) | (next & 0x3F);
+    }
+
+    if (value < minimum || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF))
+        return 1;
+
+    *codepoint = value;
+    return length;
+}
+
+vector<unsigned int> DecodeUtf8(const string &text)
+{
+    vector<unsigned int> codepoints;
+    codepoints.reserve(text.size());
+    for (size_t i = 0; i < text.size(); )
+    {
+        unsigned int codepoint;
+        i += DecodeUtf8(text, i, &codepoint);
+        codepoints.push_back(codepoint);
+    }
+    return codepoints;
+}
+
+// --------------------------------------------------------------------------
+
+// multiplicative (Fibonacci) hashing: the top bits of the 32 bit product
+// depend on every bit of the codepoint, so they pick the slot; the low
+// bits would only depend on the codepoint's low bits
+static size_t Slot(unsigned int codepoint, int shift)
+{
+    return (codepoint * 2654435761u) >> shift;
+}
+
+// how far to shift the product to keep log2(capacity) bits
+static int SlotShift(size_t capacity)
+{
+    int shift = 32;
+    for (; capacity > 1; capacity >>= 1)
+        --shift;
+    return shift;
+}
+
+FontSet::FontSet()
+    : m_count(0), m_shift(SlotShift(INITIAL_CAPACITY))
+{
+    Entry empty = { EMPTY_CODEPOINT, GlyphRef() };
+    m_table.assign(INITIAL_CAPACITY, empty);
+}
+
+FontSet::~FontSet()
+{
+    for (size_t i = 0; i < m_faces.size(); ++i)
+        delete m_faces[i];
+}
+
+bool FontSet::AddFont(const string &filename)
+{
+    GlyphExtractor *face = new GlyphExtractor();
+    if (!face->LoadFontFile(filename)) {
+        delete face;
+        return false;
+    }
+    m_faces.push_back(face);
+
+    // codepoints that fell through to the missing glyph may be covered now
+    Entry empty = { EMPTY_CODEPOINT, GlyphRef() };
+    m_table.assign(m_table.size(), empty);
+    m_count = 0;
+    return true;
+}
+
+bool FontSet::AddFonts(const vector<string> &filenames)
+{
+    for (size_t i = 0; i < filenames.size(); ++i)
+        if (!AddFont(filenames[i]))
+            cout << "FontSet WARNING: skipping " << filenames[i] << " in fallback chain" << endl;
+    return !m_faces.empty();
+}
+
+// --------------------------------------------------------------------------
+
+void FontSet::Grow() const
+{
+    Table old;
+    old.swap(m_table);
+
+    Entry empty = { EMPTY_CODEPOINT, GlyphRef() };
+    m_table.assign(old.size() * 2, empty);
+    size_t mask = m_table.size() - 1;
+    m_shift = SlotShift(m_table.size());
+
+    for (size_t i = 0; i < old.size(); ++i)
+    {
+        if (old[i].codepoint == EMPTY_CODEPOINT) continue;
+        size_t slot = Slot(old[i].codepoint, m_shift);
+        while (m_table[slot].codepoint != EMPTY_CODEPOINT)
+            slot = (slot + 1) & mask;
+        m_table[slot] = old[i];
+    }
+}
+
+GlyphRef FontSet::Resolve(unsigned int codepoint) const
+{
+    if (codepoint > 0x10FFFF) codepoint = REPLACEMENT_CHARACTER;
+
+    size_t mask = m_table.size() - 1;
+    size_t slot = Slot(codepoint, m_shift);
+    while (m_table[slot].codepoint != EMPTY_CODEPOINT)
+    {
+        if (m_table[slot].codepoint == codepoint)
+            return m_table[slot].glyph;
+        slot = (slot + 1) & mask;
+    }
+
+    // first request: walk the chain once
+    GlyphRef glyph;
+    for (size_t face = 0; face < m_faces.size(); ++face)
+    {
+        unsigned int index = m_faces[face]->GlyphIndex(codepoint);
+        if (index != 0) {
+            glyph = GlyphRef(int(face), index);
+            break;
+        }
+    }
+
+    Entry entry = { codepoint, glyph };
+    m_table[slot] = entry;
+    if (++m_count * 2 > m_table.size())
+        Grow();
+
+    return glyph;
+}
+
+MyGlyph FontSet::ExtractGlyph(unsigned int codepoint) const
+{
+    if (m_faces.empty()) {
+        cout << "FontSet ERROR: No font loaded!" << endl;
+        return MyGlyph();
+    }
+    GlyphRef glyph = Resolve(codepoint);
+    return m_faces[glyph.face]->ExtractGlyphIndex(glyph.index);
+}
+
+const MyGlyphMetrics &FontSet::Metrics(unsigned int codepoint) const
+{
+    static const MyGlyphMetrics none;
+    if (m_faces.empty()) return none;
+
+    GlyphRef glyph = Resolve(codepoint);
+    return m_faces[glyph.face]->MetricsIndex(glyph.index);
+}
+
+// --------------------------------------------------------------------------
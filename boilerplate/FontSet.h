@@ -0,0 +1,96 @@
+// ==========================================================================
+// UTF-8 Text and Font Fallback
+//
+// This module decodes UTF-8 text and resolves each codepoint to a glyph in a
+// chain of fonts, for example Lora -> Source Sans Pro -> Inconsolata. The
+// first font covering a codepoint wins; codepoints no font covers resolve to
+// the missing glyph of the first font.
+//
+// Resolutions are cached in a flat open addressing table over the whole
+// chain, so after the first request a codepoint costs one hash probe rather
+// than a character map walk in every font.
+// ==========================================================================
+#ifndef FONTSET_H
+#define FONTSET_H
+
+#include <string>
+#include <vector>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// UTF-8 decoding
+
+// substituted for malformed input
+const unsigned int REPLACEMENT_CHARACTER = 0xFFFD;
+
+// decodes the sequence starting at text[offset] into codepoint and returns
+// the number of bytes it used (at least 1). Malformed, overlong, truncated
+// and surrogate sequences decode to REPLACEMENT_CHARACTER using one byte.
+size_t DecodeUtf8(const std::string &text, size_t offset, unsigned int *codepoint);
+
+// decodes a whole string
+std::vector<unsigned int> DecodeUtf8(const std::string &text);
+
+// --------------------------------------------------------------------------
+// A glyph of one of the fonts in a FontSet
+
+struct GlyphRef
+{
+    int face;               // position of the font in the fallback chain
+    unsigned int index;     // glyph index within that font
+
+    GlyphRef(int f = 0, unsigned int i = 0) : face(f), index(i)
+    {}
+};
+
+// --------------------------------------------------------------------------
+
+class FontSet
+{
+    std::vector<GlyphExtractor*> m_faces;
+
+    // open addressing table with linear probing; capacity is a power of two
+    // and kept at most half full
+    struct Entry
+    {
+        unsigned int codepoint;     // EMPTY_CODEPOINT if unused
+        GlyphRef glyph;
+    };
+    typedef CountedVector<Entry, MEMORY_GLYPHS> Table;
+    mutable Table m_table;
+    mutable size_t m_count;
+    mutable int m_shift;            // 32 - log2(capacity), for the slot hash
+
+    void Grow() const;
+
+    // not copyable, the fonts are owned
+    FontSet(const FontSet &);
+    FontSet &operator=(const FontSet &);
+
+public:
+    FontSet();
+    ~FontSet();
+
+    // appends a font to the end of the fallback chain
+    bool AddFont(const std::string &filename);
+
+    // loads each file in order, skipping (and reporting) any that fail;
+    // returns true if at least one font loaded
+    bool AddFonts(const std::vector<std::string> &filenames);
+
+    int FaceCount() const { return int(m_faces.size()); }
+    const GlyphExtractor &Face(int face) const { return *m_faces[face]; }
+
+    // the font and glyph drawn for a codepoint
+    GlyphRef Resolve(unsigned int codepoint) const;
+
+    MyGlyph ExtractGlyph(unsigned int codepoint) const;
+    const MyGlyphMetrics &Metrics(unsigned int codepoint) const;
+
+    // number of codepoints resolved so far
+    size_t CachedCount() const { return m_count; }
+};
+
+// --------------------------------------------------------------------------
+#endif // FONTSET_H
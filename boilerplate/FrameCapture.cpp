@@ -0,0 +1,266 @@
+// ==========================================================================
+// Frame Capture
+//
+// Pack buffer ring on the GL thread, encoder pool behind it. Pixel buffers
+// are recycled through a pool, so a long recording does not allocate a
+// frame's worth of memory per frame.
+// ==========================================================================
+
+#include "FrameCapture.h"
+#include "GLState.h"
+
+#include <stb/stb_image_write.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// frames allowed to wait for an encoder before the renderer waits too
+static const size_t QUEUED_FRAMES_PER_WORKER = 4;
+
+static double Now()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// --------------------------------------------------------------------------
+
+FrameCapture::FrameCapture()
+    : m_next(0), m_encoding(0), m_written(0), m_stop(false), m_maxQueued(0), m_recording(false),
+      m_format(CAPTURE_PNG), m_frame(0), m_readbackWaits(0), m_encoderWaits(0), m_startTime(0)
+{
+    for (int i = 0; i < RING_SIZE; ++i) {
+        m_ring[i].buffer = 0;
+        m_ring[i].bufferBytes = 0;
+        m_ring[i].fence = 0;
+    }
+}
+
+FrameCapture::~FrameCapture()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+        m_workers[i].join();
+    for (size_t i = 0; i < m_pool.size(); ++i)
+        delete m_pool[i];
+}
+
+bool FrameCapture::Initialize(int workers)
+{
+    if (workers <= 0) workers = std::max(1, int(thread::hardware_concurrency()) - 1);
+    m_maxQueued = QUEUED_FRAMES_PER_WORKER * workers;
+
+    for (int i = 0; i < RING_SIZE; ++i)
+        glGenBuffers(1, &m_ring[i].buffer);
+
+    m_stop = false;
+    for (int i = 0; i < workers; ++i)
+        m_workers.push_back(thread(&FrameCapture::Encode, this));
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void FrameCapture::Destroy()
+{
+    if (m_recording) End();
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+        m_workers[i].join();
+    m_workers.clear();
+    for (size_t i = 0; i < m_pool.size(); ++i)
+        delete m_pool[i];
+    m_pool.clear();
+
+    for (int i = 0; i < RING_SIZE; ++i) {
+        ForgetGpuBuffer(m_ring[i].buffer);
+        DeleteBuffers(1, &m_ring[i].buffer);
+        m_ring[i].buffer = 0;
+        m_ring[i].bufferBytes = 0;
+    }
+}
+
+// --------------------------------------------------------------------------
+// Recording
+
+void FrameCapture::Begin(const string &prefix, CaptureFormat format)
+{
+    if (m_recording) End();
+
+    m_recording = true;
+    m_prefix = prefix;
+    m_format = format;
+    m_frame = 0;
+    m_readbackWaits = m_encoderWaits = 0;
+    m_written = 0;
+    m_startTime = Now();
+    cout << "recording to " << prefix << "*" << (format == CAPTURE_PNG ? ".png" : ".ppm") << endl;
+}
+
+void FrameCapture::End()
+{
+    if (!m_recording) return;
+    RetireFinished(true);
+
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_progress.wait(lock, [this]() { return m_jobs.empty() && m_encoding == 0; });
+    }
+    m_recording = false;
+
+    double seconds = Now() - m_startTime;
+    cout << "recorded " << m_written << " frames in " << seconds << " s (" << m_written / seconds
+         << " frames/s written); the renderer waited on " << m_readbackWaits << " readbacks and "
+         << m_encoderWaits << " encodes" << endl;
+}
+
+void FrameCapture::Capture(int width, int height)
+{
+    if (!m_recording) return;
+    RetireFinished(false);
+
+    // the ring is full of copies still in flight: the oldest one must finish first
+    Readback &readback = m_ring[m_next];
+    if (readback.fence) {
+        m_readbackWaits++;
+        Retire(&readback);
+    }
+
+    size_t bytes = 4 * size_t(width) * height;
+    BindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    if (readback.bufferBytes != bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, 0, GL_STREAM_READ);
+        CountGpuBuffer(MEMORY_CAPTURE, readback.buffer, bytes);
+        readback.bufferBytes = bytes;
+    }
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.width = width;
+    readback.height = height;
+    readback.frame = m_frame++;
+    m_next = (m_next + 1) % RING_SIZE;
+}
+
+// retires readbacks in capture order, stopping at the first still in flight unless block
+void FrameCapture::RetireFinished(bool block)
+{
+    for (int i = 0; i < RING_SIZE; ++i) {
+        Readback &readback = m_ring[(m_next + i) % RING_SIZE];
+        if (!readback.fence) continue;
+        if (!block && glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED) return;
+        Retire(&readback);
+    }
+}
+
+// maps a readback once its copy is done and hands the pixels to an encoder
+void FrameCapture::Retire(Readback *readback)
+{
+    while (glClientWaitSync(readback->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED)
+        ;
+    glDeleteSync(readback->fence);
+    readback->fence = 0;
+
+    EncodeJob job;
+    job.width = readback->width;
+    job.height = readback->height;
+    job.format = m_format;
+    char number[16];
+    snprintf(number, sizeof(number), "%06d", readback->frame);
+    job.filename = m_prefix + number + (m_format == CAPTURE_PNG ? ".png" : ".ppm");
+
+    {
+        // a full queue means the encoders cannot keep up; waiting here bounds the memory
+        unique_lock<mutex> lock(m_mutex);
+        if (m_jobs.size() >= m_maxQueued) {
+            m_encoderWaits++;
+            m_progress.wait(lock, [this]() { return m_jobs.size() < m_maxQueued; });
+        }
+        if (m_pool.empty()) {
+            job.rgba = new Pixels();
+        } else {
+            job.rgba = m_pool.back();
+            m_pool.pop_back();
+        }
+    }
+
+    size_t bytes = 4 * size_t(job.width) * job.height;
+    job.rgba->resize(bytes);
+    BindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+    if (const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT)) {
+        memcpy(job.rgba->data(), pixels, bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_jobs.push_back(job);
+    }
+    m_wake.notify_one();
+}
+
+// --------------------------------------------------------------------------
+// Encoding
+
+void FrameCapture::Encode()
+{
+    Pixels rgb;
+    unique_lock<mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+        if (m_jobs.empty()) return;
+
+        EncodeJob job = m_jobs.front();
+        m_jobs.pop_front();
+        m_encoding++;
+        lock.unlock();
+        m_progress.notify_all();
+
+        // shaders leave alpha undefined, so frames are written as RGB, top row first
+        size_t rowBytes = 3 * size_t(job.width);
+        rgb.resize(rowBytes * job.height);
+        for (int y = 0; y < job.height; ++y) {
+            const unsigned char *from = &(*job.rgba)[4 * size_t(job.height - 1 - y) * job.width];
+            unsigned char *to = &rgb[y * rowBytes];
+            for (int x = 0; x < job.width; ++x, from += 4, to += 3) {
+                to[0] = from[0];
+                to[1] = from[1];
+                to[2] = from[2];
+            }
+        }
+
+        bool written;
+        if (job.format == CAPTURE_PNG) {
+            written = stbi_write_png(job.filename.c_str(), job.width, job.height, 3, rgb.data(), int(rowBytes)) != 0;
+        } else {
+            FILE *file = fopen(job.filename.c_str(), "wb");
+            written = file && fprintf(file, "P6\n%d %d\n255\n", job.width, job.height) > 0 &&
+                      fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+            if (file) fclose(file);
+        }
+        if (!written) cout << "FrameCapture ERROR: could not write " << job.filename << endl;
+
+        lock.lock();
+        m_pool.push_back(job.rgba);
+        m_encoding--;
+        if (written) m_written++;
+        m_progress.notify_all();
+    }
+}
+
+// --------------------------------------------------------------------------
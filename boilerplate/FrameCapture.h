@@ -0,0 +1,122 @@
+// ==========================================================================
+// Frame Capture
+//
+// This module records the frames being drawn to numbered image files
+// without making the renderer wait for the GPU or the encoder:
+//  - glReadPixels copies each frame into one of a ring of pixel pack
+//    buffers and is fenced; the copy finishes on the GPU while the next
+//    frames are drawn
+//  - a few frames later, once its fence has passed, the buffer is mapped,
+//    its pixels are handed to a pool of encoder threads and it is reused
+//  - the encoders write PNG through stb_image_write, or binary PPM, which
+//    is raw RGB with a short header and costs almost nothing to write
+//
+// The renderer only waits when every buffer of the ring is still being
+// copied, or when the encoders fall more than a set number of frames
+// behind; both are counted and reported.
+//
+// Capture() reads the bound read framebuffer, so it works the same for the
+// window's back buffer and for an offscreen framebuffer.
+// ==========================================================================
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "MemoryAccount.h"
+
+// --------------------------------------------------------------------------
+
+enum CaptureFormat
+{
+    CAPTURE_PNG,
+    CAPTURE_PPM
+};
+
+class FrameCapture
+{
+    // a readback in flight, oldest first from m_next
+    struct Readback
+    {
+        GLuint buffer;
+        size_t bufferBytes;
+        GLsync fence;
+        int width, height;
+        int frame;
+    };
+
+    typedef CountedVector<unsigned char, MEMORY_CAPTURE> Pixels;
+
+    struct EncodeJob
+    {
+        Pixels *rgba;                       // bottom row first, from the pool
+        int width, height;
+        CaptureFormat format;
+        std::string filename;
+    };
+
+    static const int RING_SIZE = 4;
+    Readback m_ring[RING_SIZE];
+    int m_next;
+
+    // encoding, shared with the workers under m_mutex
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_progress;
+    std::deque<EncodeJob> m_jobs;
+    std::vector<Pixels*> m_pool;
+    int m_encoding;
+    int m_written;
+    bool m_stop;
+    size_t m_maxQueued;
+
+    // the recording
+    bool m_recording;
+    std::string m_prefix;
+    CaptureFormat m_format;
+    int m_frame;
+    int m_readbackWaits, m_encoderWaits;
+    double m_startTime;
+
+    void Encode();
+    void Retire(Readback *readback);
+    void RetireFinished(bool block);
+
+    // not copyable, the workers refer to this object
+    FrameCapture(const FrameCapture &);
+    FrameCapture &operator=(const FrameCapture &);
+
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // starts the encoders; 0 workers means one per core, less the renderer's
+    bool Initialize(int workers = 0);
+
+    // finishes any recording, stops the encoders and deletes the buffers
+    void Destroy();
+
+    // frames captured from now on are written to prefix000000.png (or .ppm),
+    // prefix000001.png, ...
+    void Begin(const std::string &prefix, CaptureFormat format = CAPTURE_PNG);
+
+    // waits for every frame captured to be written and reports the rates
+    void End();
+
+    bool Recording() const { return m_recording; }
+
+    // reads width x height pixels of the bound read framebuffer; call once
+    // per frame after drawing, before the buffers are swapped
+    void Capture(int width, int height);
+};
+
+// --------------------------------------------------------------------------
+#endif // FRAMECAPTURE_H
@@ -0,0 +1,382 @@
+// ==========================================================================
+// GL State Cache
+//
+// Unknown state is held as values no real call passes (~0 names, negative
+// sizes), so comparing against them always forwards. Buffer targets and
+// texture targets outside the short lists below, and texture units past
+// TEXTURE_UNITS, are not cached: their calls are always forwarded.
+//
+// Uniform locations are kept per program as a short list of names, searched
+// in order: programs have a handful of uniforms, fewer than a hash would pay
+// for.
+// ==========================================================================
+
+#include "GLState.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const GLuint UNKNOWN = ~0u;
+
+    const GLenum BUFFER_TARGETS[] = {
+        GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_TEXTURE_BUFFER,
+        GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER
+    };
+    const int BUFFER_TARGET_COUNT = sizeof(BUFFER_TARGETS) / sizeof(BUFFER_TARGETS[0]);
+    const int ELEMENT_TARGET = 1;
+
+    const GLenum TEXTURE_TARGETS[] = {
+        GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_RECTANGLE, GL_TEXTURE_CUBE_MAP,
+        GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BUFFER, GL_TEXTURE_2D_MULTISAMPLE
+    };
+    const int TEXTURE_TARGET_COUNT = sizeof(TEXTURE_TARGETS) / sizeof(TEXTURE_TARGETS[0]);
+    const int TEXTURE_UNITS = 16;
+
+    struct State
+    {
+        GLuint program, vertexArray;
+        GLuint buffers[BUFFER_TARGET_COUNT];
+        GLenum activeTexture;
+        GLuint textures[TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+
+        GLint patchVertices;
+        GLfloat pointSize;
+        int blend;                          // 1 enabled, 0 disabled, -1 unknown
+        GLenum blendSource, blendDestination;
+        int stencilTest;
+        GLenum stencilFunction;
+        GLint stencilReference;
+        GLuint stencilFunctionMask;
+        GLenum stencilFail, stencilDepthFail, stencilPass;
+        GLuint stencilWriteMask;
+        bool stencilWriteMaskKnown;
+    };
+
+    struct ProgramUniforms
+    {
+        GLuint program;
+        vector<pair<string, GLint> > locations;
+    };
+
+    State state;
+    vector<ProgramUniforms> uniforms;
+    GLStateCounts counts = {0, 0};
+
+    // a one time initializer, so the cache starts unknown without a call
+    struct Unknown { Unknown() { InvalidateGLState(); } } unknown;
+
+    int BufferTarget(GLenum target)
+    {
+        for (int i = 0; i < BUFFER_TARGET_COUNT; ++i)
+            if (BUFFER_TARGETS[i] == target) return i;
+        return -1;
+    }
+
+    int TextureTarget(GLenum target)
+    {
+        for (int i = 0; i < TEXTURE_TARGET_COUNT; ++i)
+            if (TEXTURE_TARGETS[i] == target) return i;
+        return -1;
+    }
+
+    // the binding slot of target on the active unit, 0 if it is not cached
+    GLuint *TextureSlot(GLenum target)
+    {
+        int index = TextureTarget(target);
+        GLuint unit = state.activeTexture - GL_TEXTURE0;
+        if (index < 0 || state.activeTexture == UNKNOWN || unit >= GLuint(TEXTURE_UNITS)) return 0;
+        return &state.textures[unit][index];
+    }
+
+    ProgramUniforms *FindUniforms(GLuint program)
+    {
+        for (size_t i = 0; i < uniforms.size(); ++i)
+            if (uniforms[i].program == program) return &uniforms[i];
+        return 0;
+    }
+
+    void ForgetUniforms(GLuint program)
+    {
+        for (size_t i = 0; i < uniforms.size(); ++i)
+            if (uniforms[i].program == program) {
+                uniforms.erase(uniforms.begin() + i);
+                return;
+            }
+    }
+
+    // true, and counted as forwarded, if value changes cached; counted as
+    // skipped otherwise
+    template <typename T>
+    bool Change(T *cached, T value)
+    {
+        if (*cached == value) {
+            ++counts.skipped;
+            return false;
+        }
+        *cached = value;
+        ++counts.forwarded;
+        return true;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void UseProgram(GLuint program)
+{
+    if (Change(&state.program, program)) glUseProgram(program);
+}
+
+void BindVertexArray(GLuint vertexArray)
+{
+    if (Change(&state.vertexArray, vertexArray)) {
+        glBindVertexArray(vertexArray);
+        state.buffers[ELEMENT_TARGET] = UNKNOWN;
+    }
+}
+
+void BindBuffer(GLenum target, GLuint buffer)
+{
+    int index = BufferTarget(target);
+    if (index < 0) {
+        ++counts.forwarded;
+        glBindBuffer(target, buffer);
+    }
+    else if (Change(&state.buffers[index], buffer)) glBindBuffer(target, buffer);
+}
+
+void BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    // indexed binding points are not cached, only the generic one they also set
+    ++counts.forwarded;
+    glBindBufferBase(target, index, buffer);
+    int slot = BufferTarget(target);
+    if (slot >= 0) state.buffers[slot] = buffer;
+}
+
+void ActiveTexture(GLenum unit)
+{
+    if (Change(&state.activeTexture, unit)) glActiveTexture(unit);
+}
+
+void BindTexture(GLenum target, GLuint texture)
+{
+    GLuint *slot = TextureSlot(target);
+    if (!slot) {
+        ++counts.forwarded;
+        glBindTexture(target, texture);
+    }
+    else if (Change(slot, texture)) glBindTexture(target, texture);
+}
+
+// --------------------------------------------------------------------------
+
+void SetPatchVertices(GLint count)
+{
+    if (Change(&state.patchVertices, count)) glPatchParameteri(GL_PATCH_VERTICES, count);
+}
+
+void SetPointSize(GLfloat size)
+{
+    if (Change(&state.pointSize, size)) glPointSize(size);
+}
+
+void SetBlend(bool enabled)
+{
+    if (!Change(&state.blend, int(enabled))) return;
+    if (enabled) glEnable(GL_BLEND);
+    else glDisable(GL_BLEND);
+}
+
+void SetBlendFunc(GLenum source, GLenum destination)
+{
+    if (state.blendSource == source && state.blendDestination == destination) {
+        ++counts.skipped;
+        return;
+    }
+    state.blendSource = source;
+    state.blendDestination = destination;
+    ++counts.forwarded;
+    glBlendFunc(source, destination);
+}
+
+void SetStencilTest(bool enabled)
+{
+    if (!Change(&state.stencilTest, int(enabled))) return;
+    if (enabled) glEnable(GL_STENCIL_TEST);
+    else glDisable(GL_STENCIL_TEST);
+}
+
+void SetStencilFunc(GLenum function, GLint reference, GLuint mask)
+{
+    if (state.stencilFunction == function && state.stencilReference == reference &&
+        state.stencilFunctionMask == mask) {
+        ++counts.skipped;
+        return;
+    }
+    state.stencilFunction = function;
+    state.stencilReference = reference;
+    state.stencilFunctionMask = mask;
+    ++counts.forwarded;
+    glStencilFunc(function, reference, mask);
+}
+
+void SetStencilOp(GLenum stencilFail, GLenum depthFail, GLenum pass)
+{
+    if (state.stencilFail == stencilFail && state.stencilDepthFail == depthFail && state.stencilPass == pass) {
+        ++counts.skipped;
+        return;
+    }
+    state.stencilFail = stencilFail;
+    state.stencilDepthFail = depthFail;
+    state.stencilPass = pass;
+    ++counts.forwarded;
+    glStencilOp(stencilFail, depthFail, pass);
+}
+
+void SetStencilMask(GLuint mask)
+{
+    // every mask is a valid value, so whether it is known is kept apart
+    if (state.stencilWriteMaskKnown && state.stencilWriteMask == mask) {
+        ++counts.skipped;
+        return;
+    }
+    state.stencilWriteMask = mask;
+    state.stencilWriteMaskKnown = true;
+    ++counts.forwarded;
+    glStencilMask(mask);
+}
+
+// --------------------------------------------------------------------------
+
+void CacheUniformLocations(GLuint program)
+{
+    ForgetUniforms(program);
+    uniforms.push_back(ProgramUniforms());
+    ProgramUniforms &cached = uniforms.back();
+    cached.program = program;
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    vector<char> name(max(maxLength, 1));
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, GLuint(i), GLsizei(name.size()), &length, &size, &type, &name[0]);
+
+        // members of uniform blocks have no location
+        GLint location = glGetUniformLocation(program, &name[0]);
+        if (location < 0) continue;
+
+        // arrays are listed as "name[0]", and looked up as either
+        string full(&name[0], length);
+        cached.locations.push_back(make_pair(full, location));
+        if (full.size() > 3 && full.compare(full.size() - 3, 3, "[0]") == 0)
+            cached.locations.push_back(make_pair(full.substr(0, full.size() - 3), location));
+    }
+}
+
+GLint UniformLocation(GLuint program, const char *name)
+{
+    ProgramUniforms *cached = FindUniforms(program);
+    if (!cached) {
+        uniforms.push_back(ProgramUniforms());
+        cached = &uniforms.back();
+        cached->program = program;
+    }
+    for (size_t i = 0; i < cached->locations.size(); ++i)
+        if (strcmp(cached->locations[i].first.c_str(), name) == 0) return cached->locations[i].second;
+
+    // inactive names are remembered too, as -1, which glUniform* ignores
+    GLint location = glGetUniformLocation(program, name);
+    cached->locations.push_back(make_pair(string(name), location));
+    return location;
+}
+
+// --------------------------------------------------------------------------
+
+void DeleteProgram(GLuint program)
+{
+    // a program in use stays current until another is used, and its name
+    // stays taken until then; forget it so the next use always goes through
+    if (state.program == program) state.program = UNKNOWN;
+    ForgetUniforms(program);
+    glDeleteProgram(program);
+}
+
+void DeleteVertexArrays(GLsizei count, const GLuint *vertexArrays)
+{
+    for (GLsizei i = 0; i < count; ++i)
+        if (vertexArrays[i] != 0 && state.vertexArray == vertexArrays[i]) {
+            state.vertexArray = 0;
+            state.buffers[ELEMENT_TARGET] = 0;
+        }
+    glDeleteVertexArrays(count, vertexArrays);
+}
+
+void DeleteBuffers(GLsizei count, const GLuint *buffers)
+{
+    for (GLsizei i = 0; i < count; ++i)
+        for (int j = 0; j < BUFFER_TARGET_COUNT; ++j)
+            if (buffers[i] != 0 && state.buffers[j] == buffers[i]) state.buffers[j] = 0;
+    glDeleteBuffers(count, buffers);
+}
+
+void DeleteTextures(GLsizei count, const GLuint *textures)
+{
+    for (GLsizei i = 0; i < count; ++i)
+        for (int unit = 0; unit < TEXTURE_UNITS; ++unit)
+            for (int j = 0; j < TEXTURE_TARGET_COUNT; ++j)
+                if (textures[i] != 0 && state.textures[unit][j] == textures[i]) state.textures[unit][j] = 0;
+    glDeleteTextures(count, textures);
+}
+
+// --------------------------------------------------------------------------
+
+void InvalidateGLState()
+{
+    state.program = state.vertexArray = UNKNOWN;
+    for (int i = 0; i < BUFFER_TARGET_COUNT; ++i)
+        state.buffers[i] = UNKNOWN;
+    state.activeTexture = UNKNOWN;
+    for (int unit = 0; unit < TEXTURE_UNITS; ++unit)
+        for (int j = 0; j < TEXTURE_TARGET_COUNT; ++j)
+            state.textures[unit][j] = UNKNOWN;
+
+    state.patchVertices = -1;
+    state.pointSize = -1;
+    state.blend = state.stencilTest = -1;
+    state.blendSource = state.blendDestination = UNKNOWN;
+    state.stencilFunction = UNKNOWN;
+    state.stencilReference = -1;
+    state.stencilFunctionMask = 0;
+    state.stencilFail = state.stencilDepthFail = state.stencilPass = UNKNOWN;
+    state.stencilWriteMaskKnown = false;
+
+    // a new context may reuse the names of programs this one had
+    uniforms.clear();
+}
+
+GLStateCounts GetGLStateCounts()
+{
+    return counts;
+}
+
+void PrintGLStateCounts(const string &heading)
+{
+    unsigned long long calls = counts.forwarded + counts.skipped;
+    cout << "GL state " << heading << ": " << counts.forwarded << " calls forwarded, " << counts.skipped
+         << " redundant ones skipped";
+    if (calls > 0) cout << " (" << 100.0 * counts.skipped / calls << "%)";
+    cout << endl;
+}
+
+// --------------------------------------------------------------------------
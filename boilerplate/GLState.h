@@ -0,0 +1,96 @@
+// ==========================================================================
+// GL State Cache
+//
+// This module stands between the drawing code and the OpenGL calls that
+// change bindings and fixed function state. It remembers what is current:
+//  - the program, vertex array, buffer bindings, active texture unit and
+//    the texture bound to each unit
+//  - patch size, point size, blending and stencil state
+//  - the uniform locations of each program, read once after it is linked
+// and only forwards a call when it changes something. Calls that would not
+// are counted instead, so frames of hundreds of draws that share a program
+// or vertex array pay for one bind.
+//
+// The cache is only right while every change to the state it tracks goes
+// through it, deletes included (deleting a bound object unbinds it). It
+// starts out unknown, so the first call of each kind is always forwarded;
+// after GL calls it did not see, InvalidateGLState() makes it unknown
+// again. There is one cache, for the context current on the calling thread.
+// ==========================================================================
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <string>
+
+#include <glad/glad.h>
+
+// --------------------------------------------------------------------------
+// Bindings
+
+void UseProgram(GLuint program);
+void BindVertexArray(GLuint vertexArray);
+
+// the element array binding belongs to the vertex array; it is forgotten
+// whenever another vertex array is bound
+void BindBuffer(GLenum target, GLuint buffer);
+
+// binds an indexed binding point, which also binds target itself
+void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+// unit is GL_TEXTURE0 + i, as for glActiveTexture
+void ActiveTexture(GLenum unit);
+
+// binds to the active unit
+void BindTexture(GLenum target, GLuint texture);
+
+// --------------------------------------------------------------------------
+// Fixed function state
+
+void SetPatchVertices(GLint count);
+void SetPointSize(GLfloat size);
+
+void SetBlend(bool enabled);
+void SetBlendFunc(GLenum source, GLenum destination);
+
+void SetStencilTest(bool enabled);
+void SetStencilFunc(GLenum function, GLint reference, GLuint mask);
+void SetStencilOp(GLenum stencilFail, GLenum depthFail, GLenum pass);
+void SetStencilMask(GLuint mask);
+
+// --------------------------------------------------------------------------
+// Uniform locations, which do not change once a program is linked
+
+// reads the location of every active uniform of a program just linked
+void CacheUniformLocations(GLuint program);
+
+// the location glGetUniformLocation would return; only names the cache does
+// not hold yet, such as those of programs it was not told about, reach the
+// driver, and then just once
+GLint UniformLocation(GLuint program, const char *name);
+
+// --------------------------------------------------------------------------
+// Deletes, which also drop the deleted names from the cache
+
+void DeleteProgram(GLuint program);
+void DeleteVertexArrays(GLsizei count, const GLuint *vertexArrays);
+void DeleteBuffers(GLsizei count, const GLuint *buffers);
+void DeleteTextures(GLsizei count, const GLuint *textures);
+
+// --------------------------------------------------------------------------
+
+// forgets everything, for a new context or after untracked GL calls
+void InvalidateGLState();
+
+struct GLStateCounts
+{
+    unsigned long long forwarded;   // calls that reached the driver
+    unsigned long long skipped;     // calls that would not have changed anything
+};
+
+GLStateCounts GetGLStateCounts();
+
+// forwarded and skipped calls since startup, under a heading
+void PrintGLStateCounts(const std::string &heading);
+
+// --------------------------------------------------------------------------
+#endif // GLSTATE_H
@@ -17,6 +17,8 @@
 // ==========================================================================
 
 #include "GlyphExtractor.h"
+#include "Bezier.h"
+#include <algorithm>
 #include <iostream>
 
 // set this true to print information about the font loaded and glyphs extracted
@@ -40,6 +42,12 @@ GlyphExtractor::GlyphExtractor()
 
 bool GlyphExtractor::LoadFontFile(const string &filename)
 {
+    // a font loaded before is replaced, not leaked
+    if (m_face) {
+        FT_Done_Face(m_face);
+        m_face = 0;
+    }
+
     FT_Error error = FT_New_Face(m_library, filename.c_str(), 0, &m_face);
 
     if (error == FT_Err_Unknown_File_Format) {
@@ -53,6 +61,10 @@ bool GlyphExtractor::LoadFontFile(const string &filename)
 
     if (DEBUG_PRINT) PrintFontInformation();
 
+    // metrics from a previous font no longer apply
+    m_metrics.assign(m_face->num_glyphs, MyGlyphMetrics());
+    m_measured.assign(m_face->num_glyphs, false);
+
     return true;
 }
 
@@ -99,19 +111,39 @@ MyGlyph GlyphExtractor::ExtractGlyph(int character) const
     }
 
     // look up the glyph index for the given character code
-    int index = FT_Get_Char_Index(m_face, character);
+    return Extract(FT_Get_Char_Index(m_face, character), character);
+}
+
+MyGlyph GlyphExtractor::ExtractGlyphIndex(unsigned int index) const
+{
+    if (!m_face) {
+        cout << "GlyphExtractor ERROR: No font loaded!" << endl;
+        return MyGlyph();
+    }
+    return Extract(index, -1);
+}
 
+unsigned int GlyphExtractor::GlyphIndex(unsigned int codepoint) const
+{
+    return m_face ? FT_Get_Char_Index(m_face, codepoint) : 0;
+}
+
+MyGlyph GlyphExtractor::Extract(unsigned int index, int character) const
+{
     // load the glyph for the given character into the face glyph slot,
     // keeping the outline in original font units
     FT_Error error = FT_Load_Glyph(m_face, index, FT_LOAD_NO_SCALE);
     if (error || m_face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
     {
-        cout << "FreeType ERROR: Could not find glyph outline for character "
-             << character << " (" << char(character) << ")" <<  endl;
+        if (character >= 0)
+            cout << "FreeType ERROR: Could not find glyph outline for character "
+                 << character << " (" << char(character) << ")" <<  endl;
+        else
+            cout << "FreeType ERROR: Could not find glyph outline for glyph index " << index << endl;
         return MyGlyph();
     }
 
-    if (DEBUG_PRINT) PrintGlyphInformation(character);
+    if (DEBUG_PRINT && character >= 0) PrintGlyphInformation(character);
 
     // create a new glyph structure to populate with this character outline
     FT_Outline &outline = m_face->glyph->outline;
@@ -206,7 +238,71 @@ MyGlyph GlyphExtractor::ExtractGlyph(int character) const
         glyph.contours.push_back(contour);
     }
 
+    if (index < m_metrics.size() && !m_measured[index]) {
+        m_metrics[index] = MeasureGlyph(glyph);
+        m_measured[index] = true;
+    }
+
     return glyph;
 }
 
+const MyGlyphMetrics &GlyphExtractor::Metrics(int character) const
+{
+    static const MyGlyphMetrics none;
+    if (!m_face) return none;
+
+    return MetricsIndex(FT_Get_Char_Index(m_face, character));
+}
+
+const MyGlyphMetrics &GlyphExtractor::MetricsIndex(unsigned int index) const
+{
+    static const MyGlyphMetrics none;
+    if (!m_face || index >= m_metrics.size()) return none;
+
+    if (!m_measured[index]) {
+        Extract(index, -1);
+
+        // glyphs without an outline are measured as empty, so stop asking
+        m_measured[index] = true;
+    }
+    return m_metrics[index];
+}
+
+// --------------------------------------------------------------------------
+
+MyGlyphMetrics MeasureGlyph(const MyGlyph &glyph)
+{
+    MyGlyphMetrics metrics;
+    metrics.advance = glyph.advance;
+
+    bool first = true;
+    unsigned int patches = 0;
+    for (size_t c = 0; c < glyph.contours.size(); ++c)
+        for (size_t s = 0; s < glyph.contours[c].size(); ++s)
+        {
+            const MySegment &segment = glyph.contours[c][s];
+            metrics.segments[std::min(segment.degree, 3u)]++;
+            if (segment.degree > 0) ++patches;
+
+            // solves the derivative roots of quadratics and cubics
+            glm::vec2 lo, hi;
+            SegmentBounds(segment, &lo, &hi);
+            if (first) {
+                metrics.xMin = lo.x; metrics.yMin = lo.y;
+                metrics.xMax = hi.x; metrics.yMax = hi.y;
+                first = false;
+            }
+            else {
+                metrics.xMin = std::min(metrics.xMin, lo.x);
+                metrics.yMin = std::min(metrics.yMin, lo.y);
+                metrics.xMax = std::max(metrics.xMax, hi.x);
+                metrics.yMax = std::max(metrics.yMax, hi.y);
+            }
+        }
+
+    // an isoline of n segments emits n+1 vertices
+    metrics.tessVertices = patches * (GLYPH_TESS_SEGMENTS + 1);
+    return metrics;
+}
+
 // --------------------------------------------------------------------------
@@ -24,6 +24,8 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include "MemoryAccount.h"
+
 // --------------------------------------------------------------------------
 // DATA STRUCTURES: Segment, Contour, and Glyph
 
@@ -57,6 +59,36 @@ struct MyGlyph
     {}
 };
 
+// Precomputed facts about a glyph, so layout, culling and atlas packing never
+// need to touch its control points. 32 bytes per glyph.
+struct MyGlyphMetrics
+{
+    // advance width to next glyph, in EM units
+    float advance;
+
+    // exact bounds of the outline curves (not their control polygons), in
+    // EM-box coordinates; all zero for glyphs without contours
+    float xMin, yMin, xMax, yMax;
+
+    // number of segments of each degree (index 0=point ... 3=cubic)
+    unsigned short segments[4];
+
+    // upper bound on the vertices the tessellation stages emit for this glyph,
+    // drawing every segment as one patch
+    unsigned int tessVertices;
+
+    MyGlyphMetrics() : advance(0), xMin(0), yMin(0), xMax(0), yMax(0), tessVertices(0)
+    {
+        segments[0] = segments[1] = segments[2] = segments[3] = 0;
+    }
+};
+
+// line segments produced per patch, as set in shaders/tessControl.glsl
+const unsigned int GLYPH_TESS_SEGMENTS = 64;
+
+// computes the metrics of an extracted glyph
+MyGlyphMetrics MeasureGlyph(const MyGlyph &glyph);
+
 // --------------------------------------------------------------------------
 // This class encapsulates functionality required to load a font file from
 // disk and retrieve glyph outlines for characters from the font.
@@ -66,10 +98,17 @@ class GlyphExtractor
     FT_Library  m_library;
     FT_Face     m_face;
 
+    // metrics of every glyph extracted so far, indexed by font glyph index
+    mutable CountedVector<MyGlyphMetrics, MEMORY_GLYPHS> m_metrics;
+    mutable CountedVector<bool, MEMORY_GLYPHS> m_measured;
+
     // private methods to print font/glyph info, for debugging
     void PrintFontInformation() const;
     void PrintGlyphInformation(int character) const;
 
+    // extracts the glyph at a font glyph index; character is only for messages
+    MyGlyph Extract(unsigned int index, int character) const;
+
 public:
     GlyphExtractor();
 
@@ -77,7 +116,19 @@ public:
     bool LoadFontFile(const std::string &filename);
 
     // this method retrieves a (possibly composite) glyph for the given character
+    // and caches its metrics
     MyGlyph ExtractGlyph(int character) const;
+
+    // metrics for the given character, extracting the glyph only the first time
+    const MyGlyphMetrics &Metrics(int character) const;
+
+    // font glyph index of a Unicode codepoint, 0 (the missing glyph) if the
+    // font does not cover it; this walks the font's character map
+    unsigned int GlyphIndex(unsigned int codepoint) const;
+
+    // the same as above, for a glyph index already looked up with GlyphIndex()
+    MyGlyph ExtractGlyphIndex(unsigned int index) const;
+    const MyGlyphMetrics &MetricsIndex(unsigned int index) const;
 };
 
 // --------------------------------------------------------------------------
@@ -0,0 +1,167 @@
+// ==========================================================================
+// Memory Accounting
+//
+// Per subsystem atomics for the counts; GL object sizes are looked up in a
+// map under a mutex, which only object creation and deletion touch.
+// ==========================================================================
+
+#include "MemoryAccount.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+namespace
+{
+    struct Counter
+    {
+        atomic<long long> current, peak;
+    };
+
+    Counter cpuCounters[MEMORY_SUBSYSTEM_COUNT];
+    Counter gpuCounters[MEMORY_SUBSYSTEM_COUNT];
+    atomic<bool> changed(false);
+
+    // GL name to its subsystem and the bytes recorded for it
+    typedef map<unsigned int, pair<MemorySubsystem, size_t> > ObjectSizes;
+    mutex objectMutex;
+    ObjectSizes bufferSizes, textureSizes;
+
+    void Add(Counter *counter, long long bytes)
+    {
+        long long now = counter->current.fetch_add(bytes) + bytes;
+        long long peak = counter->peak;
+        while (now > peak && !counter->peak.compare_exchange_weak(peak, now))
+            ;
+        changed = true;
+    }
+
+    void Record(ObjectSizes *sizes, MemorySubsystem subsystem, unsigned int name, size_t bytes)
+    {
+        lock_guard<mutex> lock(objectMutex);
+        ObjectSizes::iterator found = sizes->find(name);
+        if (found != sizes->end())
+            Add(&gpuCounters[found->second.first], -(long long)found->second.second);
+        (*sizes)[name] = make_pair(subsystem, bytes);
+        Add(&gpuCounters[subsystem], (long long)bytes);
+    }
+
+    void Forget(ObjectSizes *sizes, unsigned int name)
+    {
+        lock_guard<mutex> lock(objectMutex);
+        ObjectSizes::iterator found = sizes->find(name);
+        if (found == sizes->end()) return;
+        Add(&gpuCounters[found->second.first], -(long long)found->second.second);
+        sizes->erase(found);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+const char *MemorySubsystemName(MemorySubsystem subsystem)
+{
+    switch (subsystem) {
+    case MEMORY_GLYPHS: return "glyphs";
+    case MEMORY_SCENES: return "scenes";
+    case MEMORY_LAYOUT: return "layout";
+    case MEMORY_TEXTURES: return "textures";
+    case MEMORY_CAPTURE: return "capture";
+    default: return "unknown";
+    }
+}
+
+MemoryUsage GetMemoryUsage(MemorySubsystem subsystem)
+{
+    MemoryUsage usage;
+    usage.cpu = cpuCounters[subsystem].current;
+    usage.cpuPeak = cpuCounters[subsystem].peak;
+    usage.gpu = gpuCounters[subsystem].current;
+    usage.gpuPeak = gpuCounters[subsystem].peak;
+    return usage;
+}
+
+void CountCpuBytes(MemorySubsystem subsystem, long long bytes)
+{
+    Add(&cpuCounters[subsystem], bytes);
+}
+
+void CountGpuBuffer(MemorySubsystem subsystem, unsigned int buffer, size_t bytes)
+{
+    Record(&bufferSizes, subsystem, buffer, bytes);
+}
+
+void CountGpuTexture(MemorySubsystem subsystem, unsigned int texture, size_t bytes)
+{
+    Record(&textureSizes, subsystem, texture, bytes);
+}
+
+void ForgetGpuBuffer(unsigned int buffer)
+{
+    Forget(&bufferSizes, buffer);
+}
+
+void ForgetGpuTexture(unsigned int texture)
+{
+    Forget(&textureSizes, texture);
+}
+
+size_t TextureBytes(int width, int height, int layers, int bytesPerTexel, bool mipmaps)
+{
+    size_t bytes = 0;
+    while (true) {
+        bytes += size_t(width) * height * layers * bytesPerTexel;
+        if (!mipmaps || (width == 1 && height == 1)) return bytes;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+}
+
+bool MemoryChangedSinceReport()
+{
+    return changed;
+}
+
+// --------------------------------------------------------------------------
+
+static string Megabytes(long long bytes)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.2f MB", bytes / 1048576.0);
+    return text;
+}
+
+void PrintMemoryReport(const string &heading)
+{
+    changed = false;
+
+    char line[128];
+    cout << "memory " << heading << ":" << endl;
+    snprintf(line, sizeof(line), "  %-10s %12s %12s %12s %12s", "", "CPU now", "CPU peak", "GPU now", "GPU peak");
+    cout << line << endl;
+
+    MemoryUsage total = {0, 0, 0, 0};
+    for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; ++i)
+    {
+        MemoryUsage usage = GetMemoryUsage(MemorySubsystem(i));
+        snprintf(line, sizeof(line), "  %-10s %12s %12s %12s %12s", MemorySubsystemName(MemorySubsystem(i)),
+                 Megabytes(usage.cpu).c_str(), Megabytes(usage.cpuPeak).c_str(),
+                 Megabytes(usage.gpu).c_str(), Megabytes(usage.gpuPeak).c_str());
+        cout << line << endl;
+
+        // the peaks of subsystems need not coincide, so their sum bounds the total's peak
+        total.cpu += usage.cpu;
+        total.cpuPeak += usage.cpuPeak;
+        total.gpu += usage.gpu;
+        total.gpuPeak += usage.gpuPeak;
+    }
+    snprintf(line, sizeof(line), "  %-10s %12s %12s %12s %12s", "total", Megabytes(total.cpu).c_str(),
+             Megabytes(total.cpuPeak).c_str(), Megabytes(total.gpu).c_str(), Megabytes(total.gpuPeak).c_str());
+    cout << line << endl;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,111 @@
+// ==========================================================================
+// Memory Accounting
+//
+// This module keeps a running count of the memory each subsystem holds, on
+// the CPU and on the GPU, so growth shows up as it happens and budgets can
+// be set from measured peaks:
+//  - CPU bytes come from containers declared with CountingAllocator (or
+//    CountedVector), and from CountCpuBytes() for memory other libraries
+//    hand out, like the pixels stb_image decodes
+//  - GPU bytes are recorded per GL object when its storage is specified
+//    (CountGpuBuffer(), CountGpuTexture()) and dropped when it is deleted,
+//    so respecifying a buffer replaces its old size rather than adding
+//  - PrintMemoryReport() lists current and peak bytes per subsystem
+//
+// Counters are atomic, so containers on worker threads (scene builds,
+// texture decodes) count like the rest. GPU sizes are what was asked for;
+// drivers may pad or keep extra copies.
+// ==========================================================================
+#ifndef MEMORYACCOUNT_H
+#define MEMORYACCOUNT_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+enum MemorySubsystem
+{
+    MEMORY_GLYPHS,      // glyph metrics, caches and outlines kept for drawing
+    MEMORY_SCENES,      // scene patches, BVHs and the buffers they are drawn from
+    MEMORY_LAYOUT,      // document lines and text-on-path tables
+    MEMORY_TEXTURES,    // decoded images, textures and their upload buffers
+    MEMORY_CAPTURE,     // frame readback buffers and encoder queues
+    MEMORY_SUBSYSTEM_COUNT
+};
+
+const char *MemorySubsystemName(MemorySubsystem subsystem);
+
+struct MemoryUsage
+{
+    long long cpu, cpuPeak;
+    long long gpu, gpuPeak;
+};
+
+MemoryUsage GetMemoryUsage(MemorySubsystem subsystem);
+
+// adds bytes (removes, if negative) to a subsystem's CPU count
+void CountCpuBytes(MemorySubsystem subsystem, long long bytes);
+
+// records the storage a GL buffer or texture now has, replacing what was
+// recorded for it before; names are those of the one context
+void CountGpuBuffer(MemorySubsystem subsystem, unsigned int buffer, size_t bytes);
+void CountGpuTexture(MemorySubsystem subsystem, unsigned int texture, size_t bytes);
+
+// drops a deleted buffer or texture; unknown names are ignored
+void ForgetGpuBuffer(unsigned int buffer);
+void ForgetGpuTexture(unsigned int texture);
+
+// bytes of a texture of layers width x height images, with its whole mip
+// chain if mipmaps
+size_t TextureBytes(int width, int height, int layers, int bytesPerTexel, bool mipmaps);
+
+// true if any count changed since the last report
+bool MemoryChangedSinceReport();
+
+// current and peak bytes per subsystem, and their totals, under a heading
+void PrintMemoryReport(const std::string &heading);
+
+// --------------------------------------------------------------------------
+// A standard allocator that counts what its container holds towards a subsystem
+
+template <typename T, MemorySubsystem S>
+class CountingAllocator
+{
+public:
+    typedef T value_type;
+
+    // spelt out: the subsystem parameter is not a type, so the standard
+    // cannot rebind this allocator by itself
+    template <typename U>
+    struct rebind { typedef CountingAllocator<U, S> other; };
+
+    CountingAllocator() {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U, S> &) {}
+
+    T *allocate(size_t count)
+    {
+        CountCpuBytes(S, (long long)(count * sizeof(T)));
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T *memory, size_t count)
+    {
+        CountCpuBytes(S, -(long long)(count * sizeof(T)));
+        ::operator delete(memory);
+    }
+};
+
+template <typename T, typename U, MemorySubsystem S>
+bool operator==(const CountingAllocator<T, S> &, const CountingAllocator<U, S> &) { return true; }
+template <typename T, typename U, MemorySubsystem S>
+bool operator!=(const CountingAllocator<T, S> &, const CountingAllocator<U, S> &) { return false; }
+
+template <typename T, MemorySubsystem S>
+using CountedVector = std::vector<T, CountingAllocator<T, S> >;
+
+// --------------------------------------------------------------------------
+#endif // MEMORYACCOUNT_H
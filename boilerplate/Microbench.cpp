@@ -0,0 +1,131 @@
+// ==========================================================================
+// Microbenchmarks
+//
+// Percentiles are nearest-rank over the sorted trials, so the p95 of 30
+// trials is the 29th fastest, a time that was actually measured.
+// ==========================================================================
+
+#include "Microbench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+atomic<unsigned long long> microbenchAllocations(0);
+atomic<unsigned long long> microbenchAllocatedBytes(0);
+
+// --------------------------------------------------------------------------
+
+Microbench::Microbench(int warmup, int trials)
+    : m_warmup(std::max(warmup, 0)), m_trials(std::max(trials, 1))
+{}
+
+template <typename T>
+static T Percentile(vector<T> values, double fraction)
+{
+    sort(values.begin(), values.end());
+    size_t rank = size_t(fraction * values.size() + 0.999999);
+    return values[std::min(std::max(rank, size_t(1)), values.size()) - 1];
+}
+
+bool Microbench::Run(const string &name, const function<void()> &body, double items, const string &unit)
+{
+    if (!Selected(name)) return false;
+
+    for (int i = 0; i < m_warmup; ++i)
+        body();
+
+    vector<double> seconds(m_trials);
+    vector<unsigned long long> allocations(m_trials), bytes(m_trials);
+    for (int i = 0; i < m_trials; ++i)
+    {
+        unsigned long long allocationsBefore = microbenchAllocations, bytesBefore = microbenchAllocatedBytes;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        body();
+        seconds[i] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        allocations[i] = microbenchAllocations - allocationsBefore;
+        bytes[i] = microbenchAllocatedBytes - bytesBefore;
+    }
+
+    MicrobenchResult result;
+    result.name = name;
+    result.trials = m_trials;
+    result.median = Percentile(seconds, 0.5);
+    result.p95 = Percentile(seconds, 0.95);
+    result.fastest = *min_element(seconds.begin(), seconds.end());
+    result.allocations = Percentile(allocations, 0.5);
+    result.allocatedBytes = Percentile(bytes, 0.5);
+    result.items = items;
+    result.unit = unit;
+    m_results.push_back(result);
+
+    cout << "  " << name << ": " << result.median * 1e3 << " ms" << endl;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void Microbench::Print() const
+{
+    ios::fmtflags flags = cout.flags();
+    streamsize precision = cout.precision();
+    cout << left << setw(48) << "benchmark" << right << setw(12) << "median ms" << setw(12) << "p95 ms"
+         << setw(10) << "allocs" << setw(14) << "alloc bytes" << "  rate" << endl;
+    for (size_t i = 0; i < m_results.size(); ++i)
+    {
+        const MicrobenchResult &result = m_results[i];
+        cout << left << setw(48) << result.name << right << fixed << setprecision(3)
+             << setw(12) << result.median * 1e3 << setw(12) << result.p95 * 1e3
+             << setw(10) << result.allocations << setw(14) << result.allocatedBytes;
+        if (result.items > 0)
+            cout << "  " << setprecision(1) << result.items / result.median << " " << result.unit << "/s";
+        cout << endl;
+    }
+    cout.flags(flags);
+    cout.precision(precision);
+}
+
+// names are ours, but escape the two characters JSON strings cannot hold as is
+static string JsonString(const string &text)
+{
+    string quoted = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"' || text[i] == '\\') quoted += '\\';
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+bool Microbench::WriteJson(const string &filename) const
+{
+    FILE *file = fopen(filename.c_str(), "w");
+    if (!file) {
+        cout << "Microbench ERROR: could not write " << filename << endl;
+        return false;
+    }
+
+    fprintf(file, "{\n  \"warmup\": %d,\n  \"trials\": %d,\n  \"benchmarks\": [", m_warmup, m_trials);
+    for (size_t i = 0; i < m_results.size(); ++i)
+    {
+        const MicrobenchResult &result = m_results[i];
+        fprintf(file, "%s\n    {\"name\": %s, \"trials\": %d, \"median_s\": %.9g, \"p95_s\": %.9g, "
+                      "\"fastest_s\": %.9g, \"allocations\": %llu, \"allocated_bytes\": %llu",
+                i ? "," : "", JsonString(result.name).c_str(), result.trials, result.median, result.p95,
+                result.fastest, result.allocations, result.allocatedBytes);
+        if (result.items > 0)
+            fprintf(file, ", \"items\": %.9g, \"unit\": %s, \"items_per_s\": %.9g", result.items,
+                    JsonString(result.unit).c_str(), result.items / result.median);
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    bool written = !ferror(file);
+    fclose(file);
+    return written;
+}
+
+// --------------------------------------------------------------------------
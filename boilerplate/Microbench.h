@@ -0,0 +1,81 @@
+// ==========================================================================
+// Microbenchmarks
+//
+// This module times small pieces of the pipeline in isolation, the same
+// way every time, so numbers can be compared from one release to the next:
+//  - each benchmark runs a few untimed warm-up passes, then a fixed number
+//    of timed trials
+//  - it reports the median and 95th percentile trial time, the fastest
+//    trial, and the heap allocations and bytes allocated per trial
+//  - results print as a table and write as JSON for scripts to track
+//
+// Allocations are only counted in a program that replaces the global
+// operator new and adds to the counters below (bench/bench.cpp does);
+// elsewhere they read zero. C libraries that call malloc themselves, like
+// FreeType, are not counted.
+// ==========================================================================
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+// heap allocations and bytes since startup, kept by the replaced operator new
+extern std::atomic<unsigned long long> microbenchAllocations;
+extern std::atomic<unsigned long long> microbenchAllocatedBytes;
+
+struct MicrobenchResult
+{
+    std::string name;
+    int trials;
+
+    // trial times in seconds
+    double median, p95, fastest;
+
+    // per trial, the median over the timed trials
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+
+    // work done per trial, for rates; 0 when the benchmark gives none
+    double items;
+    std::string unit;
+};
+
+class Microbench
+{
+    int m_warmup, m_trials;
+    std::string m_filter;
+    std::vector<MicrobenchResult> m_results;
+
+public:
+    Microbench(int warmup = 3, int trials = 30);
+
+    // only benchmarks whose name contains filter run; empty runs them all
+    void SetFilter(const std::string &filter) { m_filter = filter; }
+
+    // whether a benchmark of this name would run, to skip costly set-up
+    bool Selected(const std::string &name) const
+    {
+        return m_filter.empty() || name.find(m_filter) != std::string::npos;
+    }
+
+    // times body, which does items units of work per call; returns false if
+    // the filter skipped it
+    bool Run(const std::string &name, const std::function<void()> &body, double items = 0,
+             const std::string &unit = "");
+
+    const std::vector<MicrobenchResult> &Results() const { return m_results; }
+
+    // one row per benchmark: median, p95 and allocations per trial, and the rate
+    void Print() const;
+
+    // {"warmup": .., "trials": .., "benchmarks": [{"name": .., "median_s": .., ...}]}
+    bool WriteJson(const std::string &filename) const;
+};
+
+// --------------------------------------------------------------------------
+#endif // MICROBENCH_H
@@ -0,0 +1,366 @@
+// ==========================================================================
+// Outline Simplification
+//
+// Drops, flattens, merges and refits contour segments within a tolerance.
+// Curve chains are refit with the least squares cubic fit of Schneider's
+// "An Algorithm for Automatically Fitting Digitized Curves" (Graphics Gems),
+// keeping the end tangents so the outline stays smooth where it was.
+// ==========================================================================
+
+#include "OutlineSimplifier.h"
+#include "Bezier.h"
+#include <algorithm>
+#include <float.h>
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+using namespace std;
+using namespace glm;
+
+// joints whose tangent directions have at least this cosine count as smooth
+static const float SMOOTH_COSINE = 0.995f;
+
+// longest chain of curves considered for one refit
+static const size_t MAX_CHAIN = 16;
+
+// samples per segment when fitting and when comparing old and new outlines
+static const int SAMPLES = 16;
+
+// reparameterisation passes of the cubic fit
+static const int FIT_ITERATIONS = 3;
+
+// --------------------------------------------------------------------------
+
+void SimplifyStats::Add(const SimplifyStats &other)
+{
+    segmentsIn += other.segmentsIn;
+    segmentsOut += other.segmentsOut;
+    degenerate += other.degenerate;
+    flattened += other.flattened;
+    linesMerged += other.linesMerged;
+    curvesRefit += other.curvesRefit;
+}
+
+// --------------------------------------------------------------------------
+// Geometry helpers
+
+static vec2 StartOf(const MySegment &segment)
+{
+    return SegmentPoint(segment, 0);
+}
+
+static vec2 EndOf(const MySegment &segment)
+{
+    return SegmentPoint(segment, segment.degree);
+}
+
+static float PointSegmentDistance(const vec2 &p, const vec2 &a, const vec2 &b)
+{
+    vec2 ab = b - a;
+    float length2 = dot(ab, ab);
+    float t = length2 > 0 ? clamp(dot(p - a, ab) / length2, 0.0f, 1.0f) : 0.0f;
+    return length(p - (a + t * ab));
+}
+
+// unit direction the curve leaves its start, skipping coincident control points
+static vec2 StartDirection(const MySegment &segment)
+{
+    vec2 p0 = StartOf(segment);
+    for (unsigned int i = 1; i <= segment.degree; ++i) {
+        vec2 d = SegmentPoint(segment, i) - p0;
+        if (dot(d, d) > 1e-14f) return normalize(d);
+    }
+    return vec2(0.0f);
+}
+
+// unit direction the curve arrives at its end with
+static vec2 EndDirection(const MySegment &segment)
+{
+    vec2 pn = EndOf(segment);
+    for (int i = int(segment.degree) - 1; i >= 0; --i) {
+        vec2 d = pn - SegmentPoint(segment, i);
+        if (dot(d, d) > 1e-14f) return normalize(d);
+    }
+    return vec2(0.0f);
+}
+
+static bool SmoothJoint(const MySegment &a, const MySegment &b)
+{
+    return dot(EndDirection(a), StartDirection(b)) > SMOOTH_COSINE;
+}
+
+// every control point lies within tolerance of the start point
+static bool IsDegenerate(const MySegment &segment, float tolerance)
+{
+    for (unsigned int i = 1; i <= segment.degree; ++i)
+        if (length(SegmentPoint(segment, i) - StartOf(segment)) > tolerance)
+            return false;
+    return true;
+}
+
+// every control point lies within tolerance of the chord; since the curve is
+// inside its control polygon's hull, so does the whole curve
+static bool IsFlat(const MySegment &segment, float tolerance)
+{
+    for (unsigned int i = 1; i < segment.degree; ++i)
+        if (PointSegmentDistance(SegmentPoint(segment, i), StartOf(segment), EndOf(segment)) > tolerance)
+            return false;
+    return true;
+}
+
+// lines first..last of a contour can be replaced by one line
+static bool LinesMerge(const MyContour &contour, size_t first, size_t last, float tolerance)
+{
+    vec2 a = StartOf(contour[first]);
+    vec2 b = EndOf(contour[last]);
+    if (length(b - a) <= tolerance) return false;
+
+    for (size_t i = first; i < last; ++i)
+        if (PointSegmentDistance(EndOf(contour[i]), a, b) > tolerance)
+            return false;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// Comparing outlines
+
+// polyline through perSegment samples of each of count segments
+static void Sample(const MySegment *segments, size_t count, int perSegment, vector<vec2> *points)
+{
+    points->clear();
+    points->push_back(StartOf(segments[0]));
+    for (size_t k = 0; k < count; ++k)
+        for (int i = 1; i <= perSegment; ++i)
+            points->push_back(EvaluateSegment(segments[k], float(i) / perSegment));
+}
+
+// largest distance from a point of one polyline to the other polyline
+static float OneSidedDistance(const vector<vec2> &from, const vector<vec2> &to)
+{
+    float worst = 0;
+    for (size_t i = 0; i < from.size(); ++i)
+    {
+        float best = FLT_MAX;
+        for (size_t j = 0; j + 1 < to.size() && best > worst; ++j)
+            best = std::min(best, PointSegmentDistance(from[i], to[j], to[j + 1]));
+        worst = std::max(worst, best);
+    }
+    return worst;
+}
+
+// true if a replacement cubic stays within tolerance of the original
+// segments and they stay within tolerance of it
+static bool WithinTolerance(const MySegment *original, size_t count, const MySegment &replacement, float tolerance)
+{
+    vector<vec2> a, b;
+    Sample(original, count, SAMPLES, &a);
+    Sample(&replacement, 1, SAMPLES * int(count), &b);
+    return OneSidedDistance(a, b) <= tolerance && OneSidedDistance(b, a) <= tolerance;
+}
+
+// --------------------------------------------------------------------------
+// Cubic fitting
+
+// least squares cubic from p0 to p3 with the given unit end tangents through
+// points at parameters u
+static MySegment FitWithParameters(const vector<vec2> &points, const vector<float> &u,
+                                   const vec2 &p0, const vec2 &p3, const vec2 &t1, const vec2 &t2)
+{
+    float c00 = 0, c01 = 0, c11 = 0, x0 = 0, x1 = 0;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        float s = 1.0f - u[i];
+        float b0 = s*s*s, b1 = 3*u[i]*s*s, b2 = 3*u[i]*u[i]*s, b3 = u[i]*u[i]*u[i];
+        vec2 a1 = t1 * b1;
+        vec2 a2 = t2 * b2;
+        vec2 rest = points[i] - (p0 * (b0 + b1) + p3 * (b2 + b3));
+
+        c00 += dot(a1, a1);
+        c01 += dot(a1, a2);
+        c11 += dot(a2, a2);
+        x0 += dot(a1, rest);
+        x1 += dot(a2, rest);
+    }
+
+    // fall back to a third of the chord when the system is singular or
+    // asks for tangents pointing the wrong way
+    float chord = length(p3 - p0);
+    float alpha1 = chord / 3, alpha2 = chord / 3;
+    float det = c00 * c11 - c01 * c01;
+    if (fabs(det) > 1e-12f)
+    {
+        float a1 = (x0 * c11 - x1 * c01) / det;
+        float a2 = (c00 * x1 - c01 * x0) / det;
+        if (a1 > 1e-6f * chord && a2 > 1e-6f * chord) {
+            alpha1 = a1;
+            alpha2 = a2;
+        }
+    }
+
+    MySegment cubic(3);
+    SetSegmentPoint(&cubic, 0, p0);
+    SetSegmentPoint(&cubic, 1, p0 + t1 * alpha1);
+    SetSegmentPoint(&cubic, 2, p3 + t2 * alpha2);
+    SetSegmentPoint(&cubic, 3, p3);
+    return cubic;
+}
+
+// fits one cubic to a chain of segments, keeping its ends and end tangents;
+// returns false if no cubic is within tolerance
+static bool FitCubic(const MySegment *segments, size_t count, float tolerance, MySegment *fit)
+{
+    vec2 p0 = StartOf(segments[0]);
+    vec2 p3 = EndOf(segments[count - 1]);
+    vec2 t1 = StartDirection(segments[0]);
+    vec2 t2 = -EndDirection(segments[count - 1]);
+    if (t1 == vec2(0.0f) || t2 == vec2(0.0f)) return false;
+
+    // initial parameters by chord length along the samples
+    vector<vec2> points;
+    Sample(segments, count, SAMPLES, &points);
+    vector<float> u(points.size(), 0.0f);
+    for (size_t i = 1; i < points.size(); ++i)
+        u[i] = u[i - 1] + length(points[i] - points[i - 1]);
+    if (u.back() <= 0) return false;
+    for (size_t i = 1; i < u.size(); ++i)
+        u[i] /= u.back();
+
+    MySegment cubic = FitWithParameters(points, u, p0, p3, t1, t2);
+    for (int pass = 0; pass < FIT_ITERATIONS; ++pass)
+    {
+        // one Newton step per sample towards its closest point on the fit
+        for (size_t i = 1; i + 1 < points.size(); ++i)
+        {
+            vec2 offset = EvaluateSegment(cubic, u[i]) - points[i];
+            vec2 d1 = EvaluateDerivative(cubic, u[i]);
+            vec2 d2 = EvaluateSecondDerivative(cubic, u[i]);
+            float denominator = dot(d1, d1) + dot(offset, d2);
+            if (fabs(denominator) > 1e-12f)
+                u[i] = clamp(u[i] - dot(offset, d1) / denominator, 0.0f, 1.0f);
+        }
+        cubic = FitWithParameters(points, u, p0, p3, t1, t2);
+    }
+
+    if (!WithinTolerance(segments, count, cubic, tolerance)) return false;
+    *fit = cubic;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void SimplifyContour(MyContour *contour, float tolerance, SimplifyStats *stats)
+{
+    MyContour &c = *contour;
+    SimplifyStats local;
+    local.segmentsIn = c.size();
+
+    // the steps stack (a flattened curve can then be merged into a line), so
+    // dropping and flattening get half the tolerance and merging and refitting
+    // the other half
+    float half = 0.5f * tolerance;
+
+    // drop segments that are all but a point, handing their start to the next
+    // segment; checking the next one from its new start keeps the total drift
+    // of a run of tiny segments within tolerance too
+    for (size_t i = 0; i < c.size() && c.size() > 1; )
+    {
+        if (IsDegenerate(c[i], half)) {
+            vec2 start = StartOf(c[i]);
+            c.erase(c.begin() + i);
+            SetSegmentPoint(&c[i < c.size() ? i : 0], 0, start);
+            local.degenerate++;
+        }
+        else ++i;
+    }
+
+    for (size_t i = 0; i < c.size(); ++i)
+    {
+        if (c[i].degree >= 2 && IsFlat(c[i], half)) {
+            vec2 end = EndOf(c[i]);
+            c[i].degree = 1;
+            SetSegmentPoint(&c[i], 1, end);
+            local.flattened++;
+        }
+    }
+
+    // start the contour at a corner so no run wraps around its end
+    for (size_t i = 0; i < c.size(); ++i)
+    {
+        if (!SmoothJoint(c[(i + c.size() - 1) % c.size()], c[i])) {
+            rotate(c.begin(), c.begin() + i, c.end());
+            break;
+        }
+    }
+
+    MyContour simplified;
+    for (size_t i = 0; i < c.size(); )
+    {
+        size_t next = i + 1;
+        MySegment replacement = c[i];
+
+        if (c[i].degree == 1)
+        {
+            while (next < c.size() && c[next].degree == 1 && LinesMerge(c, i, next, half))
+                ++next;
+            SetSegmentPoint(&replacement, 1, EndOf(c[next - 1]));
+            local.linesMerged += next - i - 1;
+        }
+        else if (c[i].degree >= 2)
+        {
+            // grow the chain while it stays smooth and one cubic still fits
+            MySegment fit;
+            while (next < c.size() && next - i < MAX_CHAIN && c[next].degree >= 2 &&
+                   SmoothJoint(c[next - 1], c[next]) && FitCubic(&c[i], next - i + 1, half, &fit))
+            {
+                replacement = fit;
+                ++next;
+            }
+            local.curvesRefit += next - i - 1;
+        }
+
+        simplified.push_back(replacement);
+        i = next;
+    }
+
+    c.swap(simplified);
+    local.segmentsOut = c.size();
+    if (stats) stats->Add(local);
+}
+
+void SimplifyGlyph(MyGlyph *glyph, float tolerance, SimplifyStats *stats)
+{
+    for (size_t i = 0; i < glyph->contours.size(); ++i)
+        SimplifyContour(&glyph->contours[i], tolerance, stats);
+}
+
+// --------------------------------------------------------------------------
+
+void ReportSimplification(const vector<string> &fontFiles, float tolerance)
+{
+    cout << "Outline simplification of printable ASCII at tolerance "
+         << tolerance << " EM" << endl;
+
+    for (size_t f = 0; f < fontFiles.size(); ++f)
+    {
+        GlyphExtractor extractor;
+        if (!extractor.LoadFontFile(fontFiles[f])) continue;
+
+        SimplifyStats stats;
+        for (int character = 33; character < 127; ++character)
+        {
+            MyGlyph glyph = extractor.ExtractGlyph(character);
+            SimplifyGlyph(&glyph, tolerance, &stats);
+        }
+
+        cout << fontFiles[f] << ":" << endl
+             << "  segments " << stats.segmentsIn << " -> " << stats.segmentsOut
+             << " (" << stats.segmentsIn - stats.segmentsOut << " removed)" << endl
+             << "  vertices " << stats.VerticesIn() << " -> " << stats.VerticesOut()
+             << " (" << stats.VerticesIn() - stats.VerticesOut() << " removed)" << endl
+             << "  degenerate " << stats.degenerate << ", flattened " << stats.flattened
+             << ", lines merged " << stats.linesMerged << ", curves refit " << stats.curvesRefit << endl;
+    }
+}
+
+// --------------------------------------------------------------------------
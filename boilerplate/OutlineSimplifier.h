@@ -0,0 +1,62 @@
+// ==========================================================================
+// Outline Simplification
+//
+// An optional preprocessing pass over MyContour that reduces the number of
+// segments (and so tessellated patches) in a glyph without moving its
+// outline by more than a given tolerance:
+//  - segments shorter than the tolerance are dropped
+//  - curves within the tolerance of their chord become lines
+//  - runs of collinear lines are merged into one line
+//  - smooth chains of curves are refit into a single cubic
+//
+// Corners are never smoothed over. Every replacement is accepted only if the
+// two-way distance between old and new geometry stays within the tolerance.
+// ==========================================================================
+#ifndef OUTLINESIMPLIFIER_H
+#define OUTLINESIMPLIFIER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// Counts of what a simplification pass changed
+
+struct SimplifyStats
+{
+    size_t segmentsIn;
+    size_t segmentsOut;
+
+    size_t degenerate;      // segments dropped for being within tolerance of a point
+    size_t flattened;       // curves turned into lines
+    size_t linesMerged;     // lines absorbed into a collinear neighbour
+    size_t curvesRefit;     // curves absorbed into a refit cubic
+
+    SimplifyStats() : segmentsIn(0), segmentsOut(0), degenerate(0), flattened(0),
+                      linesMerged(0), curvesRefit(0)
+    {}
+
+    // every segment is drawn as a 4 vertex patch
+    size_t VerticesIn() const { return 4 * segmentsIn; }
+    size_t VerticesOut() const { return 4 * segmentsOut; }
+
+    void Add(const SimplifyStats &other);
+};
+
+// --------------------------------------------------------------------------
+
+// simplifies a closed contour in place; tolerance is in the contour's units
+// (EMs for extracted glyphs). Stats are accumulated into stats if given.
+void SimplifyContour(MyContour *contour, float tolerance, SimplifyStats *stats = 0);
+
+// simplifies every contour of a glyph
+void SimplifyGlyph(MyGlyph *glyph, float tolerance, SimplifyStats *stats = 0);
+
+// extracts the printable ASCII glyphs of each font, simplifies them and
+// prints the segments and vertices removed per font
+void ReportSimplification(const std::vector<std::string> &fontFiles, float tolerance);
+
+// --------------------------------------------------------------------------
+#endif // OUTLINESIMPLIFIER_H
@@ -0,0 +1,621 @@
+// ==========================================================================
+// Paragraph Layout
+//
+// The item model and the optimal breaker follow Knuth and Plass, "Breaking
+// Paragraphs into Lines" (1981): a line may end at glue that follows a box,
+// or at a penalty; the badness of a line grows with the cube of how far its
+// glue stretches or shrinks, and the breaker keeps, for every place a line
+// could end, the cheapest way of getting there from the paragraph start.
+//
+// When no set of breaks keeps every line within the tolerance, a second pass
+// allows lines of any looseness, as TeX's emergency pass does; when even
+// that fails, the paragraph is broken greedily instead.
+//
+// A word wider than the line could never fit, so for as long as the width
+// stays narrower than it, its box is cut into pieces that each fit, with a
+// place to break between them and no hyphen.
+// ==========================================================================
+
+#include "ParagraphLayout.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <math.h>
+
+using namespace std;
+
+const float ParagraphLayout::PENALTY_FORCED = -10000.0f;
+
+// cost of breaking at a hyphen, the same for added and explicit ones
+static const float HYPHEN_PENALTY = 50.0f;
+
+// interword glue stretches by half a space and shrinks by a third
+static const float GLUE_STRETCH = 0.5f;
+static const float GLUE_SHRINK = 1.0f / 3.0f;
+
+// cost of breaking between the pieces of a word too wide for the line
+static const float SPLIT_PENALTY = 0.0f;
+
+// word widths kept per font set and size; past this many the cache starts
+// over, so its memory follows the words of the paragraphs in use
+static const size_t MAX_CACHED_WORDS = 1 << 16;
+
+// the glue that fills out the last line of a paragraph
+static const float FILL_STRETCH = 1e6f;
+
+// optimal breaking: the loosest line allowed on the first pass, and on the
+// second (short of lines that cannot stretch at all), and the demerits added per
+// line, for two hyphenated lines in a row and for lines of very different
+// tightness next to each other
+static const double TOLERANCE = 4.0;
+static const double EMERGENCY_TOLERANCE = 1e8;
+static const double LINE_DEMERITS = 10.0;
+static const double HYPHENS_DEMERITS = 3000.0;
+static const double FITNESS_DEMERITS = 100.0;
+
+// --------------------------------------------------------------------------
+
+const char *TextAlignmentName(TextAlignment alignment)
+{
+    switch (alignment) {
+    case ALIGN_LEFT:      return "left";
+    case ALIGN_CENTRE:    return "centre";
+    case ALIGN_JUSTIFIED: return "justified";
+    default:              return "?";
+    }
+}
+
+const char *LineBreakingName(LineBreaking breaking)
+{
+    switch (breaking) {
+    case BREAK_GREEDY:  return "greedy";
+    case BREAK_OPTIMAL: return "optimal";
+    default:            return "?";
+    }
+}
+
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// the first item a line that follows a break at item b starts with: glue
+// and penalties after a break are dropped
+static size_t NextLineStart(const CountedVector<ParagraphLayout::Item, MEMORY_LAYOUT> &items, size_t b)
+{
+    size_t next = b + 1;
+    while (next < items.size() && items[next].type != ParagraphLayout::Item::BOX &&
+           !(items[next].type == ParagraphLayout::Item::PENALTY && items[next].penalty <= ParagraphLayout::PENALTY_FORCED))
+        ++next;
+    return next;
+}
+
+// --------------------------------------------------------------------------
+
+ParagraphLayout::ParagraphLayout()
+    : m_text(0), m_fonts(0), m_size(1.0f), m_width(40.0f), m_alignment(ALIGN_LEFT), m_breaking(BREAK_GREEDY),
+      m_itemsVersion(1), m_linesVersion(1), m_words(&m_wordTables[FontKey(0, 1.0f)]), m_spaceWidth(0),
+      m_hyphenWidth(0)
+{
+    m_stats.paragraphsBroken = m_stats.paragraphsMeasured = 0;
+    m_stats.wordsMeasured = m_stats.wordsCached = 0;
+}
+
+void ParagraphLayout::SetFonts(const FontSet *fonts, float size)
+{
+    if (fonts == m_fonts && size == m_size) return;
+    m_fonts = fonts;
+    m_size = size;
+    m_words = &m_wordTables[FontKey(fonts, size)];
+    m_spaceWidth = Advance(' ');
+    m_hyphenWidth = Advance('-');
+    ++m_itemsVersion;
+}
+
+void ParagraphLayout::SetWidth(float width)
+{
+    if (width == m_width) return;
+    m_width = width;
+    ++m_linesVersion;
+}
+
+void ParagraphLayout::SetAlignment(TextAlignment alignment)
+{
+    if (alignment == m_alignment) return;
+    m_alignment = alignment;
+    ++m_linesVersion;
+}
+
+void ParagraphLayout::SetLineBreaking(LineBreaking breaking)
+{
+    if (breaking == m_breaking) return;
+    m_breaking = breaking;
+    ++m_linesVersion;
+}
+
+void ParagraphLayout::SetHyphenator(const Hyphenator &hyphenator)
+{
+    // cached words hold the breaks of the old hyphenator
+    m_hyphenator = hyphenator;
+    for (map<FontKey, WordTable>::iterator i = m_wordTables.begin(); i != m_wordTables.end(); ++i)
+        i->second.clear();
+    ++m_itemsVersion;
+}
+
+// --------------------------------------------------------------------------
+
+void ParagraphLayout::SetText(const string &text)
+{
+    m_text = &text;
+    m_paragraphs.clear();
+}
+
+size_t ParagraphLayout::AddParagraph(size_t begin, size_t end)
+{
+    m_paragraphs.push_back(Paragraph());
+    Paragraph &added = m_paragraphs.back();
+    added.begin = begin;
+    added.end = end;
+    added.itemsVersion = added.linesVersion = 0;
+    added.widestBox = added.splitWidth = 0;
+    return m_paragraphs.size() - 1;
+}
+
+void ParagraphLayout::InsertParagraph(size_t begin, size_t end)
+{
+    m_paragraphs.push_front(Paragraph());
+    Paragraph &added = m_paragraphs.front();
+    added.begin = begin;
+    added.end = end;
+    added.itemsVersion = added.linesVersion = 0;
+    added.widestBox = added.splitWidth = 0;
+}
+
+void ParagraphLayout::RemoveParagraphs(size_t first, size_t count)
+{
+    m_paragraphs.erase(m_paragraphs.begin() + first, m_paragraphs.begin() + first + count);
+}
+
+void ParagraphLayout::Clear()
+{
+    m_paragraphs.clear();
+}
+
+size_t ParagraphLayout::Update()
+{
+    size_t broken = 0;
+    for (size_t i = 0; i < m_paragraphs.size(); ++i)
+        if (m_paragraphs[i].itemsVersion != m_itemsVersion || m_paragraphs[i].linesVersion != m_linesVersion) {
+            Layout(&m_paragraphs[i]);
+            ++broken;
+        }
+    return broken;
+}
+
+const CountedVector<LayoutLine, MEMORY_LAYOUT> &ParagraphLayout::Lines(size_t paragraph)
+{
+    Layout(&m_paragraphs[paragraph]);
+    return m_paragraphs[paragraph].lines;
+}
+
+void ParagraphLayout::PlaceGlyphs(size_t paragraph, size_t line, vector<PlacedGlyph> *glyphs)
+{
+    glyphs->clear();
+    const Paragraph &source = m_paragraphs[paragraph];
+    const LayoutLine &placed = Lines(paragraph)[line];
+
+    float pen = placed.x;
+    for (size_t i = placed.firstItem; i < placed.endItem; ++i)
+    {
+        const Item &item = source.items[i];
+        if (item.type == Item::GLUE) {
+            pen += item.width + placed.ratio * (placed.ratio > 0 ? item.stretch : item.shrink);
+        }
+        else if (item.type == Item::BOX) {
+            size_t length;
+            for (size_t j = item.begin; j < item.end; j += length) {
+                PlacedGlyph glyph;
+                length = DecodeUtf8(*m_text, j, &glyph.codepoint);
+                glyph.x = pen;
+                glyphs->push_back(glyph);
+                pen += Advance(glyph.codepoint);
+            }
+        }
+    }
+    if (placed.hyphen) {
+        PlacedGlyph glyph = {'-', pen};
+        glyphs->push_back(glyph);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+float ParagraphLayout::Advance(unsigned int codepoint) const
+{
+    if (codepoint == '\t') return TAB_WIDTH * m_spaceWidth;
+    if (codepoint < 32 || !m_fonts) return 0;
+    return m_fonts->Metrics(codepoint).advance * m_size;
+}
+
+const ParagraphLayout::WordMetrics &ParagraphLayout::Word(const string &word)
+{
+    WordTable::iterator found = m_words->find(word);
+    if (found != m_words->end()) {
+        ++m_stats.wordsCached;
+        return found->second;
+    }
+    ++m_stats.wordsMeasured;
+
+    // where the word may break: after its own hyphens, without adding one,
+    // and wherever the hyphenator allows, adding one
+    vector<pair<size_t, bool> > candidates;
+    for (size_t i = 0; i + 1 < word.size(); ++i)
+        if (word[i] == '-') candidates.push_back(make_pair(i + 1, false));
+    if (m_hyphenator) {
+        vector<size_t> offsets;
+        m_hyphenator(word, &offsets);
+        for (size_t i = 0; i < offsets.size(); ++i)
+            if (offsets[i] > 0 && offsets[i] < word.size()) candidates.push_back(make_pair(offsets[i], true));
+    }
+    sort(candidates.begin(), candidates.end());
+
+    if (m_words->size() >= MAX_CACHED_WORDS) m_words->clear();
+    WordMetrics &metrics = (*m_words)[word];
+    metrics.width = 0;
+    size_t next = 0, length;
+    for (size_t i = 0; i < word.size(); i += length)
+    {
+        // offsets inside a UTF-8 sequence are dropped
+        while (next < candidates.size() && candidates[next].first < i) ++next;
+        if (next < candidates.size() && candidates[next].first == i) {
+            WordBreak wordBreak = {i, metrics.width, candidates[next].second};
+            metrics.breaks.push_back(wordBreak);
+            while (next < candidates.size() && candidates[next].first == i) ++next;
+        }
+
+        unsigned int c;
+        length = DecodeUtf8(word, i, &c);
+        metrics.width += Advance(c);
+    }
+    return metrics;
+}
+
+void ParagraphLayout::AddBox(Paragraph *paragraph, const Item &box)
+{
+    paragraph->widestBox = std::max(paragraph->widestBox, box.width);
+    if (box.width <= m_width) {
+        paragraph->items.push_back(box);
+        return;
+    }
+
+    // pieces as wide as fit, each at least one character
+    paragraph->splitWidth = m_width;
+    Item piece = box, split = box;
+    split.type = Item::PENALTY;
+    split.width = 0;
+    split.penalty = SPLIT_PENALTY;
+    piece.width = 0;
+    size_t length;
+    for (size_t i = box.begin; i < box.end; i += length)
+    {
+        unsigned int c;
+        length = DecodeUtf8(*m_text, i, &c);
+        float advance = Advance(c);
+        if (i > piece.begin && piece.width + advance > m_width) {
+            piece.end = i;
+            paragraph->items.push_back(piece);
+            split.begin = split.end = i;
+            paragraph->items.push_back(split);
+            piece.begin = i;
+            piece.width = 0;
+        }
+        piece.width += advance;
+    }
+    piece.end = box.end;
+    paragraph->items.push_back(piece);
+}
+
+void ParagraphLayout::BuildItems(Paragraph *paragraph)
+{
+    const string &text = *m_text;
+    size_t end = paragraph->end;
+    CountedVector<Item, MEMORY_LAYOUT> &items = paragraph->items;
+    items.clear();
+    paragraph->widestBox = paragraph->splitWidth = 0;
+
+    Item item;
+    item.stretch = item.shrink = item.penalty = 0;
+    item.hyphen = false;
+
+    // leading spaces indent the first line and neither break nor stretch
+    size_t i = paragraph->begin;
+    while (i < end && IsSpace(text[i])) ++i;
+    if (i > paragraph->begin) {
+        item.type = Item::BOX;
+        item.width = 0;
+        for (size_t j = paragraph->begin; j < i; ++j)
+            item.width += Advance((unsigned char)text[j]);
+        item.begin = paragraph->begin;
+        item.end = i;
+        AddBox(paragraph, item);
+    }
+
+    while (i < end)
+    {
+        size_t next = i;
+        if (IsSpace(text[i])) {
+            item.type = Item::GLUE;
+            item.width = 0;
+            for (; next < end && IsSpace(text[next]); ++next)
+                item.width += Advance((unsigned char)text[next]);
+            item.stretch = GLUE_STRETCH * item.width;
+            item.shrink = GLUE_SHRINK * item.width;
+            item.begin = i;
+            item.end = next;
+            items.push_back(item);
+            item.stretch = item.shrink = 0;
+            i = next;
+            continue;
+        }
+
+        while (next < end && !IsSpace(text[next])) ++next;
+        m_word.assign(text, i, next - i);
+        const WordMetrics &word = Word(m_word);
+
+        // a word is a box per fragment, with a penalty between fragments
+        size_t fragment = 0;
+        float fragmentWidth = 0;
+        for (size_t b = 0; b < word.breaks.size(); ++b)
+        {
+            const WordBreak &wordBreak = word.breaks[b];
+            item.type = Item::BOX;
+            item.width = wordBreak.prefixWidth - fragmentWidth;
+            item.begin = i + fragment;
+            item.end = i + wordBreak.offset;
+            AddBox(paragraph, item);
+
+            item.type = Item::PENALTY;
+            item.width = wordBreak.hyphen ? m_hyphenWidth : 0;
+            item.penalty = HYPHEN_PENALTY;
+            item.hyphen = wordBreak.hyphen;
+            item.begin = item.end = i + wordBreak.offset;
+            items.push_back(item);
+            item.penalty = 0;
+            item.hyphen = false;
+
+            fragment = wordBreak.offset;
+            fragmentWidth = wordBreak.prefixWidth;
+        }
+        item.type = Item::BOX;
+        item.width = word.width - fragmentWidth;
+        item.begin = i + fragment;
+        item.end = next;
+        AddBox(paragraph, item);
+        i = next;
+    }
+
+    // the last line is filled out by glue that stretches without limit
+    item.type = Item::GLUE;
+    item.width = 0;
+    item.stretch = FILL_STRETCH;
+    item.begin = item.end = end;
+    items.push_back(item);
+
+    item.type = Item::PENALTY;
+    item.stretch = 0;
+    item.penalty = PENALTY_FORCED;
+    items.push_back(item);
+}
+
+// --------------------------------------------------------------------------
+
+void ParagraphLayout::BreakGreedy(const Paragraph &paragraph, vector<size_t> *breaks) const
+{
+    const CountedVector<Item, MEMORY_LAYOUT> &items = paragraph.items;
+    breaks->clear();
+
+    // width is that of the line from its start to item i
+    double width = 0;
+    size_t candidate = items.size();
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        const Item &item = items[i];
+        size_t lineEnd = items.size();
+        if (item.type == Item::BOX) {
+            width += item.width;
+            if (width > m_width && candidate < items.size()) lineEnd = candidate;
+        }
+        else if (item.type == Item::PENALTY && item.penalty <= PENALTY_FORCED) {
+            breaks->push_back(i);
+            return;
+        }
+        else if (item.type == Item::PENALTY || (i > 0 && items[i - 1].type == Item::BOX)) {
+            // a line too wide even here ends here: it cannot get narrower
+            double ending = width + (item.type == Item::PENALTY ? item.width : 0);
+            if (ending <= m_width) candidate = i;
+            else if (candidate == items.size()) lineEnd = i;
+            else lineEnd = candidate;
+        }
+        if (item.type == Item::GLUE && lineEnd == items.size()) width += item.width;
+
+        if (lineEnd < items.size()) {
+            breaks->push_back(lineEnd);
+            i = NextLineStart(items, lineEnd) - 1;
+            width = 0;
+            candidate = items.size();
+        }
+    }
+}
+
+bool ParagraphLayout::BreakOptimal(const Paragraph &paragraph, double tolerance, vector<size_t> *breaks)
+{
+    const CountedVector<Item, MEMORY_LAYOUT> &items = paragraph.items;
+
+    vector<BreakNode> &nodes = m_nodes;
+    vector<int> &active = m_active;
+    nodes.clear();
+    active.clear();
+    BreakNode start = {0, 1, 0, 0, 0, 0, -1};
+    nodes.push_back(start);
+    active.push_back(0);
+
+    double width = 0, stretch = 0, shrink = 0;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        const Item &item = items[i];
+        if (item.type == Item::BOX) {
+            width += item.width;
+            continue;
+        }
+        if (item.type == Item::GLUE && !(i > 0 && items[i - 1].type == Item::BOX)) {
+            width += item.width;
+            stretch += item.stretch;
+            shrink += item.shrink;
+            continue;
+        }
+
+        // item i is a legal break: try ending a line here after every active node
+        bool forced = item.type == Item::PENALTY && item.penalty <= PENALTY_FORCED;
+        bool flagged = item.type == Item::PENALTY && !forced;
+        double best[4] = {-1, -1, -1, -1};
+        int bestFrom[4] = {-1, -1, -1, -1};
+        for (size_t a = 0; a < active.size(); )
+        {
+            const BreakNode &from = nodes[active[a]];
+            double length = width - from.width + (item.type == Item::PENALTY ? item.width : 0);
+            double ratio = 0;
+            if (length < m_width)
+                ratio = stretch > from.stretch ? (m_width - length) / (stretch - from.stretch) : 1e9;
+            else if (length > m_width)
+                ratio = shrink > from.shrink ? (m_width - length) / (shrink - from.shrink) : -1e9;
+
+            if (ratio >= -1 && ratio <= tolerance) {
+                double badness = 100 * fabs(ratio * ratio * ratio);
+                double demerits = (LINE_DEMERITS + badness) * (LINE_DEMERITS + badness);
+                if (item.type == Item::PENALTY && !forced) demerits += item.penalty * item.penalty;
+                if (flagged && items[from.position].type == Item::PENALTY &&
+                    items[from.position].penalty > PENALTY_FORCED)
+                    demerits += HYPHENS_DEMERITS;
+                int fitness = ratio < -0.5 ? 0 : ratio <= 0.5 ? 1 : ratio <= 1 ? 2 : 3;
+                if (abs(fitness - from.fitness) > 1) demerits += FITNESS_DEMERITS;
+                demerits += from.demerits;
+                if (best[fitness] < 0 || demerits < best[fitness]) {
+                    best[fitness] = demerits;
+                    bestFrom[fitness] = active[a];
+                }
+            }
+
+            // no line from this node can end later without being too tight
+            if (ratio < -1 || forced) {
+                active[a] = active.back();
+                active.pop_back();
+            }
+            else ++a;
+        }
+
+        // totals after the break skip the glue and penalties a line drops at its start
+        double afterWidth = width, afterStretch = stretch, afterShrink = shrink;
+        for (size_t j = i; j < items.size() && items[j].type != Item::BOX; ++j) {
+            if (j > i && items[j].type == Item::PENALTY && items[j].penalty <= PENALTY_FORCED) break;
+            if (items[j].type == Item::GLUE) {
+                afterWidth += items[j].width;
+                afterStretch += items[j].stretch;
+                afterShrink += items[j].shrink;
+            }
+        }
+        for (int f = 0; f < 4; ++f)
+            if (bestFrom[f] >= 0) {
+                BreakNode node = {i, f, afterWidth, afterStretch, afterShrink, best[f], bestFrom[f]};
+                nodes.push_back(node);
+                active.push_back(int(nodes.size() - 1));
+            }
+        if (active.empty()) return false;
+
+        if (item.type == Item::GLUE) {
+            width += item.width;
+            stretch += item.stretch;
+            shrink += item.shrink;
+        }
+    }
+
+    // every node left ends at the final forced break; take the cheapest
+    int last = -1;
+    for (size_t a = 0; a < active.size(); ++a)
+        if (nodes[active[a]].position == items.size() - 1 &&
+            (last < 0 || nodes[active[a]].demerits < nodes[last].demerits))
+            last = active[a];
+    if (last < 0) return false;
+
+    breaks->clear();
+    for (int n = last; nodes[n].previous >= 0; n = nodes[n].previous)
+        breaks->push_back(nodes[n].position);
+    reverse(breaks->begin(), breaks->end());
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void ParagraphLayout::BuildLines(Paragraph *paragraph, const vector<size_t> &breaks) const
+{
+    const CountedVector<Item, MEMORY_LAYOUT> &items = paragraph->items;
+    paragraph->lines.clear();
+
+    size_t start = 0;
+    for (size_t b = 0; b < breaks.size(); ++b)
+    {
+        size_t end = breaks[b];
+        const Item &breakItem = items[end];
+        bool last = breakItem.type == Item::PENALTY && breakItem.penalty <= PENALTY_FORCED;
+
+        LayoutLine line;
+        line.firstItem = start;
+        line.endItem = end;
+        line.begin = start < end ? items[start].begin : breakItem.begin;
+        line.end = line.begin;
+        line.hyphen = breakItem.type == Item::PENALTY && breakItem.hyphen;
+
+        double width = line.hyphen ? breakItem.width : 0, stretch = 0, shrink = 0;
+        for (size_t i = start; i < end; ++i) {
+            if (items[i].type == Item::PENALTY) continue;
+            width += items[i].width;
+            if (items[i].type == Item::GLUE) {
+                stretch += items[i].stretch;
+                shrink += items[i].shrink;
+            }
+            if (items[i].type == Item::BOX) line.end = items[i].end;
+        }
+        line.width = float(width);
+
+        line.ratio = 0;
+        if (m_alignment == ALIGN_JUSTIFIED && !last) {
+            if (width < m_width && stretch > 0) line.ratio = float((m_width - width) / stretch);
+            else if (width > m_width && shrink > 0) line.ratio = float(std::max((m_width - width) / shrink, -1.0));
+        }
+        line.x = m_alignment == ALIGN_CENTRE ? std::max(0.5f * (m_width - line.width), 0.0f) : 0.0f;
+
+        paragraph->lines.push_back(line);
+        start = NextLineStart(items, end);
+    }
+}
+
+void ParagraphLayout::Layout(Paragraph *paragraph)
+{
+    // words cut to fit another width are cut again, or joined back up
+    bool resplit = (paragraph->widestBox > m_width || paragraph->splitWidth > 0) && paragraph->splitWidth != m_width;
+    if (paragraph->itemsVersion != m_itemsVersion || (resplit && paragraph->linesVersion != m_linesVersion)) {
+        BuildItems(paragraph);
+        paragraph->itemsVersion = m_itemsVersion;
+        paragraph->linesVersion = 0;
+        ++m_stats.paragraphsMeasured;
+    }
+    if (paragraph->linesVersion == m_linesVersion) return;
+
+    if (m_breaking != BREAK_OPTIMAL || (!BreakOptimal(*paragraph, TOLERANCE, &m_breaks) &&
+                                        !BreakOptimal(*paragraph, EMERGENCY_TOLERANCE, &m_breaks)))
+        BreakGreedy(*paragraph, &m_breaks);
+    BuildLines(paragraph, m_breaks);
+    paragraph->linesVersion = m_linesVersion;
+    ++m_stats.paragraphsBroken;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,214 @@
+// ==========================================================================
+// Paragraph Layout
+//
+// This module breaks paragraphs of UTF-8 text into lines of a given width
+// and places their glyphs, using the advance widths of a FontSet:
+//  - Text becomes a list of boxes (words and word fragments), glue (runs
+//    of spaces, which may stretch and shrink) and penalties (places a word
+//    may be broken, after an explicit '-' or where a Hyphenator allows one)
+//  - Lines are broken greedily (each line as full as it can be) or by the
+//    Knuth-Plass algorithm, which picks the breaks minimizing the badness
+//    of the whole paragraph, so loose lines are not left behind tight ones
+//  - Lines are aligned left, centred or justified; justified lines stretch
+//    or shrink their glue to the width, except the last of each paragraph
+//
+// Paragraphs are byte ranges of one text, which the layout does not copy.
+// Word widths are measured once per (font set, size) and cached, and each
+// paragraph keeps its boxes and glue, so changing the width only re-runs
+// the line breaker over numbers already known. A change marks every
+// paragraph out of date, but a paragraph is only broken again when its
+// lines are asked for; paragraphs can be added and removed at either end,
+// so a caller can hold just those it shows.
+//
+// Widths are in the units of size: pass 1 to lay out in EM units.
+// ==========================================================================
+#ifndef PARAGRAPHLAYOUT_H
+#define PARAGRAPHLAYOUT_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "FontSet.h"
+
+// tabs are as wide as this many spaces
+const int TAB_WIDTH = 4;
+
+enum TextAlignment { ALIGN_LEFT, ALIGN_CENTRE, ALIGN_JUSTIFIED, ALIGN_COUNT };
+enum LineBreaking { BREAK_GREEDY, BREAK_OPTIMAL, BREAK_COUNT };
+
+const char *TextAlignmentName(TextAlignment alignment);
+const char *LineBreakingName(LineBreaking breaking);
+
+// fills breaks with the byte offsets within word (never 0 or its length)
+// where it may be broken with a hyphen added, in increasing order
+typedef std::function<void(const std::string &word, std::vector<size_t> *breaks)> Hyphenator;
+
+// one line of a laid out paragraph
+struct LayoutLine
+{
+    size_t begin, end;      // bytes of the text on the line, without the spaces it broke at
+    size_t firstItem, endItem;
+    float x;                // where the line starts, after alignment
+    float width;            // natural width, including an added hyphen
+    float ratio;            // how far glue stretches (> 0) or shrinks (< 0), as a fraction of what it can
+    bool hyphen;            // a hyphen not in the text ends the line
+};
+
+struct PlacedGlyph
+{
+    unsigned int codepoint;
+    float x;                // pen position, in the units of size
+};
+
+struct LayoutStats
+{
+    unsigned long long paragraphsBroken;    // paragraphs whose lines were computed
+    unsigned long long paragraphsMeasured;  // paragraphs whose boxes and glue were built
+    unsigned long long wordsMeasured;       // word widths computed from glyph advances
+    unsigned long long wordsCached;         // word widths found in the cache
+};
+
+// --------------------------------------------------------------------------
+
+class ParagraphLayout
+{
+public:
+    struct Item
+    {
+        enum Type { BOX, GLUE, PENALTY } type;
+        float width;
+        float stretch, shrink;  // glue only
+        float penalty;          // penalty only; PENALTY_FORCED ends a line
+        bool hyphen;            // penalty only: breaking here adds a hyphen
+        size_t begin, end;      // bytes of the text covered
+    };
+
+    static const float PENALTY_FORCED;
+
+private:
+    // a place a word may break, and the width of the word up to it
+    struct WordBreak
+    {
+        size_t offset;
+        float prefixWidth;
+        bool hyphen;            // breaking here adds a hyphen
+    };
+
+    struct WordMetrics
+    {
+        float width;
+        CountedVector<WordBreak, MEMORY_LAYOUT> breaks;
+    };
+    typedef std::unordered_map<std::string, WordMetrics, std::hash<std::string>, std::equal_to<std::string>,
+                               CountingAllocator<std::pair<const std::string, WordMetrics>, MEMORY_LAYOUT> >
+        WordTable;
+    typedef std::pair<const FontSet*, float> FontKey;
+
+    struct Paragraph
+    {
+        size_t begin, end;              // bytes of the text
+        CountedVector<Item, MEMORY_LAYOUT> items;
+        CountedVector<LayoutLine, MEMORY_LAYOUT> lines;
+        unsigned int itemsVersion;      // m_itemsVersion when items were built, 0 for never
+        unsigned int linesVersion;      // m_linesVersion when lines were broken, 0 for never
+        float widestBox;                // before boxes wider than the line were cut up
+        float splitWidth;               // the width boxes were cut up to fit, 0 for none
+    };
+
+    const std::string *m_text;
+    const FontSet *m_fonts;
+    float m_size;
+    float m_width;
+    TextAlignment m_alignment;
+    LineBreaking m_breaking;
+    Hyphenator m_hyphenator;
+
+    // bumped when items (font, size, hyphenation) or lines (width, settings)
+    // of every paragraph go out of date
+    unsigned int m_itemsVersion, m_linesVersion;
+
+    std::deque<Paragraph> m_paragraphs;
+    std::map<FontKey, WordTable> m_wordTables;
+    WordTable *m_words;                 // the table of the current font and size
+    float m_spaceWidth, m_hyphenWidth;
+
+    LayoutStats m_stats;
+
+    // a way of breaking a paragraph up to item position; width, stretch
+    // and shrink are the totals of the items before the line after it
+    struct BreakNode
+    {
+        size_t position;
+        int fitness;
+        double width, stretch, shrink;
+        double demerits;
+        int previous;
+    };
+
+    // scratch space of the word cache and the line breakers
+    std::string m_word;
+    std::vector<size_t> m_breaks;
+    std::vector<BreakNode> m_nodes;
+    std::vector<int> m_active;
+
+    float Advance(unsigned int codepoint) const;
+    const WordMetrics &Word(const std::string &word);
+    void AddBox(Paragraph *paragraph, const Item &box);
+    void BuildItems(Paragraph *paragraph);
+    void BreakGreedy(const Paragraph &paragraph, std::vector<size_t> *breaks) const;
+    bool BreakOptimal(const Paragraph &paragraph, double tolerance, std::vector<size_t> *breaks);
+    void BuildLines(Paragraph *paragraph, const std::vector<size_t> &breaks) const;
+    void Layout(Paragraph *paragraph);
+
+public:
+    ParagraphLayout();
+
+    // the fonts and size glyph advances are measured with; fonts must
+    // outlive the layout
+    void SetFonts(const FontSet *fonts, float size = 1.0f);
+    void SetWidth(float width);
+    void SetAlignment(TextAlignment alignment);
+    void SetLineBreaking(LineBreaking breaking);
+
+    // an empty hyphenator only breaks words after the hyphens they contain
+    void SetHyphenator(const Hyphenator &hyphenator);
+
+    float Width() const { return m_width; }
+    TextAlignment Alignment() const { return m_alignment; }
+    LineBreaking Breaking() const { return m_breaking; }
+
+    // the text paragraphs are byte ranges of, which must outlive them and
+    // not change under them; removes every paragraph
+    void SetText(const std::string &text);
+
+    // paragraphs hold text without line breaks; one can be added after the
+    // last or inserted before the first, which shifts the others up one
+    size_t AddParagraph(size_t begin, size_t end);
+    void InsertParagraph(size_t begin, size_t end);
+    void RemoveParagraphs(size_t first, size_t count);
+    void Clear();
+    size_t ParagraphCount() const { return m_paragraphs.size(); }
+    size_t ParagraphBegin(size_t paragraph) const { return m_paragraphs[paragraph].begin; }
+    size_t ParagraphEnd(size_t paragraph) const { return m_paragraphs[paragraph].end; }
+
+    // breaks every paragraph that is out of date; returns how many it broke
+    size_t Update();
+
+    // the lines of a paragraph, broken first if out of date; there is at
+    // least one, even for an empty paragraph
+    const CountedVector<LayoutLine, MEMORY_LAYOUT> &Lines(size_t paragraph);
+
+    // codepoints of a line and their pen positions, a trailing hyphen
+    // included; glyphs is cleared first
+    void PlaceGlyphs(size_t paragraph, size_t line, std::vector<PlacedGlyph> *glyphs);
+
+    const LayoutStats &Stats() const { return m_stats; }
+};
+
+// --------------------------------------------------------------------------
+#endif // PARAGRAPHLAYOUT_H
@@ -0,0 +1,93 @@
+// ==========================================================================
+// Background Scene Building
+//
+// A single worker thread with a request queue; scenes are few and each
+// build is short, so one worker keeps builds in the order asked for.
+// ==========================================================================
+
+#include "SceneBuilder.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+using namespace glm;
+
+// --------------------------------------------------------------------------
+
+size_t SceneData::GpuBytes() const
+{
+    if (file.IsOpen())
+        return file.PointCount() * (sizeof(vec2) + sizeof(vec3) + sizeof(vec4)) +
+               file.IndexCount() * sizeof(unsigned int);
+    return points.size() * sizeof(vec2) + colours.size() * sizeof(vec3);
+}
+
+// --------------------------------------------------------------------------
+
+void SceneBuilder::Start(SceneBuildFunction build)
+{
+    Stop();
+    m_build = build;
+    m_stop = false;
+    m_thread = thread(&SceneBuilder::Run, this);
+}
+
+void SceneBuilder::Stop()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+        m_requests.clear();
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+
+    for (size_t i = 0; i < m_finished.size(); ++i)
+        delete m_finished[i];
+    m_finished.clear();
+}
+
+void SceneBuilder::Request(int scene)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (find(m_requests.begin(), m_requests.end(), scene) != m_requests.end()) return;
+        m_requests.push_back(scene);
+    }
+    m_wake.notify_one();
+}
+
+SceneData *SceneBuilder::TakeFinished()
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (m_finished.empty()) return 0;
+    SceneData *data = m_finished.front();
+    m_finished.erase(m_finished.begin());
+    return data;
+}
+
+void SceneBuilder::Run()
+{
+    unique_lock<mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_stop || !m_requests.empty(); });
+        if (m_stop) return;
+
+        int scene = m_requests.front();
+        m_requests.pop_front();
+        lock.unlock();
+
+        // built without the lock, so requests and takes never wait on FreeType
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        SceneData *data = new SceneData(scene);
+        m_build(data);
+        data->buildSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+        lock.lock();
+        m_finished.push_back(data);
+    }
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,99 @@
+// ==========================================================================
+// Background Scene Building
+//
+// This module builds the CPU half of scenes on a worker thread, so mapping
+// scene files, extracting glyphs with FreeType and building BVHs never
+// stall a frame:
+//  - SceneData holds everything a scene needs before upload: a mapped scene
+//    file or plain patch arrays, its BVH and its placement
+//  - SceneBuilder runs a build function for each requested scene, in
+//    request order, and hands finished scenes back to the thread that owns
+//    the GL context, which uploads them
+//
+// The build function runs on the worker. It may only write the SceneData it
+// is given and read state the GL thread does not change during a build
+// (every FreeType library it uses must be its own).
+// ==========================================================================
+#ifndef SCENEBUILDER_H
+#define SCENEBUILDER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MemoryAccount.h"
+#include "SceneFile.h"
+#include "SegmentBVH.h"
+
+// --------------------------------------------------------------------------
+
+// patch arrays of built scenes, counted towards MEMORY_SCENES
+typedef CountedVector<glm::vec2, MEMORY_SCENES> ScenePoints;
+typedef CountedVector<glm::vec3, MEMORY_SCENES> SceneColours;
+
+struct SceneData
+{
+    int id;
+
+    // scenes drawn from a scene file map it here; others fill points and
+    // colours with 4 vertex patches
+    SceneFile file;
+    ScenePoints points;
+    SceneColours colours;
+
+    SegmentBVH bvh;
+    glm::mat4 model;
+    double buildSeconds;
+
+    SceneData(int scene) : id(scene), model(1.0f), buildSeconds(0)
+    {}
+
+    // bytes of buffer storage the scene takes once uploaded
+    size_t GpuBytes() const;
+};
+
+typedef std::function<void(SceneData *data)> SceneBuildFunction;
+
+class SceneBuilder
+{
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+
+    SceneBuildFunction m_build;
+    std::deque<int> m_requests;
+    std::vector<SceneData*> m_finished;
+    bool m_stop;
+
+    void Run();
+
+    // not copyable, the worker refers to this object
+    SceneBuilder(const SceneBuilder &);
+    SceneBuilder &operator=(const SceneBuilder &);
+
+public:
+    SceneBuilder() : m_stop(false)
+    {}
+    ~SceneBuilder() { Stop(); }
+
+    // starts the worker; build fills in a SceneData whose id is set
+    void Start(SceneBuildFunction build);
+
+    // waits for the scene being built, drops queued requests and any
+    // finished scenes not yet taken
+    void Stop();
+
+    // queues a scene; one already waiting is not queued again
+    void Request(int scene);
+
+    // a finished scene, oldest first, or 0; the caller owns it
+    SceneData *TakeFinished();
+};
+
+// --------------------------------------------------------------------------
+#endif // SCENEBUILDER_H
@@ -0,0 +1,358 @@
+// ==========================================================================
+// Binary Scene Files
+//
+// Memory mapped loading and validation of binary scenes, and the text to
+// binary converter.
+// ==========================================================================
+
+#include "SceneFile.h"
+#include "Bezier.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace glm;
+
+static const float PI = 3.14159265358979f;
+
+// arrays start on this boundary so they can be used in place
+static const uint64_t SCENE_ALIGNMENT = 16;
+
+static uint64_t Align(uint64_t offset)
+{
+    return (offset + SCENE_ALIGNMENT - 1) & ~(SCENE_ALIGNMENT - 1);
+}
+
+// --------------------------------------------------------------------------
+
+bool SceneFile::Open(const string &filename)
+{
+    Close();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "SceneFile ERROR: could not open " << filename << endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(SceneHeader)) {
+        cout << "SceneFile ERROR: " << filename << " is too short to be a scene" << endl;
+        close(fd);
+        return false;
+    }
+
+    // private and writable: edits stay in memory, copied a page at a time
+    void *data = mmap(0, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        cout << "SceneFile ERROR: could not map " << filename << endl;
+        return false;
+    }
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+    m_data = (unsigned char*)data;
+    m_size = info.st_size;
+
+    if (!Validate(filename)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SceneFile::Close()
+{
+    if (m_data) munmap(m_data, m_size);
+    m_data = 0;
+    m_size = 0;
+}
+
+// an array of count elements at offset lies within the file
+static bool InFile(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+{
+    if (offset % SCENE_ALIGNMENT != 0 || offset > fileSize) return false;
+    return count <= (fileSize - offset) / elementSize;
+}
+
+// a range of count elements at first lies within an array of size elements
+static bool InRange(uint64_t first, uint64_t count, uint64_t size)
+{
+    return first <= size && count <= size - first;
+}
+
+bool SceneFile::Validate(const string &filename) const
+{
+    const SceneHeader &header = Header();
+    string problem;
+
+    if (memcmp(header.magic, SCENE_MAGIC, 4) != 0)
+        problem = "not a scene file";
+    else if (header.version != SCENE_VERSION)
+        problem = "unsupported version";
+    else if (!InFile(header.shapesOffset, header.shapeCount, sizeof(SceneShapeRecord), m_size) ||
+             !InFile(header.pointsOffset, header.pointCount, sizeof(vec2), m_size) ||
+             !InFile(header.coloursOffset, header.pointCount, sizeof(vec3), m_size) ||
+             !InFile(header.indicesOffset, header.indexCount, sizeof(unsigned int), m_size) ||
+             !InFile(header.animationsOffset, header.pointCount, sizeof(vec4), m_size))
+        problem = "arrays extend past the end of the file";
+    else if (header.patchIndexCount > header.indexCount || header.patchIndexCount % 4 != 0)
+        problem = "bad patch index count";
+
+    for (size_t s = 0; problem.empty() && s < header.shapeCount; ++s)
+    {
+        const SceneShapeRecord &shape = Shape(s);
+        if (!InRange(shape.firstPoint, shape.pointCount, header.pointCount) ||
+            !InRange(shape.firstPatchIndex, shape.patchIndexCount, header.patchIndexCount) ||
+            !InRange(shape.firstPolygonIndex, shape.polygonIndexCount, header.indexCount) ||
+            !InRange(shape.firstPointIndex, shape.pointIndexCount, header.indexCount))
+            problem = "shape ranges out of bounds";
+        else if (shape.patchSize != 4)
+            problem = "only 4 vertex patches are supported";
+        else if (shape.firstPatchIndex % 4 != 0 || shape.patchIndexCount % 4 != 0)
+            problem = "patch indices not in groups of 4";
+    }
+
+    // the one pass that touches every index, so a bad file can never make
+    // the GPU or the editor read outside the point arrays
+    const unsigned int *indices = Indices();
+    for (uint64_t i = 0; problem.empty() && i < header.indexCount; ++i)
+        if (indices[i] >= header.pointCount)
+            problem = "index out of range";
+
+    if (!problem.empty()) {
+        cout << "SceneFile ERROR: " << filename << ": " << problem << endl;
+        return false;
+    }
+    return true;
+}
+
+const SceneShapeRecord &SceneFile::Shape(size_t shape) const
+{
+    return ((const SceneShapeRecord*)(m_data + Header().shapesOffset))[shape];
+}
+
+MySegment SceneFile::Segment(size_t patch) const
+{
+    const vec2 *points = Points();
+    const unsigned int *indices = Indices() + 4*patch;
+
+    vec2 corners[4];
+    for (int i = 0; i < 4; ++i)
+        corners[i] = points[indices[i]];
+    return SegmentFromPatch(corners);
+}
+
+// --------------------------------------------------------------------------
+// Text to binary conversion
+
+bool ParseScene(const string &filename, vector<SceneShapeSource> *shapes)
+{
+    ifstream input(filename.c_str());
+    if (!input) {
+        cout << "SceneFile ERROR: could not open " << filename << endl;
+        return false;
+    }
+
+    string line;
+    for (int number = 1; getline(input, line); ++number)
+    {
+        istringstream words(line);
+        string command;
+        if (!(words >> command) || command[0] == '#') continue;
+
+        if (command == "shape") {
+            shapes->push_back(SceneShapeSource());
+            continue;
+        }
+        if (shapes->empty()) shapes->push_back(SceneShapeSource());
+        SceneShapeSource &current = shapes->back();
+
+        bool ok = true;
+        if (command == "q" || command == "c") {
+            vec2 p[4];
+            int count = command == "q" ? 3 : 4;
+            for (int i = 0; i < count; ++i)
+                ok = ok && (words >> p[i].x >> p[i].y);
+            if (ok && count == 3) current.shape.AddQuadratic(p[0], p[1], p[2]);
+            else if (ok) current.shape.AddCubic(p[0], p[1], p[2], p[3]);
+        }
+        else if (command == "curve-colour") {
+            ok = bool(words >> current.curveColour.r >> current.curveColour.g >> current.curveColour.b);
+        }
+        else if (command == "polygon-colour") {
+            ok = bool(words >> current.polygonColour.r >> current.polygonColour.g >> current.polygonColour.b);
+        }
+        else if (command == "wobble") {
+            current.animation.type = ANIMATE_WOBBLE;
+            ok = (words >> current.animation.amplitude.x >> current.animation.amplitude.y
+                        >> current.animation.frequency >> current.animation.wavelength)
+                 && current.animation.wavelength != 0;
+        }
+        else if (command == "breathe") {
+            current.animation.type = ANIMATE_BREATHE;
+            ok = bool(words >> current.animation.amplitude.x >> current.animation.frequency);
+        }
+        else if (command == "patch-size") {
+            ok = (words >> current.patchSize) && current.patchSize == 4;
+        }
+        else if (command == "draw") {
+            current.drawModes = 0;
+            string mode;
+            while (ok && words >> mode) {
+                if (mode == "curves") current.drawModes |= DRAW_CURVES;
+                else if (mode == "polygon") current.drawModes |= DRAW_POLYGON;
+                else if (mode == "points") current.drawModes |= DRAW_POINTS;
+                else ok = false;
+            }
+        }
+        else ok = false;
+
+        if (!ok) {
+            cout << "SceneFile ERROR: " << filename << ":" << number << ": cannot read \"" << line << "\"" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// appends a shape's index list, shifted to the shape's place in the point array
+static void AppendIndices(vector<unsigned int> *indices, const vector<unsigned int> &shapeIndices,
+                          unsigned int firstPoint, uint32_t *first, uint32_t *count)
+{
+    *first = indices->size();
+    *count = shapeIndices.size();
+    for (size_t i = 0; i < shapeIndices.size(); ++i)
+        indices->push_back(shapeIndices[i] + firstPoint);
+}
+
+// per point animation parameters of a shape; the quadratic marker never
+// moves, or tessEval.glsl would stop recognising it
+static void AppendAnimations(vector<vec4> *animations, const SceneShapeSource &source)
+{
+    const SceneAnimation &animation = source.animation;
+    const vector<vec2> &points = source.shape.points;
+    int marker = source.shape.MarkerIndex();
+
+    vec2 centre(0.0f);
+    int count = 0;
+    for (size_t i = 0; i < points.size(); ++i)
+        if (int(i) != marker) { centre += points[i]; ++count; }
+    if (count > 0) centre /= float(count);
+
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        vec4 parameters(0.0f);
+        if (int(i) != marker && animation.type == ANIMATE_WOBBLE) {
+            float phase = 2.0f * PI * points[i].x / animation.wavelength;
+            parameters = vec4(animation.amplitude, phase, animation.frequency);
+        }
+        else if (int(i) != marker && animation.type == ANIMATE_BREATHE) {
+            parameters = vec4(animation.amplitude.x * (points[i] - centre), 0.0f, animation.frequency);
+        }
+        animations->push_back(parameters);
+    }
+}
+
+// appends count bytes, then zeros up to the next aligned offset
+static void AppendAligned(string *bytes, const void *data, uint64_t count)
+{
+    bytes->append((const char*)data, count);
+    bytes->append(Align(count) - count, '\0');
+}
+
+void EncodeScene(const vector<SceneShapeSource> &shapes, string *bytes)
+{
+    // shape table, and the index sections in patch, polygon, point order
+    vector<SceneShapeRecord> records(shapes.size());
+    vector<vec2> points;
+    vector<vec3> colours;
+    vector<vec4> animations;
+    vector<unsigned int> indices;
+
+    for (size_t s = 0; s < shapes.size(); ++s)
+    {
+        SceneShapeRecord &record = records[s];
+        memset(&record, 0, sizeof(record));
+        record.firstPoint = points.size();
+        record.pointCount = shapes[s].shape.points.size();
+        record.patchSize = shapes[s].patchSize;
+        record.drawModes = shapes[s].drawModes;
+        for (int i = 0; i < 3; ++i) {
+            record.curveColour[i] = shapes[s].curveColour[i];
+            record.polygonColour[i] = shapes[s].polygonColour[i];
+        }
+        points.insert(points.end(), shapes[s].shape.points.begin(), shapes[s].shape.points.end());
+        colours.insert(colours.end(), shapes[s].shape.colours.begin(), shapes[s].shape.colours.end());
+        AppendAnimations(&animations, shapes[s]);
+    }
+    for (size_t s = 0; s < shapes.size(); ++s)
+        AppendIndices(&indices, shapes[s].shape.patchIndices, records[s].firstPoint,
+                      &records[s].firstPatchIndex, &records[s].patchIndexCount);
+    size_t patchIndexCount = indices.size();
+    for (size_t s = 0; s < shapes.size(); ++s)
+        AppendIndices(&indices, shapes[s].shape.polygonIndices, records[s].firstPoint,
+                      &records[s].firstPolygonIndex, &records[s].polygonIndexCount);
+    for (size_t s = 0; s < shapes.size(); ++s)
+        AppendIndices(&indices, shapes[s].shape.pointIndices, records[s].firstPoint,
+                      &records[s].firstPointIndex, &records[s].pointIndexCount);
+
+    SceneHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCENE_MAGIC, 4);
+    header.version = SCENE_VERSION;
+    header.shapeCount = records.size();
+    header.pointCount = points.size();
+    header.indexCount = indices.size();
+    header.patchIndexCount = patchIndexCount;
+    header.shapesOffset = Align(sizeof(header));
+    header.pointsOffset = header.shapesOffset + Align(records.size() * sizeof(SceneShapeRecord));
+    header.coloursOffset = header.pointsOffset + Align(points.size() * sizeof(vec2));
+    header.indicesOffset = header.coloursOffset + Align(colours.size() * sizeof(vec3));
+    header.animationsOffset = header.indicesOffset + Align(indices.size() * sizeof(unsigned int));
+
+    bytes->clear();
+    AppendAligned(bytes, &header, sizeof(header));
+    AppendAligned(bytes, records.data(), records.size() * sizeof(SceneShapeRecord));
+    AppendAligned(bytes, points.data(), points.size() * sizeof(vec2));
+    AppendAligned(bytes, colours.data(), colours.size() * sizeof(vec3));
+    AppendAligned(bytes, indices.data(), indices.size() * sizeof(unsigned int));
+    AppendAligned(bytes, animations.data(), animations.size() * sizeof(vec4));
+}
+
+bool WriteSceneFile(const string &sceneFile, const vector<SceneShapeSource> &shapes)
+{
+    string bytes;
+    EncodeScene(shapes, &bytes);
+    ofstream output(sceneFile.c_str(), ios::binary);
+    output.write(bytes.data(), bytes.size());
+
+    if (!output) {
+        cout << "SceneFile ERROR: could not write " << sceneFile << endl;
+        return false;
+    }
+
+    // the header holds the counts the summary needs
+    SceneHeader header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    cout << sceneFile << ": " << shapes.size() << " shapes, " << header.pointCount << " points, "
+         << header.patchIndexCount / 4 << " patches" << endl;
+    return true;
+}
+
+bool ConvertScene(const string &textFile, const string &sceneFile)
+{
+    vector<SceneShapeSource> shapes;
+    return ParseScene(textFile, &shapes) && WriteSceneFile(sceneFile, shapes);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,196 @@
+// ==========================================================================
+// Binary Scene Files
+//
+// This module defines the versioned binary scene format the curve scenes are
+// loaded from, and the converter that produces it from a text description.
+//
+// A scene file is a header, a table of shapes and four arrays shared by all
+// shapes, each 16 byte aligned so they can be used in place:
+//  - control point positions (vec2) and per point colours (vec3), uploaded
+//    as the vertex and colour buffers
+//  - per point animation parameters (vec4: amplitude x and y, phase in
+//    radians, frequency in Hz), uploaded once; the vertex stage displaces
+//    each point by amplitude * sin(2 pi frequency time + phase)
+//  - GLuint indices into the point arrays, uploaded as the element buffer:
+//    every shape's patch indices (4 per patch, see Shape.h), then every
+//    shape's control polygon pairs, then every shape's point indices
+//
+// SceneFile memory maps the file, so opening a scene costs a header check
+// and one pass over the indices; the arrays are handed to glBufferData
+// straight from the page cache. The mapping is private and writable, so
+// dragged control points modify only the pages they touch, never the file.
+//
+// Text scenes (converted with ConvertScene) look like:
+//
+//      # comment
+//      shape                       starts a new shape
+//      curve-colour 1 0 1          colour of the curves
+//      polygon-colour 0 0 1        colour of the control polygon
+//      draw curves polygon points  which views are drawn
+//      patch-size 4                vertices per patch (only 4 is supported)
+//      wobble ax ay frequency wavelength
+//                                  sways the shape by (ax,ay) as a wave
+//                                  travelling along x, wavelength long
+//      breathe amplitude frequency grows and shrinks the shape about its
+//                                  centre by a fraction amplitude
+//      q x0 y0 x1 y1 x2 y2         a quadratic
+//      c x0 y0 x1 y1 x2 y2 x3 y3   a cubic
+//
+// Patches that share an end point exactly share its control point.
+// ==========================================================================
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+#include "Shape.h"
+
+// --------------------------------------------------------------------------
+// On-disk layout; all values little endian
+
+const char SCENE_MAGIC[4] = { 'B', 'Z', 'S', 'C' };
+const uint32_t SCENE_VERSION = 2;
+
+// bits of SceneShapeRecord::drawModes
+enum SceneDrawMode
+{
+    DRAW_CURVES  = 1,
+    DRAW_POLYGON = 2,
+    DRAW_POINTS  = 4
+};
+
+struct SceneHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t shapeCount;
+    uint32_t reserved;
+
+    uint64_t pointCount;
+    uint64_t indexCount;        // patch + polygon + point indices
+    uint64_t patchIndexCount;   // length of the leading patch index section
+
+    // byte offsets of the shape table and the arrays from the file start
+    uint64_t shapesOffset;
+    uint64_t pointsOffset;
+    uint64_t coloursOffset;
+    uint64_t indicesOffset;
+    uint64_t animationsOffset;
+};
+
+struct SceneShapeRecord
+{
+    uint32_t firstPoint, pointCount;
+
+    // ranges of the index array; indices are into the whole point array
+    uint32_t firstPatchIndex, patchIndexCount;
+    uint32_t firstPolygonIndex, polygonIndexCount;
+    uint32_t firstPointIndex, pointIndexCount;
+
+    uint32_t patchSize;
+    uint32_t drawModes;
+    float    curveColour[3];
+    float    polygonColour[3];
+};
+
+// --------------------------------------------------------------------------
+
+class SceneFile
+{
+    unsigned char *m_data;
+    size_t m_size;
+
+    const SceneHeader &Header() const { return *(const SceneHeader*)m_data; }
+    bool Validate(const std::string &filename) const;
+
+    // not copyable, the mapping is owned
+    SceneFile(const SceneFile &);
+    SceneFile &operator=(const SceneFile &);
+
+public:
+    SceneFile() : m_data(0), m_size(0)
+    {}
+    ~SceneFile() { Close(); }
+
+    // maps and checks a scene file; reports the problem and returns false
+    // if it is missing, from another version or inconsistent
+    bool Open(const std::string &filename);
+    void Close();
+    bool IsOpen() const { return m_data != 0; }
+
+    size_t ShapeCount() const { return m_data ? Header().shapeCount : 0; }
+    const SceneShapeRecord &Shape(size_t shape) const;
+
+    size_t PointCount() const { return m_data ? Header().pointCount : 0; }
+    size_t IndexCount() const { return m_data ? Header().indexCount : 0; }
+    size_t PatchCount() const { return m_data ? Header().patchIndexCount / 4 : 0; }
+
+    // the arrays, in place in the mapping; null while no scene is open
+    glm::vec2 *Points() const { return m_data ? (glm::vec2*)(m_data + Header().pointsOffset) : 0; }
+    const glm::vec3 *Colours() const { return m_data ? (const glm::vec3*)(m_data + Header().coloursOffset) : 0; }
+    const unsigned int *Indices() const { return m_data ? (const unsigned int*)(m_data + Header().indicesOffset) : 0; }
+    const glm::vec4 *Animations() const { return m_data ? (const glm::vec4*)(m_data + Header().animationsOffset) : 0; }
+
+    // a patch of the scene, numbered across all shapes in file order
+    MySegment Segment(size_t patch) const;
+
+    size_t Bytes() const { return m_size; }
+};
+
+// --------------------------------------------------------------------------
+
+enum SceneAnimationType
+{
+    ANIMATE_NONE,
+    ANIMATE_WOBBLE,
+    ANIMATE_BREATHE
+};
+
+// how a shape's points move, expanded to per point parameters when written
+struct SceneAnimation
+{
+    SceneAnimationType type;
+    glm::vec2 amplitude;    // wobble: displacement; breathe: x is the fraction
+    float frequency;        // Hz
+    float wavelength;       // wobble only, in object units
+
+    SceneAnimation() : type(ANIMATE_NONE), amplitude(0.0f), frequency(0), wavelength(1)
+    {}
+};
+
+// a shape and its drawing settings, as written to a scene file
+struct SceneShapeSource
+{
+    Shape shape;
+    unsigned int drawModes;
+    unsigned int patchSize;
+    glm::vec3 curveColour;
+    glm::vec3 polygonColour;
+    SceneAnimation animation;
+
+    SceneShapeSource() : drawModes(DRAW_CURVES | DRAW_POLYGON | DRAW_POINTS), patchSize(4),
+                         curveColour(1.0f, 0.0f, 1.0f), polygonColour(0.0f, 0.0f, 1.0f)
+    {}
+};
+
+// reads the shapes of a text scene; false, with the line it could not
+// read printed, on an error
+bool ParseScene(const std::string &filename, std::vector<SceneShapeSource> *shapes);
+
+// the binary scene file of shapes, in memory; bytes is replaced
+void EncodeScene(const std::vector<SceneShapeSource> &shapes, std::string *bytes);
+
+// writes shapes as a binary scene file
+bool WriteSceneFile(const std::string &filename, const std::vector<SceneShapeSource> &shapes);
+
+// converts a text scene to a binary scene file
+bool ConvertScene(const std::string &textFile, const std::string &sceneFile);
+
+// --------------------------------------------------------------------------
+#endif // SCENEFILE_H
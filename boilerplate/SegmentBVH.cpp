@@ -0,0 +1,420 @@
+// ==========================================================================
+// Bounding Volume Hierarchy over Bezier Segments
+//
+// This module defines a SegmentBVH class that answers spatial queries over
+// the curves of a scene (mug/fish patches or MyGlyph contours). Leaves hold
+// segments with tight (derivative root) bounds; interior nodes additionally
+// track the control polygon hull so control points can be picked.
+// ==========================================================================
+
+#include "SegmentBVH.h"
+#include "Bezier.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+using namespace glm;
+
+// segments per leaf; small leaves keep the per-query curve work low
+static const int LEAF_SIZE = 4;
+
+// samples used to seed the Newton refinement of nearest point queries
+static const int NEAREST_SAMPLES = 8;
+static const int NEWTON_ITERATIONS = 6;
+
+// --------------------------------------------------------------------------
+// Per-segment helpers
+
+// squared distance from p to the box [lo, hi]
+static float BoxDistanceSquared(const vec2 &p, const vec2 &lo, const vec2 &hi)
+{
+    vec2 d = max(max(lo - p, p - hi), vec2(0.0f));
+    return dot(d, d);
+}
+
+// bounds of a segment's control points, which contain the whole curve
+static void HullBounds(const MySegment &segment, vec2 *lo, vec2 *hi)
+{
+    *lo = *hi = SegmentPoint(segment, 0);
+    for (unsigned int i = 1; i <= segment.degree; ++i) {
+        *lo = min(*lo, SegmentPoint(segment, i));
+        *hi = max(*hi, SegmentPoint(segment, i));
+    }
+}
+
+// closest point on one segment: seed by sampling, then Newton iterations on
+// f(t) = (B(t) - p) . B'(t), whose roots are the local distance extrema
+static float ClosestParameter(const MySegment &segment, const vec2 &p)
+{
+    if (segment.degree <= 1)
+    {
+        vec2 a = SegmentPoint(segment, 0);
+        vec2 d = SegmentPoint(segment, segment.degree) - a;
+        float length2 = dot(d, d);
+        return length2 > 0 ? clamp(dot(p - a, d) / length2, 0.0f, 1.0f) : 0.0f;
+    }
+
+    float bestT = 0;
+    float best = 1e30f;
+    for (int i = 0; i <= NEAREST_SAMPLES; ++i)
+    {
+        float t = float(i) / NEAREST_SAMPLES;
+        vec2 d = EvaluateSegment(segment, t) - p;
+        if (dot(d, d) < best) {
+            best = dot(d, d);
+            bestT = t;
+        }
+    }
+
+    float t = bestT;
+    for (int i = 0; i < NEWTON_ITERATIONS; ++i)
+    {
+        vec2 d = EvaluateSegment(segment, t) - p;
+        vec2 d1 = EvaluateDerivative(segment, t);
+        vec2 d2 = EvaluateSecondDerivative(segment, t);
+        float f = dot(d, d1);
+        float df = dot(d1, d1) + dot(d, d2);
+        if (df <= 0) break;
+        float next = clamp(t - f / df, 0.0f, 1.0f);
+        if (fabs(next - t) < 1e-7f) { t = next; break; }
+        t = next;
+    }
+
+    // Newton may wander to a worse local minimum; never do worse than the seed
+    vec2 d = EvaluateSegment(segment, t) - p;
+    return dot(d, d) <= best ? t : bestT;
+}
+
+// signed number of times the ray from p towards +x crosses the segment
+static int RayCrossings(const MySegment &segment, const vec2 &p)
+{
+    // split at the y extrema so every piece is monotone in y
+    float splits[4];
+    int count = 0;
+    splits[count++] = 0;
+    count += SegmentExtrema(segment, 1, splits + 1);
+    if (count == 3 && splits[1] > splits[2]) swap(splits[1], splits[2]);
+    splits[count++] = 1;
+
+    int winding = 0;
+    for (int i = 0; i + 1 < count; ++i)
+    {
+        float ta = splits[i], tb = splits[i + 1];
+        vec2 a = EvaluateSegment(segment, ta);
+        vec2 b = EvaluateSegment(segment, tb);
+
+        // half-open rule so shared endpoints are counted exactly once
+        if ((a.y <= p.y) == (b.y <= p.y)) continue;
+        if (std::max(a.x, b.x) < p.x && segment.degree == 1) continue;
+
+        // bisect the monotone piece for the parameter where y == p.y
+        bool upward = b.y > a.y;
+        float lo = ta, hi = tb;
+        for (int k = 0; k < 24; ++k)
+        {
+            float mid = 0.5f * (lo + hi);
+            if ((EvaluateSegment(segment, mid).y <= p.y) == upward) lo = mid;
+            else hi = mid;
+        }
+
+        if (EvaluateSegment(segment, 0.5f * (lo + hi)).x > p.x)
+            winding += upward ? 1 : -1;
+    }
+    return winding;
+}
+
+// --------------------------------------------------------------------------
+
+void SegmentBVH::Clear()
+{
+    m_segments.clear();
+    m_tags.clear();
+    m_lo.clear();
+    m_hi.clear();
+    m_order.clear();
+    m_nodes.clear();
+}
+
+void SegmentBVH::AddSegment(const MySegment &segment, int tag)
+{
+    m_segments.push_back(segment);
+    m_tags.push_back(tag);
+}
+
+void SegmentBVH::AddPatches(const vec2 *vertices, size_t count, int tag)
+{
+    for (size_t i = 0; i + 4 <= count; i += 4)
+        AddSegment(SegmentFromPatch(vertices + i), tag);
+}
+
+void SegmentBVH::AddGlyph(const MyGlyph &glyph, const vec2 &offset, int tag)
+{
+    for (size_t c = 0; c < glyph.contours.size(); ++c)
+        for (size_t s = 0; s < glyph.contours[c].size(); ++s)
+        {
+            MySegment segment = glyph.contours[c][s];
+            for (unsigned int i = 0; i <= segment.degree; ++i)
+                SetSegmentPoint(&segment, i, SegmentPoint(segment, i) + offset);
+            AddSegment(segment, tag);
+        }
+}
+
+// --------------------------------------------------------------------------
+
+void SegmentBVH::Build()
+{
+    size_t n = m_segments.size();
+    m_lo.resize(n);
+    m_hi.resize(n);
+    m_order.resize(n);
+    m_nodes.clear();
+    m_nodes.reserve(2 * n / LEAF_SIZE + 1);
+
+    vector<vec2> centroids(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        SegmentBounds(m_segments[i], &m_lo[i], &m_hi[i]);
+        centroids[i] = 0.5f * (m_lo[i] + m_hi[i]);
+        m_order[i] = int(i);
+    }
+
+    if (n > 0) BuildNode(0, int(n), centroids);
+    Refit();
+}
+
+int SegmentBVH::BuildNode(int begin, int end, vector<vec2> &centroids)
+{
+    int index = int(m_nodes.size());
+    m_nodes.push_back(Node());
+
+    if (end - begin <= LEAF_SIZE)
+    {
+        m_nodes[index].first = begin;
+        m_nodes[index].count = end - begin;
+        return index;
+    }
+
+    // split at the median centroid along the axis of greatest spread
+    vec2 lo = centroids[m_order[begin]], hi = lo;
+    for (int i = begin + 1; i < end; ++i) {
+        lo = min(lo, centroids[m_order[i]]);
+        hi = max(hi, centroids[m_order[i]]);
+    }
+    int axis = (hi.x - lo.x >= hi.y - lo.y) ? 0 : 1;
+
+    int mid = (begin + end) / 2;
+    nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end,
+                [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    BuildNode(begin, mid, centroids);   // left child is always index + 1
+    int right = BuildNode(mid, end, centroids);
+
+    m_nodes[index].first = right;
+    m_nodes[index].count = 0;
+    return index;
+}
+
+void SegmentBVH::UpdateSegment(int index, const MySegment &segment)
+{
+    m_segments[index] = segment;
+}
+
+void SegmentBVH::Refit()
+{
+    for (size_t i = 0; i < m_segments.size(); ++i)
+        SegmentBounds(m_segments[i], &m_lo[i], &m_hi[i]);
+
+    // children always come after their parent, so a reverse sweep is bottom up
+    for (int n = int(m_nodes.size()) - 1; n >= 0; --n)
+    {
+        Node &node = m_nodes[n];
+        if (node.Leaf())
+        {
+            int s = m_order[node.first];
+            node.lo = m_lo[s];
+            node.hi = m_hi[s];
+            HullBounds(m_segments[s], &node.hullLo, &node.hullHi);
+            for (int i = 1; i < node.count; ++i)
+            {
+                vec2 hullLo, hullHi;
+                s = m_order[node.first + i];
+                HullBounds(m_segments[s], &hullLo, &hullHi);
+                node.lo = min(node.lo, m_lo[s]);
+                node.hi = max(node.hi, m_hi[s]);
+                node.hullLo = min(node.hullLo, hullLo);
+                node.hullHi = max(node.hullHi, hullHi);
+            }
+        }
+        else
+        {
+            const Node &left = m_nodes[n + 1];
+            const Node &right = m_nodes[node.first];
+            node.lo = min(left.lo, right.lo);
+            node.hi = max(left.hi, right.hi);
+            node.hullLo = min(left.hullLo, right.hullLo);
+            node.hullHi = max(left.hullHi, right.hullHi);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+CurveHit SegmentBVH::Nearest(const vec2 &p, float maxDistance) const
+{
+    CurveHit hit;
+    if (m_nodes.empty()) return hit;
+
+    float best = maxDistance * maxDistance;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = m_nodes[stack[--top]];
+        if (BoxDistanceSquared(p, node.lo, node.hi) >= best) continue;
+
+        if (node.Leaf())
+        {
+            for (int i = 0; i < node.count; ++i)
+            {
+                int s = m_order[node.first + i];
+                if (BoxDistanceSquared(p, m_lo[s], m_hi[s]) >= best) continue;
+
+                float t = ClosestParameter(m_segments[s], p);
+                vec2 q = EvaluateSegment(m_segments[s], t);
+                float d = dot(q - p, q - p);
+                if (d < best) {
+                    best = d;
+                    hit.segment = s;
+                    hit.t = t;
+                    hit.point = q;
+                }
+            }
+        }
+        else
+        {
+            // visit the nearer child first so the bound shrinks sooner
+            int left = int(&node - &m_nodes[0]) + 1;
+            int right = node.first;
+            float dl = BoxDistanceSquared(p, m_nodes[left].lo, m_nodes[left].hi);
+            float dr = BoxDistanceSquared(p, m_nodes[right].lo, m_nodes[right].hi);
+            if (dl < dr) swap(left, right);
+            stack[top++] = left;
+            stack[top++] = right;
+        }
+    }
+
+    if (hit.segment >= 0) hit.distance = sqrt(best);
+    return hit;
+}
+
+int SegmentBVH::WindingNumber(const vec2 &p) const
+{
+    if (m_nodes.empty()) return 0;
+
+    int winding = 0;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        int n = stack[--top];
+        const Node &node = m_nodes[n];
+
+        // only curves spanning p.y somewhere to the right can cross the ray
+        if (p.y < node.lo.y || p.y > node.hi.y || node.hi.x < p.x) continue;
+
+        if (node.Leaf())
+        {
+            for (int i = 0; i < node.count; ++i)
+            {
+                int s = m_order[node.first + i];
+                if (p.y < m_lo[s].y || p.y > m_hi[s].y || m_hi[s].x < p.x) continue;
+                winding += RayCrossings(m_segments[s], p);
+            }
+        }
+        else
+        {
+            stack[top++] = n + 1;
+            stack[top++] = node.first;
+        }
+    }
+    return winding;
+}
+
+void SegmentBVH::QueryRect(const vec2 &lo, const vec2 &hi, vector<int> *result) const
+{
+    if (m_nodes.empty()) return;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        int n = stack[--top];
+        const Node &node = m_nodes[n];
+        if (any(lessThan(hi, node.lo)) || any(greaterThan(lo, node.hi))) continue;
+
+        if (node.Leaf())
+        {
+            for (int i = 0; i < node.count; ++i)
+            {
+                int s = m_order[node.first + i];
+                if (any(lessThan(hi, m_lo[s])) || any(greaterThan(lo, m_hi[s]))) continue;
+                result->push_back(s);
+            }
+        }
+        else
+        {
+            stack[top++] = n + 1;
+            stack[top++] = node.first;
+        }
+    }
+}
+
+bool SegmentBVH::PickControlPoint(const vec2 &p, float radius, int *segment, int *point) const
+{
+    if (m_nodes.empty()) return false;
+
+    float best = radius * radius;
+    bool found = false;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        int n = stack[--top];
+        const Node &node = m_nodes[n];
+        if (BoxDistanceSquared(p, node.hullLo, node.hullHi) > best) continue;
+
+        if (node.Leaf())
+        {
+            for (int i = 0; i < node.count; ++i)
+            {
+                int s = m_order[node.first + i];
+                for (unsigned int k = 0; k <= m_segments[s].degree; ++k)
+                {
+                    vec2 d = SegmentPoint(m_segments[s], k) - p;
+                    if (dot(d, d) <= best) {
+                        best = dot(d, d);
+                        *segment = s;
+                        *point = k;
+                        found = true;
+                    }
+                }
+            }
+        }
+        else
+        {
+            stack[top++] = n + 1;
+            stack[top++] = node.first;
+        }
+    }
+    return found;
+}
+
+// --------------------------------------------------------------------------
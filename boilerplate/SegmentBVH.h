@@ -0,0 +1,97 @@
+// ==========================================================================
+// Bounding Volume Hierarchy over Bezier Segments
+//
+// This module defines a SegmentBVH class that answers spatial queries over
+// the curves of a scene (mug/fish patches or MyGlyph contours):
+//  - nearest point on any curve, refined with Newton iterations on the Bezier
+//  - nonzero winding number / inside test for closed contours
+//  - all segments whose bounds overlap a rectangle
+//  - control point picking within a radius
+//
+// Leaves hold segments with tight (derivative root) bounds. Moving control
+// points does not require a rebuild: update the segment and call Refit().
+// ==========================================================================
+#ifndef SEGMENTBVH_H
+#define SEGMENTBVH_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// Result of a nearest curve query
+
+struct CurveHit
+{
+    int segment;        // index of the closest segment, or -1 if none
+    float t;            // parameter of the closest point on that segment
+    glm::vec2 point;    // the closest point itself
+    float distance;
+
+    CurveHit() : segment(-1), t(0), point(0.0f), distance(0)
+    {}
+};
+
+// --------------------------------------------------------------------------
+
+class SegmentBVH
+{
+    struct Node
+    {
+        glm::vec2 lo, hi;           // tight bounds of the curves below
+        glm::vec2 hullLo, hullHi;   // bounds of their control points
+        int first;      // leaf: first entry in m_order; interior: right child
+        int count;      // leaf: number of segments; interior: 0
+
+        bool Leaf() const { return count > 0; }
+    };
+
+    CountedVector<MySegment, MEMORY_SCENES> m_segments;
+    CountedVector<int, MEMORY_SCENES> m_tags;
+    CountedVector<glm::vec2, MEMORY_SCENES> m_lo, m_hi;    // tight bounds per segment
+    CountedVector<int, MEMORY_SCENES> m_order;             // segment indices, grouped by leaf
+    CountedVector<Node, MEMORY_SCENES> m_nodes;            // depth first: left child follows parent
+
+    int BuildNode(int begin, int end, std::vector<glm::vec2> &centroids);
+
+public:
+    // removes all segments and nodes
+    void Clear();
+
+    // adds segments; tag is returned by Tag() so callers can map back to
+    // their own shapes, contours or buffer slots
+    void AddSegment(const MySegment &segment, int tag = 0);
+    void AddPatches(const glm::vec2 *vertices, size_t count, int tag = 0);
+    void AddGlyph(const MyGlyph &glyph, const glm::vec2 &offset = glm::vec2(0.0f), int tag = 0);
+
+    // builds the hierarchy from scratch; call after adding segments
+    void Build();
+
+    // replaces one segment's control points; call Refit() once afterwards
+    void UpdateSegment(int index, const MySegment &segment);
+
+    // recomputes segment bounds and node boxes bottom up, keeping the topology
+    void Refit();
+
+    // closest point on any curve to p, ignoring curves further than maxDistance
+    CurveHit Nearest(const glm::vec2 &p, float maxDistance = 1e30f) const;
+
+    // nonzero winding number of the closed contours around p
+    int WindingNumber(const glm::vec2 &p) const;
+    bool Inside(const glm::vec2 &p) const { return WindingNumber(p) != 0; }
+
+    // appends the segments whose bounds overlap the rectangle [lo, hi]
+    void QueryRect(const glm::vec2 &lo, const glm::vec2 &hi, std::vector<int> *result) const;
+
+    // finds the control point closest to p within radius; returns false if none
+    bool PickControlPoint(const glm::vec2 &p, float radius, int *segment, int *point) const;
+
+    size_t SegmentCount() const { return m_segments.size(); }
+    const MySegment &Segment(int index) const { return m_segments[index]; }
+    int Tag(int index) const { return m_tags[index]; }
+};
+
+// --------------------------------------------------------------------------
+#endif // SEGMENTBVH_H
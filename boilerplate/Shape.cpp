@@ -0,0 +1,113 @@
+// ==========================================================================
+// Indexed Bezier Shapes
+//
+// Builds the shared control point array and the index lists of a Shape.
+// ==========================================================================
+
+#include "Shape.h"
+#include "Bezier.h"
+
+#include <cfloat>
+
+using namespace std;
+using namespace glm;
+
+static const vec3 END_POINT_COLOUR(1.0f, 0.0f, 0.0f);
+static const vec3 INTERIOR_POINT_COLOUR(1.0f, 1.0f, 1.0f);
+
+// --------------------------------------------------------------------------
+
+void Shape::Clear()
+{
+    m_lookup.clear();
+    m_marker = -1;
+    points.clear();
+    colours.clear();
+    patchIndices.clear();
+    polygonIndices.clear();
+    pointIndices.clear();
+}
+
+unsigned int Shape::AddPoint(const vec2 &p, bool endPoint)
+{
+    pair<float, float> key(p.x, p.y);
+    map<pair<float, float>, unsigned int>::iterator found = m_lookup.find(key);
+    if (found != m_lookup.end()) {
+        // a point that ends any patch is drawn as an end point
+        if (endPoint) colours[found->second] = END_POINT_COLOUR;
+        return found->second;
+    }
+
+    unsigned int index = points.size();
+    m_lookup[key] = index;
+    points.push_back(p);
+    colours.push_back(endPoint ? END_POINT_COLOUR : INTERIOR_POINT_COLOUR);
+    pointIndices.push_back(index);
+    return index;
+}
+
+// the marker is never looked up by position, so a real control point at the
+// origin stays a separate, visible point
+unsigned int Shape::Marker()
+{
+    if (m_marker < 0) {
+        m_marker = int(points.size());
+        points.push_back(vec2(0.0f));
+        colours.push_back(vec3(0.0f));
+    }
+    return m_marker;
+}
+
+void Shape::AddQuadratic(const vec2 &p0, const vec2 &p1, const vec2 &p2)
+{
+    unsigned int i0 = AddPoint(p0, true);
+    unsigned int i1 = AddPoint(p1, false);
+    unsigned int i2 = AddPoint(p2, true);
+
+    unsigned int patch[4] = { i0, i1, i2, Marker() };
+    patchIndices.insert(patchIndices.end(), patch, patch + 4);
+
+    unsigned int polygon[4] = { i0, i1, i1, i2 };
+    polygonIndices.insert(polygonIndices.end(), polygon, polygon + 4);
+}
+
+void Shape::AddCubic(const vec2 &p0, const vec2 &p1, const vec2 &p2, const vec2 &p3)
+{
+    // a cubic ending exactly at the origin would read as a quadratic marker,
+    // so it ends a (far sub-pixel) step away instead
+    vec2 end = p3 == vec2(0.0f) ? vec2(FLT_MIN, 0.0f) : p3;
+
+    unsigned int i0 = AddPoint(p0, true);
+    unsigned int i1 = AddPoint(p1, false);
+    unsigned int i2 = AddPoint(p2, false);
+    unsigned int i3 = AddPoint(end, true);
+
+    unsigned int patch[4] = { i0, i1, i2, i3 };
+    patchIndices.insert(patchIndices.end(), patch, patch + 4);
+
+    unsigned int polygon[6] = { i0, i1, i1, i2, i2, i3 };
+    polygonIndices.insert(polygonIndices.end(), polygon, polygon + 6);
+}
+
+void Shape::AddSegment(const MySegment &segment)
+{
+    vec2 p0 = SegmentPoint(segment, 0);
+    if (segment.degree == 1) {
+        vec2 p1 = SegmentPoint(segment, 1);
+        AddQuadratic(p0, 0.5f*(p0 + p1), p1);
+    }
+    else if (segment.degree == 2)
+        AddQuadratic(p0, SegmentPoint(segment, 1), SegmentPoint(segment, 2));
+    else if (segment.degree == 3)
+        AddCubic(p0, SegmentPoint(segment, 1), SegmentPoint(segment, 2), SegmentPoint(segment, 3));
+}
+
+MySegment Shape::Segment(size_t patch) const
+{
+    vec2 corners[4];
+    for (int i = 0; i < 4; ++i)
+        corners[i] = points[patchIndices[4*patch + i]];
+    return SegmentFromPatch(corners);
+}
+
+// --------------------------------------------------------------------------
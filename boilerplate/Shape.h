@@ -0,0 +1,66 @@
+// ==========================================================================
+// Indexed Bezier Shapes
+//
+// This module defines a Shape, a set of Bezier patches that stores each of
+// its control points exactly once. The three ways a curve scene is drawn all
+// read that single array through index lists:
+//  - patch indices, 4 per patch for GL_PATCHES; quadratics end in a shared
+//    (0,0) marker point, the tessEval.glsl convention
+//  - polygon indices, pairs for GL_LINES tracing each patch's control polygon
+//  - point indices, every control point once for GL_POINTS
+//
+// The scene converter (SceneFile.h) builds every shape this way, so once
+// uploaded a dragged control point is a single 8 byte write rather than one
+// per view and per patch.
+// ==========================================================================
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+
+class Shape
+{
+    // shared control points by position, so patches meeting at an end share it
+    std::map<std::pair<float, float>, unsigned int> m_lookup;
+    int m_marker;   // index of the (0,0) quadratic marker, -1 until needed
+
+    unsigned int AddPoint(const glm::vec2 &p, bool endPoint);
+    unsigned int Marker();
+
+public:
+    std::vector<glm::vec2> points;
+    std::vector<glm::vec3> colours;     // per point: red ends, white interior
+
+    std::vector<unsigned int> patchIndices;
+    std::vector<unsigned int> polygonIndices;
+    std::vector<unsigned int> pointIndices;
+
+    Shape() : m_marker(-1)
+    {}
+
+    void Clear();
+
+    void AddQuadratic(const glm::vec2 &p0, const glm::vec2 &p1, const glm::vec2 &p2);
+    void AddCubic(const glm::vec2 &p0, const glm::vec2 &p1, const glm::vec2 &p2, const glm::vec2 &p3);
+
+    // adds a line (as the equivalent quadratic), quadratic or cubic; points
+    // are skipped
+    void AddSegment(const MySegment &segment);
+
+    // index of the shared (0,0) quadratic marker, -1 if there is none
+    int MarkerIndex() const { return m_marker; }
+
+    size_t PatchCount() const { return patchIndices.size() / 4; }
+    MySegment Segment(size_t patch) const;
+};
+
+// --------------------------------------------------------------------------
+#endif // SHAPE_H
@@ -0,0 +1,67 @@
+// ==========================================================================
+// Lock-Free Snapshots
+//
+// This module hands a small plain struct from one thread to another without
+// locks, so neither side ever waits on the other:
+//  - the writer publishes a complete copy whenever it changes something
+//  - the reader acquires the most recent complete copy at its own pace;
+//    copies published in between are skipped, not queued
+//
+// Three slots are used. The writer fills the back slot and swaps it with
+// the middle; the reader swaps the middle with the front only when the
+// middle holds something newer. A plain double buffer would need the
+// writer to wait until the reader has finished with the other half.
+//
+// Events that must not be lost when copies are skipped (a click, a key
+// press) are published as counters the reader compares with the last
+// value it saw, never as flags.
+// ==========================================================================
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+
+// --------------------------------------------------------------------------
+
+template <typename T>
+class SnapshotBuffer
+{
+    // slot indices; the middle carries FRESH while it holds an unread copy
+    static const unsigned int FRESH = 4;
+    static const unsigned int SLOT = 3;
+
+    T m_slots[3];
+    unsigned int m_back;                 // the writer's slot
+    std::atomic<unsigned int> m_middle;  // the slot in between, plus FRESH
+    unsigned int m_front;                // the reader's slot
+
+    // not copyable, both threads refer to this object
+    SnapshotBuffer(const SnapshotBuffer &);
+    SnapshotBuffer &operator=(const SnapshotBuffer &);
+
+public:
+    SnapshotBuffer(const T &initial = T()) : m_back(0), m_middle(1), m_front(2)
+    {
+        m_slots[0] = m_slots[1] = m_slots[2] = initial;
+    }
+
+    // writer thread only: makes value the latest snapshot
+    void Publish(const T &value)
+    {
+        m_slots[m_back] = value;
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & SLOT;
+    }
+
+    // reader thread only: copies the latest snapshot into value; returns
+    // true if it is newer than the one returned last time
+    bool Acquire(T *value)
+    {
+        bool fresh = (m_middle.load(std::memory_order_relaxed) & FRESH) != 0;
+        if (fresh) m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & SLOT;
+        *value = m_slots[m_front];
+        return fresh;
+    }
+};
+
+// --------------------------------------------------------------------------
+#endif // SNAPSHOT_H
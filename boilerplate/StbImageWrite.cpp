@@ -0,0 +1,10 @@
+// ==========================================================================
+// stb_image_write
+//
+// The one translation unit that compiles stb_image_write's implementation,
+// for every module that writes images (BezierBatch, FrameCapture); those
+// include the header alone.
+// ==========================================================================
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
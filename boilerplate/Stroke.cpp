@@ -0,0 +1,101 @@
+// ==========================================================================
+// GPU Stroke Expansion Support Code
+//
+// Host side of the stroke shaders: style uniforms and the texture buffer
+// views that let the geometry stage find neighbouring patches.
+// ==========================================================================
+
+#include "Stroke.h"
+#include "GLState.h"
+
+// texture units the patch and patch index views are bound to
+static const GLint PATCH_TEXTURE_UNIT = 0;
+static const GLint INDEX_TEXTURE_UNIT = 1;
+static const GLint ANIMATION_TEXTURE_UNIT = 2;
+
+// --------------------------------------------------------------------------
+
+const char *StrokeJoinName(StrokeJoin join)
+{
+    switch (join) {
+    case JOIN_MITER: return "miter";
+    case JOIN_ROUND: return "round";
+    case JOIN_BEVEL: return "bevel";
+    default:         return "?";
+    }
+}
+
+const char *StrokeCapName(StrokeCap cap)
+{
+    switch (cap) {
+    case CAP_BUTT:   return "butt";
+    case CAP_ROUND:  return "round";
+    case CAP_SQUARE: return "square";
+    default:         return "?";
+    }
+}
+
+// --------------------------------------------------------------------------
+
+GLuint CreatePatchTexture(GLuint vertexBuffer)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    BindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, vertexBuffer);
+    BindTexture(GL_TEXTURE_BUFFER, 0);
+    return texture;
+}
+
+GLuint CreateIndexTexture(GLuint elementBuffer)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    BindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, elementBuffer);
+    BindTexture(GL_TEXTURE_BUFFER, 0);
+    return texture;
+}
+
+GLuint CreateAnimationTexture(GLuint animationBuffer)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    BindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, animationBuffer);
+    BindTexture(GL_TEXTURE_BUFFER, 0);
+    return texture;
+}
+
+void UseStrokeStyle(GLuint program, const StrokeStyle &style, int width, int height)
+{
+    UseProgram(program);
+    glUniform2f(UniformLocation(program, "viewport"), float(width), float(height));
+    glUniform1f(UniformLocation(program, "halfWidth"), 0.5f * style.width);
+    glUniform1i(UniformLocation(program, "joinStyle"), style.join);
+    glUniform1i(UniformLocation(program, "capStyle"), style.cap);
+    glUniform1f(UniformLocation(program, "miterLimit"), style.miterLimit);
+    glUniform1i(UniformLocation(program, "patches"), PATCH_TEXTURE_UNIT);
+    glUniform1i(UniformLocation(program, "patchIndices"), INDEX_TEXTURE_UNIT);
+    glUniform1i(UniformLocation(program, "animations"), ANIMATION_TEXTURE_UNIT);
+}
+
+void SetStrokePatches(GLuint program, GLuint patchTexture, int firstPatch, int patchCount,
+                      GLuint indexTexture, GLuint animationTexture)
+{
+    GLint first = UniformLocation(program, "patchFirst");
+    if (first < 0) return;
+
+    ActiveTexture(GL_TEXTURE0 + ANIMATION_TEXTURE_UNIT);
+    BindTexture(GL_TEXTURE_BUFFER, animationTexture);
+    ActiveTexture(GL_TEXTURE0 + INDEX_TEXTURE_UNIT);
+    BindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    ActiveTexture(GL_TEXTURE0 + PATCH_TEXTURE_UNIT);
+    BindTexture(GL_TEXTURE_BUFFER, patchTexture);
+    glUniform1i(first, firstPatch);
+    glUniform1i(UniformLocation(program, "patchCount"), patchCount);
+    glUniform1i(UniformLocation(program, "indexedPatches"), indexTexture != 0);
+    glUniform1i(UniformLocation(program, "animatedPatches"), animationTexture != 0);
+}
+
+// --------------------------------------------------------------------------
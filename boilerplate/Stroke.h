@@ -0,0 +1,61 @@
+// ==========================================================================
+// GPU Stroke Expansion Support Code
+//
+// Thick outlines are drawn by adding shaders/strokeGeometry.glsl after the
+// usual tessellation stages and shaders/strokeFragment.glsl after that. The
+// geometry stage turns every isoline segment into a quad in pixel space and
+// adds joins and caps at patch ends; the fragment stage computes analytic
+// anti-aliased coverage, so strokes need blending enabled.
+//
+// Joins need the neighbouring patches, which the geometry stage reads from
+// the vertex buffer being drawn through a texture buffer view of it, and for
+// indexed shapes through a second view of the element buffer. The views
+// share the buffers' storage, so they cost no extra uploads and follow
+// glBufferSubData edits automatically.
+// ==========================================================================
+#ifndef STROKE_H
+#define STROKE_H
+
+#include <glad/glad.h>
+
+// values match joinStyle and capStyle in strokeGeometry.glsl
+enum StrokeJoin { JOIN_MITER, JOIN_ROUND, JOIN_BEVEL, JOIN_COUNT };
+enum StrokeCap  { CAP_BUTT, CAP_ROUND, CAP_SQUARE, CAP_COUNT };
+
+struct StrokeStyle
+{
+    float       width;          // in pixels; 0 draws 1 pixel isolines instead
+    StrokeJoin  join;
+    StrokeCap   cap;
+    float       miterLimit;     // longest miter as a multiple of width
+
+    StrokeStyle() : width(0), join(JOIN_MITER), cap(CAP_BUTT), miterLimit(4.0f)
+    {}
+};
+
+const char *StrokeJoinName(StrokeJoin join);
+const char *StrokeCapName(StrokeCap cap);
+
+// creates a texture buffer view of a patch vertex buffer (one vec2 per texel)
+GLuint CreatePatchTexture(GLuint vertexBuffer);
+
+// creates a texture buffer view of an element buffer of GLuint patch indices
+GLuint CreateIndexTexture(GLuint elementBuffer);
+
+// creates a texture buffer view of per vertex animation parameters (one vec4
+// per texel, see SceneFile.h)
+GLuint CreateAnimationTexture(GLuint animationBuffer);
+
+// binds a stroke program and sets the style for a framebuffer of the given size
+void UseStrokeStyle(GLuint program, const StrokeStyle &style, int width, int height);
+
+// binds the patch texture of the buffer about to be drawn, and the range of
+// patches the draw covers; harmless for programs without a stroke stage.
+// Pass the index texture when the draw is indexed, 0 when it reads 4
+// consecutive vertices per patch, and the animation texture when the
+// vertices are animated.
+void SetStrokePatches(GLuint program, GLuint patchTexture, int firstPatch, int patchCount,
+                      GLuint indexTexture = 0, GLuint animationTexture = 0);
+
+// --------------------------------------------------------------------------
+#endif // STROKE_H
@@ -0,0 +1,903 @@
+// ==========================================================================
+// Streaming SVG Path Import
+//
+// A single forward pass over the document text: tags are found with memchr,
+// attribute values are used where they lie, and numbers are parsed by hand
+// (strtod is locale aware and several times slower). With more than one
+// core, the pass only finds the paths; workers parse them, and their
+// segments are recorded and sent on in document order.
+// ==========================================================================
+
+#include "SvgImport.h"
+#include "Bezier.h"
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace glm;
+
+static const float PI = 3.14159265358979f;
+
+// --------------------------------------------------------------------------
+// Sinks
+
+void SvgContourSink::Segment(const MySegment &segment)
+{
+    m_current.push_back(segment);
+}
+
+void SvgContourSink::EndSubpath(bool closed)
+{
+    if (m_current.empty()) return;
+    contours.push_back(MyContour());
+    contours.back().swap(m_current);
+}
+
+void SvgPatchSink::Segment(const MySegment &segment)
+{
+    AppendCubicPatch(segment, &vertices);
+}
+
+// --------------------------------------------------------------------------
+// Lexing
+
+static inline bool IsSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// skips white space and at most one comma
+static inline const char *SkipSeparators(const char *p, const char *end)
+{
+    while (p < end && IsSpace(*p)) ++p;
+    if (p < end && *p == ',') {
+        ++p;
+        while (p < end && IsSpace(*p)) ++p;
+    }
+    return p;
+}
+
+// reads an SVG number at *p, advancing past it; returns false and leaves *p
+// alone if there is none
+static bool ParseNumber(const char **cursor, const char *end, float *value)
+{
+    static const double POWERS[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    // multiplying by these rather than dividing by POWERS is off by at most
+    // an ulp of a double, far below what survives the conversion to float
+    static const double INVERSE_POWERS[] = {
+        1e-0, 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9, 1e-10, 1e-11,
+        1e-12, 1e-13, 1e-14, 1e-15, 1e-16, 1e-17, 1e-18, 1e-19, 1e-20, 1e-21, 1e-22
+    };
+
+    const char *p = SkipSeparators(*cursor, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    // the usual case, at most 18 digits in all, is read without per digit
+    // bookkeeping; longer numbers are read again keeping 18 significant ones
+    const char *first = p;
+    unsigned long long mantissa = 0;
+    for (; p < end && IsDigit(*p); ++p) mantissa = mantissa*10 + (*p - '0');
+    ptrdiff_t digits = p - first;
+    int exponent = 0;
+    if (p < end && *p == '.') {
+        const char *fraction = ++p;
+        for (; p < end && IsDigit(*p); ++p) mantissa = mantissa*10 + (*p - '0');
+        exponent = -int(p - fraction);
+        digits += p - fraction;
+    }
+    if (digits == 0) return false;
+
+    if (digits > 18) {
+        mantissa = 0;
+        exponent = 0;
+        int significant = 0;
+        for (p = first; p < end && IsDigit(*p); ++p) {
+            if (significant < 18) { mantissa = mantissa*10 + (*p - '0'); if (mantissa) ++significant; }
+            else ++exponent;
+        }
+        if (p < end && *p == '.') {
+            for (++p; p < end && IsDigit(*p); ++p) {
+                if (significant < 18) { mantissa = mantissa*10 + (*p - '0'); if (mantissa) ++significant; --exponent; }
+            }
+        }
+    }
+
+    // an exponent needs digits, so "2em" is not one
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) negativeExponent = *q++ == '-';
+        if (q < end && IsDigit(*q)) {
+            int e = 0;
+            for (; q < end && IsDigit(*q); ++q)
+                if (e < 1000) e = e*10 + (*q - '0');
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    double result = double(mantissa);
+    if (exponent < 0) result = -exponent <= 22 ? result * INVERSE_POWERS[-exponent] : result * pow(10.0, exponent);
+    else if (exponent > 0) result = exponent <= 22 ? result * POWERS[exponent] : result * pow(10.0, exponent);
+
+    *value = float(negative ? -result : result);
+    *cursor = p;
+    return true;
+}
+
+// arc flags are a single 0 or 1 and need no separator after them
+static bool ParseFlag(const char **cursor, const char *end, bool *flag)
+{
+    const char *p = SkipSeparators(*cursor, end);
+    if (p >= end || (*p != '0' && *p != '1')) return false;
+    *flag = *p == '1';
+    *cursor = p + 1;
+    return true;
+}
+
+static bool ParsePoint(const char **cursor, const char *end, vec2 *point)
+{
+    const char *p = *cursor;
+    if (!ParseNumber(&p, end, &point->x) || !ParseNumber(&p, end, &point->y)) return false;
+    *cursor = p;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// Transforms
+
+SvgTransform SvgTransform::operator*(const SvgTransform &o) const
+{
+    return SvgTransform(a*o.a + c*o.b, b*o.a + d*o.b,
+                        a*o.c + c*o.d, b*o.c + d*o.d,
+                        a*o.e + c*o.f + e, b*o.e + d*o.f + f);
+}
+
+static bool NameIs(const char *begin, const char *end, const char *name)
+{
+    size_t length = strlen(name);
+    return size_t(end - begin) == length && memcmp(begin, name, length) == 0;
+}
+
+bool ParseSvgTransform(const char *begin, const char *end, SvgTransform *transform)
+{
+    const char *p = begin;
+    while (true)
+    {
+        p = SkipSeparators(p, end);
+        if (p >= end) return true;
+
+        const char *name = p;
+        while (p < end && ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z'))) ++p;
+        const char *nameEnd = p;
+        while (p < end && IsSpace(*p)) ++p;
+        if (p >= end || *p != '(') return false;
+        ++p;
+
+        float v[6];
+        int count = 0;
+        while (count < 6 && ParseNumber(&p, end, &v[count])) ++count;
+        while (p < end && IsSpace(*p)) ++p;
+        if (p >= end || *p != ')') return false;
+        ++p;
+
+        SvgTransform m;
+        if (NameIs(name, nameEnd, "matrix") && count == 6)
+            m = SvgTransform(v[0], v[1], v[2], v[3], v[4], v[5]);
+        else if (NameIs(name, nameEnd, "translate") && (count == 1 || count == 2))
+            m = SvgTransform(1, 0, 0, 1, v[0], count == 2 ? v[1] : 0.0f);
+        else if (NameIs(name, nameEnd, "scale") && (count == 1 || count == 2))
+            m = SvgTransform(v[0], 0, 0, count == 2 ? v[1] : v[0], 0, 0);
+        else if (NameIs(name, nameEnd, "rotate") && (count == 1 || count == 3)) {
+            float angle = v[0] * PI / 180.0f;
+            m = SvgTransform(cos(angle), sin(angle), -sin(angle), cos(angle), 0, 0);
+            if (count == 3)
+                m = SvgTransform(1, 0, 0, 1, v[1], v[2]) * m * SvgTransform(1, 0, 0, 1, -v[1], -v[2]);
+        }
+        else if (NameIs(name, nameEnd, "skewX") && count == 1)
+            m = SvgTransform(1, 0, tan(v[0] * PI / 180.0f), 1, 0, 0);
+        else if (NameIs(name, nameEnd, "skewY") && count == 1)
+            m = SvgTransform(1, tan(v[0] * PI / 180.0f), 0, 1, 0, 0);
+        else
+            return false;
+
+        // a list applies right to left, so later entries act on points first
+        *transform = *transform * m;
+    }
+}
+
+// --------------------------------------------------------------------------
+// Path data
+
+namespace {
+
+// current position and the state the reflecting commands need
+struct PathState
+{
+    const SvgTransform &transform;
+    SvgPathSink *sink;
+    size_t segments;
+
+    vec2 current, start;
+    vec2 lastControl;       // second control point of the last C/S or control of the last Q/T
+    char lastCommand;       // upper case command of the last segment
+    bool open;              // the current subpath has segments
+
+    PathState(const SvgTransform &t, SvgPathSink *s)
+        : transform(t), sink(s), segments(0), lastCommand(0), open(false)
+    {}
+
+    void Emit(int degree, const vec2 *points)
+    {
+        MySegment segment(degree);
+        for (int i = 0; i <= degree; ++i)
+            SetSegmentPoint(&segment, i, transform.Apply(points[i]));
+        sink->Segment(segment);
+        ++segments;
+        open = true;
+    }
+
+    void Line(const vec2 &p)
+    {
+        vec2 points[2] = { current, p };
+        Emit(1, points);
+        current = p;
+    }
+
+    void Quadratic(const vec2 &c, const vec2 &p)
+    {
+        vec2 points[3] = { current, c, p };
+        Emit(2, points);
+        lastControl = c;
+        current = p;
+    }
+
+    void Cubic(const vec2 &c0, const vec2 &c1, const vec2 &p)
+    {
+        vec2 points[4] = { current, c0, c1, p };
+        Emit(3, points);
+        lastControl = c1;
+        current = p;
+    }
+
+    void EndSubpath(bool closed)
+    {
+        if (open) sink->EndSubpath(closed);
+        open = false;
+    }
+
+    void Arc(vec2 radii, float rotation, bool largeArc, bool sweep, const vec2 &p);
+};
+
+// signed angle from u to v
+static float Angle(const vec2 &u, const vec2 &v)
+{
+    return atan2(u.x*v.y - u.y*v.x, dot(u, v));
+}
+
+// endpoint to centre parameterization, SVG 1.1 implementation notes F.6.5,
+// then one cubic per quarter turn or less
+void PathState::Arc(vec2 radii, float rotation, bool largeArc, bool sweep, const vec2 &p)
+{
+    if (p == current) return;
+    radii = abs(radii);
+    if (radii.x == 0.0f || radii.y == 0.0f) {
+        Line(p);
+        return;
+    }
+
+    float phi = rotation * PI / 180.0f;
+    float cosPhi = cos(phi), sinPhi = sin(phi);
+    vec2 half = 0.5f * (current - p);
+    vec2 q(cosPhi*half.x + sinPhi*half.y, -sinPhi*half.x + cosPhi*half.y);
+
+    // radii too small to reach are scaled up until they just do
+    float lambda = (q.x*q.x)/(radii.x*radii.x) + (q.y*q.y)/(radii.y*radii.y);
+    if (lambda > 1.0f) radii *= sqrt(lambda);
+
+    float rx2 = radii.x*radii.x, ry2 = radii.y*radii.y;
+    float numerator = rx2*ry2 - rx2*q.y*q.y - ry2*q.x*q.x;
+    float denominator = rx2*q.y*q.y + ry2*q.x*q.x;
+    float coefficient = sqrt(std::max(0.0f, numerator / denominator));
+    if (largeArc == sweep) coefficient = -coefficient;
+    vec2 centreQ(coefficient * radii.x*q.y/radii.y, -coefficient * radii.y*q.x/radii.x);
+    vec2 centre(cosPhi*centreQ.x - sinPhi*centreQ.y + 0.5f*(current.x + p.x),
+                sinPhi*centreQ.x + cosPhi*centreQ.y + 0.5f*(current.y + p.y));
+
+    vec2 u((q.x - centreQ.x)/radii.x, (q.y - centreQ.y)/radii.y);
+    vec2 v((-q.x - centreQ.x)/radii.x, (-q.y - centreQ.y)/radii.y);
+    float theta = Angle(vec2(1.0f, 0.0f), u);
+    float sweepAngle = Angle(u, v);
+    if (!sweep && sweepAngle > 0.0f) sweepAngle -= 2.0f*PI;
+    if (sweep && sweepAngle < 0.0f) sweepAngle += 2.0f*PI;
+
+    int pieces = std::max(1, int(ceil(fabs(sweepAngle) / (0.5f*PI) - 1e-4f)));
+    float delta = sweepAngle / pieces;
+    float k = 4.0f/3.0f * tan(0.25f*delta);
+
+    // each piece is built on the unit circle, then placed on the ellipse
+    for (int i = 0; i < pieces; ++i)
+    {
+        float t0 = theta + i*delta, t1 = t0 + delta;
+        vec2 e0(cos(t0), sin(t0)), e1(cos(t1), sin(t1));
+        vec2 c0 = e0 + k*vec2(-e0.y, e0.x);
+        vec2 c1 = e1 - k*vec2(-e1.y, e1.x);
+
+        vec2 points[3] = { c0, c1, e1 };
+        for (int j = 0; j < 3; ++j) {
+            vec2 s = points[j] * radii;
+            points[j] = centre + vec2(cosPhi*s.x - sinPhi*s.y, sinPhi*s.x + cosPhi*s.y);
+        }
+        Cubic(points[0], points[1], i + 1 == pieces ? p : points[2]);
+    }
+}
+
+}
+
+bool ParseSvgPathData(const char *begin, const char *end, const SvgTransform &transform,
+                      SvgPathSink *sink, size_t *segments)
+{
+    PathState state(transform, sink);
+    const char *p = begin;
+    char command = 0;
+    bool ok = true;
+
+    while (true)
+    {
+        while (p < end && IsSpace(*p)) ++p;
+        if (p >= end) break;
+
+        // a new command letter, or more arguments for the current one
+        char c = *p;
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+            command = c;
+            ++p;
+        }
+        else if (command == 0 || command == 'Z' || command == 'z') {
+            ok = false;
+            break;
+        }
+
+        bool relative = command >= 'a';
+        vec2 origin = relative ? state.current : vec2(0.0f);
+        char upper = relative ? command - ('a' - 'A') : command;
+        char previous = state.lastCommand;
+        state.lastCommand = upper;
+
+        vec2 a, b, d;
+        float value;
+        bool largeArc, sweep;
+        switch (upper)
+        {
+        case 'M':
+            if (!(ok = ParsePoint(&p, end, &a))) break;
+            state.EndSubpath(false);
+            state.current = state.start = origin + a;
+            // further pairs are implicit line tos
+            command = relative ? 'l' : 'L';
+            break;
+        case 'L':
+            if ((ok = ParsePoint(&p, end, &a))) state.Line(origin + a);
+            break;
+        case 'H':
+            if ((ok = ParseNumber(&p, end, &value)))
+                state.Line(vec2(relative ? state.current.x + value : value, state.current.y));
+            break;
+        case 'V':
+            if ((ok = ParseNumber(&p, end, &value)))
+                state.Line(vec2(state.current.x, relative ? state.current.y + value : value));
+            break;
+        case 'Q':
+            if ((ok = ParsePoint(&p, end, &a) && ParsePoint(&p, end, &b)))
+                state.Quadratic(origin + a, origin + b);
+            break;
+        case 'T':
+            if ((ok = ParsePoint(&p, end, &b))) {
+                bool reflect = previous == 'Q' || previous == 'T';
+                a = reflect ? 2.0f*state.current - state.lastControl : state.current;
+                state.Quadratic(a, origin + b);
+            }
+            break;
+        case 'C':
+            if ((ok = ParsePoint(&p, end, &a) && ParsePoint(&p, end, &b) && ParsePoint(&p, end, &d)))
+                state.Cubic(origin + a, origin + b, origin + d);
+            break;
+        case 'S':
+            if ((ok = ParsePoint(&p, end, &b) && ParsePoint(&p, end, &d))) {
+                bool reflect = previous == 'C' || previous == 'S';
+                a = reflect ? 2.0f*state.current - state.lastControl : state.current;
+                state.Cubic(a, origin + b, origin + d);
+            }
+            break;
+        case 'A':
+            if ((ok = ParsePoint(&p, end, &a) && ParseNumber(&p, end, &value) &&
+                      ParseFlag(&p, end, &largeArc) && ParseFlag(&p, end, &sweep) &&
+                      ParsePoint(&p, end, &d)))
+                state.Arc(a, value, largeArc, sweep, origin + d);
+            break;
+        case 'Z':
+            if (state.current != state.start) state.Line(state.start);
+            state.current = state.start;
+            state.EndSubpath(true);
+            break;
+        default:
+            ok = false;
+        }
+        if (!ok) break;
+    }
+
+    state.EndSubpath(false);
+    if (segments) *segments += state.segments;
+    return ok;
+}
+
+// --------------------------------------------------------------------------
+// Documents
+
+// finds the first occurrence of a string in [p, end), or end
+static const char *Find(const char *p, const char *end, const char *text)
+{
+    size_t length = strlen(text);
+    while (p < end) {
+        p = (const char*)memchr(p, text[0], end - p);
+        if (!p || size_t(end - p) < length) return end;
+        if (memcmp(p, text, length) == 0) return p;
+        ++p;
+    }
+    return end;
+}
+
+static bool StartsWith(const char *p, const char *end, const char *text)
+{
+    size_t length = strlen(text);
+    return size_t(end - p) >= length && memcmp(p, text, length) == 0;
+}
+
+// calls visit(d, dEnd, transform) for every <path> element with path data,
+// in document order, with the transforms of the elements around it composed
+template <typename Visit>
+static void ScanPaths(const char *begin, const char *end, const SvgTransform &root, Visit visit)
+{
+    // composed transform of every element still open
+    vector<SvgTransform> open(1, root);
+
+    const char *p = begin;
+    while (p < end)
+    {
+        p = (const char*)memchr(p, '<', end - p);
+        if (!p) break;
+        ++p;
+
+        if (StartsWith(p, end, "!--")) { p = Find(p, end, "-->"); continue; }
+        if (StartsWith(p, end, "![CDATA[")) { p = Find(p, end, "]]>"); continue; }
+        if (p < end && (*p == '?' || *p == '!')) { p = Find(p, end, ">"); continue; }
+        if (p < end && *p == '/') {
+            if (open.size() > 1) open.pop_back();
+            p = Find(p, end, ">");
+            continue;
+        }
+
+        const char *name = p;
+        while (p < end && !IsSpace(*p) && *p != '/' && *p != '>') ++p;
+        const char *nameEnd = p;
+
+        // attributes, skipping over quoted values so '>' inside them is harmless
+        const char *d = 0, *dEnd = 0, *transform = 0, *transformEnd = 0;
+        bool selfClosing = false;
+        while (p < end && *p != '>')
+        {
+            if (*p == '/') { selfClosing = true; ++p; continue; }
+            if (IsSpace(*p)) { ++p; continue; }
+
+            const char *attribute = p;
+            while (p < end && *p != '=' && !IsSpace(*p) && *p != '>' && *p != '/') ++p;
+            const char *attributeEnd = p;
+            while (p < end && IsSpace(*p)) ++p;
+            if (p >= end || *p != '=') continue;
+            ++p;
+            while (p < end && IsSpace(*p)) ++p;
+            if (p >= end || (*p != '"' && *p != '\'')) continue;
+
+            const char *value = p + 1;
+            const char *valueEnd = (const char*)memchr(value, *p, end - value);
+            if (!valueEnd) return;
+            p = valueEnd + 1;
+            selfClosing = false;
+
+            if (NameIs(attribute, attributeEnd, "d")) { d = value; dEnd = valueEnd; }
+            else if (NameIs(attribute, attributeEnd, "transform")) { transform = value; transformEnd = valueEnd; }
+        }
+        if (p < end) ++p;
+
+        SvgTransform local;
+        if (transform) ParseSvgTransform(transform, transformEnd, &local);
+        SvgTransform composed = open.back() * local;
+
+        if (NameIs(name, nameEnd, "path") && d) visit(d, dEnd, composed);
+        if (!selfClosing) open.push_back(composed);
+    }
+}
+
+namespace {
+
+// a <path> element found by the scan
+struct PathJob
+{
+    const char *d, *dEnd;
+    SvgTransform transform;
+};
+
+// degrees no segment has, marking where a recorded subpath ends
+const unsigned int SUBPATH_END = 4;
+const unsigned int CLOSED_SUBPATH_END = 5;
+
+// keeps what a path sends to a sink, to be sent on in document order
+class RecordingSink : public SvgPathSink
+{
+public:
+    vector<MySegment> events;
+
+    void Segment(const MySegment &segment)
+    {
+        events.push_back(segment);
+    }
+
+    void EndSubpath(bool closed)
+    {
+        events.push_back(MySegment(closed ? CLOSED_SUBPATH_END : SUBPATH_END));
+    }
+};
+
+// consecutive paths, parsed by one worker and replayed by the caller
+struct PathBatch
+{
+    size_t first, last;
+    RecordingSink recorded;
+    vector<pair<size_t, bool> > paths;      // end of each path's events, and whether it parsed
+    bool done;
+
+    PathBatch(size_t f) : first(f), last(f), done(false)
+    {}
+};
+
+// path data per batch: large enough that a batch outweighs handing it over,
+// small enough that the recorded segments of a few stay in cache
+const size_t BATCH_BYTES = 256 << 10;
+
+void ReplayBatch(PathBatch *batch, SvgPathSink *sink, SvgImportStats *stats)
+{
+    const vector<MySegment> &events = batch->recorded.events;
+    size_t e = 0;
+    for (size_t i = 0; i < batch->paths.size(); ++i)
+    {
+        sink->BeginPath();
+        size_t segments = 0;
+        for (; e < batch->paths[i].first; ++e) {
+            if (events[e].degree < SUBPATH_END) {
+                sink->Segment(events[e]);
+                ++segments;
+            }
+            else sink->EndSubpath(events[e].degree == CLOSED_SUBPATH_END);
+        }
+        sink->EndPath();
+        if (stats) {
+            ++stats->paths;
+            stats->segments += segments;
+            if (!batch->paths[i].second) ++stats->errors;
+        }
+    }
+    vector<MySegment>().swap(batch->recorded.events);
+}
+
+}
+
+void ImportSvg(const char *begin, const char *end, SvgPathSink *sink, SvgImportStats *stats,
+               const SvgTransform &root, int workers)
+{
+    if (stats) stats->bytes += end - begin;
+    if (workers <= 0) workers = std::max(1, int(thread::hardware_concurrency()));
+
+    // one pass, parsing each path as the scan finds it
+    if (workers == 1 || size_t(end - begin) < 2 * BATCH_BYTES) {
+        ScanPaths(begin, end, root, [&](const char *d, const char *dEnd, const SvgTransform &transform) {
+            sink->BeginPath();
+            bool ok = ParseSvgPathData(d, dEnd, transform, sink, stats ? &stats->segments : 0);
+            sink->EndPath();
+            if (stats) {
+                ++stats->paths;
+                if (!ok) ++stats->errors;
+            }
+        });
+        return;
+    }
+
+    // paths are independent once their transforms are known, so workers
+    // parse batches of them while this thread hands the batches, in order,
+    // to the sink
+    vector<PathJob> jobs;
+    ScanPaths(begin, end, root, [&](const char *d, const char *dEnd, const SvgTransform &transform) {
+        PathJob job = { d, dEnd, transform };
+        jobs.push_back(job);
+    });
+
+    vector<PathBatch> batches;
+    size_t batchBytes = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (batches.empty() || batchBytes >= BATCH_BYTES) {
+            batches.push_back(PathBatch(i));
+            batchBytes = 0;
+        }
+        batches.back().last = i + 1;
+        batchBytes += jobs[i].dEnd - jobs[i].d;
+    }
+
+    // workers stay at most two batches each ahead of the replay, which
+    // bounds the memory of the recorded segments
+    mutex batchMutex;
+    condition_variable parsed, replayed;
+    size_t next = 0, replayedCount = 0;
+    size_t ahead = 2 * size_t(workers);
+
+    vector<thread> threads;
+    for (int w = 0; w < workers; ++w)
+        threads.push_back(thread([&]() {
+            unique_lock<mutex> lock(batchMutex);
+            while (true)
+            {
+                replayed.wait(lock, [&]() { return next == batches.size() || next < replayedCount + ahead; });
+                if (next == batches.size()) return;
+                PathBatch &batch = batches[next++];
+                lock.unlock();
+
+                for (size_t i = batch.first; i < batch.last; ++i) {
+                    bool ok = ParseSvgPathData(jobs[i].d, jobs[i].dEnd, jobs[i].transform, &batch.recorded);
+                    batch.paths.push_back(make_pair(batch.recorded.events.size(), ok));
+                }
+
+                lock.lock();
+                batch.done = true;
+                parsed.notify_all();
+            }
+        }));
+
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        {
+            unique_lock<mutex> lock(batchMutex);
+            parsed.wait(lock, [&]() { return batches[i].done; });
+        }
+        ReplayBatch(&batches[i], sink, stats);
+        {
+            lock_guard<mutex> lock(batchMutex);
+            replayedCount = i + 1;
+        }
+        replayed.notify_all();
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+}
+
+// maps a whole file read only; returns null on failure
+static const char *MapFile(const string &filename, size_t *size)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "SVG ERROR: could not open " << filename << endl;
+        return 0;
+    }
+    struct stat info;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        cout << "SVG ERROR: could not map " << filename << endl;
+        return 0;
+    }
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+    *size = info.st_size;
+    return (const char*)data;
+}
+
+bool ImportSvgFile(const string &filename, SvgPathSink *sink, SvgImportStats *stats)
+{
+    size_t size;
+    const char *data = MapFile(filename, &size);
+    if (!data) return false;
+    ImportSvg(data, data + size, sink, stats);
+    munmap((void*)data, size);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// Conversion to scene files
+
+namespace {
+
+// exact bounds of every curve
+class BoundsSink : public SvgPathSink
+{
+public:
+    vec2 lo, hi;
+
+    BoundsSink() : lo(1e30f), hi(-1e30f)
+    {}
+
+    void Segment(const MySegment &segment)
+    {
+        vec2 a, b;
+        SegmentBounds(segment, &a, &b);
+        lo = min(lo, a);
+        hi = max(hi, b);
+    }
+};
+
+// one scene shape per path, curves only
+class ShapeSink : public SvgPathSink
+{
+public:
+    vector<SceneShapeSource> shapes;
+
+    void BeginPath()
+    {
+        shapes.push_back(SceneShapeSource());
+        shapes.back().drawModes = DRAW_CURVES;
+    }
+
+    void Segment(const MySegment &segment)
+    {
+        shapes.back().shape.AddSegment(segment);
+    }
+
+    void EndPath()
+    {
+        if (shapes.back().shape.PatchCount() == 0) shapes.pop_back();
+    }
+};
+
+}
+
+bool ConvertSvgToScene(const string &svgFile, const string &sceneFile)
+{
+    size_t size;
+    const char *data = MapFile(svgFile, &size);
+    if (!data) return false;
+
+    // a first pass for the bounds is cheap next to building the shapes
+    BoundsSink bounds;
+    ImportSvg(data, data + size, &bounds, 0);
+
+    ShapeSink shapes;
+    SvgImportStats stats;
+    if (bounds.lo.x <= bounds.hi.x) {
+        vec2 extent = bounds.hi - bounds.lo;
+        vec2 centre = 0.5f * (bounds.lo + bounds.hi);
+        float scale = 1.8f / std::max(std::max(extent.x, extent.y), 1e-20f);
+        SvgTransform fit(scale, 0, 0, -scale, -scale*centre.x, scale*centre.y);
+        ImportSvg(data, data + size, &shapes, &stats, fit);
+    }
+    munmap((void*)data, size);
+
+    cout << svgFile << ": " << stats.paths << " paths, " << stats.segments << " segments";
+    if (stats.errors) cout << ", " << stats.errors << " with malformed data";
+    cout << endl;
+    return WriteSceneFile(sceneFile, shapes.shapes);
+}
+
+// --------------------------------------------------------------------------
+// Benchmark
+
+namespace {
+
+// counts without storing, so only parsing is timed
+class CountingSink : public SvgPathSink
+{
+public:
+    float checksum;
+
+    CountingSink() : checksum(0)
+    {}
+
+    void Segment(const MySegment &segment)
+    {
+        checksum += segment.x[segment.degree];
+    }
+};
+
+}
+
+// appends a path in the style of exported maps and diagrams: long relative
+// polylines, smooth curves, arcs and compact number syntax
+static void AppendBenchmarkPath(string *svg, unsigned int seed)
+{
+    char buffer[128];
+    srand(seed);
+    float x = float(rand() % 10000) / 10.0f, y = float(rand() % 10000) / 10.0f;
+    snprintf(buffer, sizeof(buffer), "<path fill=\"none\" stroke=\"#333\" d=\"M%.2f,%.2f", x, y);
+    *svg += buffer;
+
+    int pieces = 20 + rand() % 40;
+    for (int i = 0; i < pieces; ++i)
+    {
+        float a = (rand() % 2000 - 1000) / 100.0f, b = (rand() % 2000 - 1000) / 100.0f;
+        switch (i % 6) {
+        case 0: snprintf(buffer, sizeof(buffer), "l%.2f %.2f %.2f-%.2f", a, b, b, fabs(a)); break;
+        case 1: snprintf(buffer, sizeof(buffer), "c%.2f,%.2f %.2f,%.2f %.2f,%.2f", a, b, b, a, a + b, b - a); break;
+        case 2: snprintf(buffer, sizeof(buffer), "s%.2f %.2f %.2f %.2f", b, a, a, a); break;
+        case 3: snprintf(buffer, sizeof(buffer), "h%.2fv%.2f", a, b); break;
+        case 4: snprintf(buffer, sizeof(buffer), "q%.2f %.2f %.2f %.2ft%.2f %.2f", a, b, b, a, a, b); break;
+        case 5: snprintf(buffer, sizeof(buffer), "a%.1f %.1f 30 0%d%.2f %.2f", fabs(a) + 1, fabs(b) + 1, i & 1, a, b); break;
+        }
+        *svg += buffer;
+    }
+    *svg += (seed % 3 == 0) ? "z\"/>\n" : "\"/>\n";
+}
+
+void BenchmarkSvgImport(size_t megabytes, int trials)
+{
+    string svg = "<?xml version=\"1.0\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 1000 1000\">\n";
+    unsigned int seed = 0;
+    while (svg.size() < megabytes << 20)
+    {
+        char group[96];
+        snprintf(group, sizeof(group), "<g transform=\"translate(%d %d) rotate(%d)\">\n", seed % 50, seed % 70, seed % 360);
+        svg += group;
+        for (int i = 0; i < 64; ++i) AppendBenchmarkPath(&svg, ++seed);
+        svg += "</g>\n";
+    }
+    svg += "</svg>\n";
+
+    cout << "SVG import: " << svg.size() / double(1 << 20) << " MB generated" << endl;
+
+    vector<int> threadCounts(1, 1);
+    int cores = int(thread::hardware_concurrency());
+    if (cores > 1) threadCounts.push_back(cores);
+
+    for (size_t t = 0; t < threadCounts.size(); ++t)
+    {
+        int workers = threadCounts[t];
+        double best = 1e30;
+        SvgImportStats stats;
+        CountingSink sink;
+        for (int trial = 0; trial <= trials; ++trial)
+        {
+            stats = SvgImportStats();
+            chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+            ImportSvg(svg.data(), svg.data() + svg.size(), &sink, &stats, SvgTransform(), workers);
+            double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+            if (trial > 0) best = std::min(best, seconds);
+        }
+
+        cout << "  " << workers << (workers == 1 ? " thread: " : " threads: ") << stats.paths << " paths, "
+             << stats.segments << " segments, " << stats.errors << " errors" << endl;
+        cout << "  " << stats.bytes / best / (1 << 20) << " MB/s, " << stats.segments / best / 1e6 << " M segments/s"
+             << " (checksum " << sink.checksum << ")" << endl;
+    }
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,135 @@
+// ==========================================================================
+// Streaming SVG Path Import
+//
+// This module reads the <path d="..."> elements of an SVG document straight
+// into MySegment geometry, without building a DOM or copying the text:
+//  - the document is scanned tag by tag; only path data and transform
+//    attributes are looked at, everything else is skipped over
+//  - path data supports M/L/H/V/Q/T/C/S/A/Z in absolute and relative
+//    forms, implicit command repetition and the compact number syntax
+//    ("1.5.5", "1-2", arc flags without separators)
+//  - transform attributes of paths and every enclosing element are composed
+//    and applied to the control points
+//  - elliptical arcs become cubics of at most 90 degrees each
+//  - large documents are parsed on every core, paths being independent
+//
+// Geometry is handed to an SvgPathSink as it is parsed, so callers choose
+// what to build: MyContours (SvgContourSink), 4 vertex patches ready to
+// upload (SvgPatchSink) or anything else. Coordinates are SVG user units,
+// y pointing down.
+// ==========================================================================
+#ifndef SVGIMPORT_H
+#define SVGIMPORT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GlyphExtractor.h"
+
+// --------------------------------------------------------------------------
+// Receivers of parsed geometry
+
+class SvgPathSink
+{
+public:
+    virtual ~SvgPathSink() {}
+
+    // a <path> element starts and ends
+    virtual void BeginPath() {}
+    virtual void EndPath() {}
+
+    // one segment of the current subpath, already transformed
+    virtual void Segment(const MySegment &segment) = 0;
+
+    // the current subpath ends; closed subpaths end where they started
+    virtual void EndSubpath(bool closed) {}
+};
+
+// collects every subpath as a MyContour
+class SvgContourSink : public SvgPathSink
+{
+public:
+    std::vector<MyContour> contours;
+
+    void Segment(const MySegment &segment);
+    void EndSubpath(bool closed);
+
+private:
+    MyContour m_current;
+};
+
+// appends every segment as a 4 vertex cubic patch (see AppendCubicPatch)
+class SvgPatchSink : public SvgPathSink
+{
+public:
+    std::vector<glm::vec2> vertices;
+
+    void Segment(const MySegment &segment);
+};
+
+// --------------------------------------------------------------------------
+
+struct SvgImportStats
+{
+    size_t bytes;
+    size_t paths;
+    size_t segments;
+    size_t errors;      // paths whose data stopped at a syntax error
+
+    SvgImportStats() : bytes(0), paths(0), segments(0), errors(0)
+    {}
+};
+
+// a 2D affine transform, the SVG matrix(a b c d e f)
+struct SvgTransform
+{
+    float a, b, c, d, e, f;
+
+    SvgTransform() : a(1), b(0), c(0), d(1), e(0), f(0)
+    {}
+    SvgTransform(float a_, float b_, float c_, float d_, float e_, float f_)
+        : a(a_), b(b_), c(c_), d(d_), e(e_), f(f_)
+    {}
+
+    glm::vec2 Apply(const glm::vec2 &p) const
+    {
+        return glm::vec2(a*p.x + c*p.y + e, b*p.x + d*p.y + f);
+    }
+
+    // this transform applied after other
+    SvgTransform operator*(const SvgTransform &other) const;
+};
+
+// parses a transform attribute value (a list of matrix, translate, scale,
+// rotate, skewX and skewY); returns false and the transforms read so far
+// if it is malformed
+bool ParseSvgTransform(const char *begin, const char *end, SvgTransform *transform);
+
+// parses path data, sending its segments through transform to sink;
+// returns false if it stops at a syntax error (the geometry before the error
+// is kept, as SVG renderers do)
+bool ParseSvgPathData(const char *begin, const char *end, const SvgTransform &transform,
+                      SvgPathSink *sink, size_t *segments = 0);
+
+// imports every path of a document held in memory, placing the document
+// with root; paths are parsed on up to workers threads, 0 meaning one per
+// core, but the sink is only called from this one, in document order
+void ImportSvg(const char *begin, const char *end, SvgPathSink *sink, SvgImportStats *stats = 0,
+               const SvgTransform &root = SvgTransform(), int workers = 0);
+
+// memory maps and imports a file; returns false if it cannot be read
+bool ImportSvgFile(const std::string &filename, SvgPathSink *sink, SvgImportStats *stats = 0);
+
+// converts the paths of an SVG file into a binary scene file, one shape per
+// path, scaled to fit the [-0.9,0.9] square with y pointing up
+bool ConvertSvgToScene(const std::string &svgFile, const std::string &sceneFile);
+
+// generates a large map-like SVG in memory and reports the import rate on
+// one thread and, where there are more cores, on all of them
+void BenchmarkSvgImport(size_t megabytes = 256, int trials = 3);
+
+// --------------------------------------------------------------------------
+#endif // SVGIMPORT_H
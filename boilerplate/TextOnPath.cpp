@@ -0,0 +1,229 @@
+// ==========================================================================
+// Text on a Path
+//
+// This module lays a string along an arbitrary Bezier spline. The spline's
+// arc length table lives in a texture buffer and glyphs are placed on the
+// GPU, so animating the text along the curve is one uniform per frame.
+// ==========================================================================
+
+#include "TextOnPath.h"
+#include "Bezier.h"
+#include "GLState.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+using namespace glm;
+
+// quadrature intervals per segment; 8 x 5 point Gauss-Legendre measures
+// font and mug curves to well below a pixel
+static const int INTERVALS = 8;
+
+// Newton steps when inverting arc length within one interval
+static const int INVERSION_ITERATIONS = 4;
+
+// --------------------------------------------------------------------------
+// ArcLengthTable
+
+void ArcLengthTable::Build(const vector<MySegment> &spline, int samples)
+{
+    m_spline = spline;
+    m_cumulative.assign(1, 0.0f);
+    for (size_t i = 0; i < m_spline.size(); ++i)
+        for (int k = 0; k < INTERVALS; ++k)
+        {
+            float t0 = float(k) / INTERVALS;
+            float t1 = float(k + 1) / INTERVALS;
+            m_cumulative.push_back(m_cumulative.back() + SegmentArcLength(m_spline[i], t0, t1));
+        }
+
+    m_frames.resize(std::max(samples, 2));
+    for (size_t i = 0; i < m_frames.size(); ++i)
+        m_frames[i] = FrameAt(Length() * i / (m_frames.size() - 1));
+}
+
+bool ArcLengthTable::Matches(const vector<MySegment> &spline) const
+{
+    if (spline.size() != m_spline.size()) return false;
+    for (size_t i = 0; i < spline.size(); ++i)
+    {
+        if (spline[i].degree != m_spline[i].degree) return false;
+        for (unsigned int k = 0; k <= spline[i].degree; ++k)
+            if (spline[i].x[k] != m_spline[i].x[k] || spline[i].y[k] != m_spline[i].y[k])
+                return false;
+    }
+    return true;
+}
+
+float ArcLengthTable::ParameterAt(float s) const
+{
+    if (m_spline.empty()) return 0;
+    s = clamp(s, 0.0f, Length());
+
+    // find the quadrature interval containing s
+    size_t k = upper_bound(m_cumulative.begin(), m_cumulative.end(), s) - m_cumulative.begin();
+    k = std::min(std::max(k, size_t(1)), m_cumulative.size() - 1) - 1;
+
+    const MySegment &segment = m_spline[k / INTERVALS];
+    float t0 = float(k % INTERVALS) / INTERVALS;
+    float t1 = t0 + 1.0f / INTERVALS;
+    float target = s - m_cumulative[k];
+    float span = m_cumulative[k + 1] - m_cumulative[k];
+
+    // start from linear interpolation, then Newton on length(t0, t) - target
+    float t = span > 0 ? t0 + (t1 - t0) * target / span : t0;
+    for (int i = 0; i < INVERSION_ITERATIONS; ++i)
+    {
+        float speed = length(EvaluateDerivative(segment, t));
+        if (speed < 1e-8f) break;
+        t = clamp(t - (SegmentArcLength(segment, t0, t) - target) / speed, t0, t1);
+    }
+
+    return float(k / INTERVALS) + t;
+}
+
+vec4 ArcLengthTable::FrameAt(float s) const
+{
+    if (m_spline.empty()) return vec4(0, 0, 1, 0);
+
+    float u = ParameterAt(s);
+    int index = std::min(int(u), int(m_spline.size()) - 1);
+    float t = u - index;
+    const MySegment &segment = m_spline[index];
+
+    vec2 position = EvaluateSegment(segment, t);
+    vec2 tangent = EvaluateDerivative(segment, t);
+
+    // degenerate controls give a zero derivative at the ends; look just inside
+    if (length(tangent) < 1e-8f)
+        tangent = EvaluateSegment(segment, clamp(t + 1e-3f, 0.0f, 1.0f))
+                - EvaluateSegment(segment, clamp(t - 1e-3f, 0.0f, 1.0f));
+    if (length(tangent) > 0) tangent = normalize(tangent);
+    else tangent = vec2(1, 0);
+
+    return vec4(position, tangent);
+}
+
+// --------------------------------------------------------------------------
+// PathText
+
+PathText::PathText()
+    : m_tableBuffer(0), m_tableTexture(0), m_vertexBuffer(0), m_centreBuffer(0),
+      m_vertexArray(0), m_vertexCount(0), m_textLength(0)
+{}
+
+bool PathText::Initialize()
+{
+    const GLuint VERTEX_INDEX = 0;
+    const GLuint CENTRE_INDEX = 2;
+
+    glGenBuffers(1, &m_tableBuffer);
+    glGenTextures(1, &m_tableTexture);
+    glGenBuffers(1, &m_vertexBuffer);
+    glGenBuffers(1, &m_centreBuffer);
+
+    glGenVertexArrays(1, &m_vertexArray);
+    BindVertexArray(m_vertexArray);
+
+    BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glVertexAttribPointer(VERTEX_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+    glEnableVertexAttribArray(VERTEX_INDEX);
+
+    BindBuffer(GL_ARRAY_BUFFER, m_centreBuffer);
+    glVertexAttribPointer(CENTRE_INDEX, 1, GL_FLOAT, GL_FALSE, sizeof(float), 0);
+    glEnableVertexAttribArray(CENTRE_INDEX);
+
+    BindBuffer(GL_ARRAY_BUFFER, 0);
+    BindVertexArray(0);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void PathText::Destroy()
+{
+    DeleteVertexArrays(1, &m_vertexArray);
+    for (GLuint buffer : {m_tableBuffer, m_vertexBuffer, m_centreBuffer})
+        ForgetGpuBuffer(buffer);
+    DeleteTextures(1, &m_tableTexture);
+    DeleteBuffers(1, &m_tableBuffer);
+    DeleteBuffers(1, &m_vertexBuffer);
+    DeleteBuffers(1, &m_centreBuffer);
+    m_vertexArray = m_tableTexture = m_tableBuffer = m_vertexBuffer = m_centreBuffer = 0;
+}
+
+void PathText::SetPath(const vector<MySegment> &spline)
+{
+    if (!m_table.Frames().empty() && m_table.Matches(spline)) return;
+
+    m_table.Build(spline);
+    const CountedVector<vec4, MEMORY_LAYOUT> &frames = m_table.Frames();
+
+    BindBuffer(GL_TEXTURE_BUFFER, m_tableBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(vec4) * frames.size(), frames.data(), GL_STATIC_DRAW);
+    CountGpuBuffer(MEMORY_LAYOUT, m_tableBuffer, sizeof(vec4) * frames.size());
+    BindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    BindTexture(GL_TEXTURE_BUFFER, m_tableTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_tableBuffer);
+    BindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void PathText::SetText(const string &text, const FontSet &fonts, float size, float lift)
+{
+    vector<vec2> vertices;
+    vector<float> centres;
+    float pen = 0;
+
+    vector<unsigned int> codepoints = DecodeUtf8(text);
+    for (size_t i = 0; i < codepoints.size(); ++i)
+    {
+        MyGlyph glyph = fonts.ExtractGlyph(codepoints[i]);
+        float half = 0.5f * glyph.advance;
+
+        // glyph-local coordinates are relative to the centre of the glyph's
+        // advance, sitting lift EMs above the curve
+        size_t first = vertices.size();
+        for (size_t c = 0; c < glyph.contours.size(); ++c)
+            for (size_t s = 0; s < glyph.contours[c].size(); ++s)
+                AppendCubicPatch(glyph.contours[c][s], &vertices, vec2(-half, lift));
+
+        for (size_t v = first; v < vertices.size(); ++v) {
+            vertices[v] *= size;
+            centres.push_back((pen + half) * size);
+        }
+        pen += glyph.advance;
+    }
+
+    m_vertexCount = vertices.size();
+    m_textLength = pen * size;
+
+    BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    BindBuffer(GL_ARRAY_BUFFER, m_centreBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * centres.size(), centres.data(), GL_STATIC_DRAW);
+    CountGpuBuffer(MEMORY_LAYOUT, m_vertexBuffer, sizeof(vec2) * vertices.size());
+    CountGpuBuffer(MEMORY_LAYOUT, m_centreBuffer, sizeof(float) * centres.size());
+    BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void PathText::Render(GLuint program, float shift, const mat4 &model) const
+{
+    if (m_vertexCount == 0 || m_table.Length() <= 0) return;
+
+    UseProgram(program);
+    glUniform1i(UniformLocation(program, "arcTable"), 0);
+    glUniform1f(UniformLocation(program, "pathLength"), m_table.Length());
+    glUniform1f(UniformLocation(program, "shift"), shift);
+    glUniformMatrix4fv(UniformLocation(program, "model"), 1, GL_FALSE, value_ptr(model));
+
+    ActiveTexture(GL_TEXTURE0);
+    BindTexture(GL_TEXTURE_BUFFER, m_tableTexture);
+
+    BindVertexArray(m_vertexArray);
+    SetPatchVertices(4);
+    glVertexAttrib3f(1, 1.0f, 0.8f, 0.2f);
+    glDrawArrays(GL_PATCHES, 0, m_vertexCount);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,96 @@
+// ==========================================================================
+// Text on a Path
+//
+// This module lays a string along an arbitrary Bezier spline:
+//  - ArcLengthTable measures the spline with Gauss-Legendre quadrature and
+//    inverts arc length to curve parameter, producing the curve frame
+//    (position and unit tangent) at evenly spaced arc lengths
+//  - PathText stores that table in a texture buffer and the string's glyph
+//    patches in glyph-local coordinates, each vertex tagged with the arc
+//    length of its glyph's centre
+//
+// shaders/pathVertex.glsl looks up the frame for every vertex and places and
+// rotates the glyph there, so sliding the text along the curve is a single
+// "shift" uniform per frame. Tables are only rebuilt when the spline changes.
+// ==========================================================================
+#ifndef TEXTONPATH_H
+#define TEXTONPATH_H
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "FontSet.h"
+
+// --------------------------------------------------------------------------
+// Arc length parameterisation of a spline
+
+class ArcLengthTable
+{
+    std::vector<MySegment> m_spline;
+
+    // cumulative arc length at the start of each quadrature interval; every
+    // segment is split into INTERVALS equal parameter ranges
+    CountedVector<float, MEMORY_LAYOUT> m_cumulative;
+
+    // frames (x, y, tangent x, tangent y) at arc lengths i * Length() / (n-1)
+    CountedVector<glm::vec4, MEMORY_LAYOUT> m_frames;
+
+public:
+    // measures the spline and samples it at the given number of arc lengths
+    void Build(const std::vector<MySegment> &spline, int samples = 1024);
+
+    // true if Build() was last called with an identical spline
+    bool Matches(const std::vector<MySegment> &spline) const;
+
+    float Length() const { return m_cumulative.empty() ? 0.0f : m_cumulative.back(); }
+
+    // spline parameter (segment index + t) at arc length s from the start
+    float ParameterAt(float s) const;
+
+    // position and unit tangent at arc length s
+    glm::vec4 FrameAt(float s) const;
+
+    const CountedVector<glm::vec4, MEMORY_LAYOUT> &Frames() const { return m_frames; }
+};
+
+// --------------------------------------------------------------------------
+// GPU resources for one string on one path
+
+class PathText
+{
+    ArcLengthTable m_table;
+
+    GLuint m_tableBuffer;       // frames, read through a texture buffer
+    GLuint m_tableTexture;
+    GLuint m_vertexBuffer;      // glyph-local patch vertices
+    GLuint m_centreBuffer;      // arc length of each vertex's glyph centre
+    GLuint m_vertexArray;
+    GLsizei m_vertexCount;
+    float m_textLength;
+
+public:
+    PathText();
+
+    bool Initialize();
+    void Destroy();
+
+    // rebuilds and uploads the arc length table, unless the spline is unchanged
+    void SetPath(const std::vector<MySegment> &spline);
+
+    // lays out UTF-8 text with the given fonts at size world units per EM,
+    // raised by lift EMs off the curve
+    void SetText(const std::string &text, const FontSet &fonts, float size, float lift = 0.2f);
+
+    // draws with a program built from pathVertex.glsl; shift is the arc length
+    // the text has slid along the path, model places the path in the world
+    void Render(GLuint program, float shift, const glm::mat4 &model) const;
+
+    float PathLength() const { return m_table.Length(); }
+    float TextLength() const { return m_textLength; }
+};
+
+// --------------------------------------------------------------------------
+#endif // TEXTONPATH_H
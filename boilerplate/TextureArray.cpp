@@ -0,0 +1,253 @@
+// ==========================================================================
+// Texture Arrays and Sprites
+//
+// One layer per image keeps packing trivial and slots stable; images of
+// similar sizes (sprites, icons) waste little in padding.
+// ==========================================================================
+
+#include "TextureArray.h"
+#include "GLState.h"
+
+#include <stb/stb_image.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include <glm/gtc/type_ptr.hpp>
+
+using namespace std;
+using namespace glm;
+
+// the texture unit sprites sample their array from
+static const GLuint SPRITE_TEXTURE_UNIT = 3;
+
+// glCopyImageSubData is OpenGL 4.3, past the 4.0 functions glad was generated
+// with, so it is looked up when the driver has it
+typedef void (*CopyImageSubDataFunction)(GLuint, GLenum, GLint, GLint, GLint, GLint, GLuint, GLenum, GLint,
+                                         GLint, GLint, GLint, GLsizei, GLsizei, GLsizei);
+
+static CopyImageSubDataFunction CopyImageSubData()
+{
+    static bool looked = false;
+    static CopyImageSubDataFunction function = 0;
+    if (!looked) {
+        looked = true;
+        if (glfwExtensionSupported("GL_ARB_copy_image"))
+            function = (CopyImageSubDataFunction)glfwGetProcAddress("glCopyImageSubData");
+    }
+    return function;
+}
+
+// --------------------------------------------------------------------------
+
+TextureArray::TextureArray()
+    : m_texture(0), m_width(0), m_height(0), m_layers(0), m_capacity(0), m_growCount(0),
+      m_mipmaps(false), m_mipmapsDirty(false)
+{}
+
+static GLuint CreateArray(int width, int height, int layers, bool mipmaps)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
+
+bool TextureArray::Initialize(int layerWidth, int layerHeight, int capacity, bool mipmaps)
+{
+    m_width = layerWidth;
+    m_height = layerHeight;
+    m_capacity = std::max(capacity, 1);
+    m_layers = 0;
+    m_growCount = 0;
+    m_mipmaps = mipmaps;
+    m_mipmapsDirty = false;
+    m_texture = CreateArray(m_width, m_height, m_capacity, m_mipmaps);
+    CountGpuTexture(MEMORY_TEXTURES, m_texture, TextureBytes(m_width, m_height, m_capacity, 4, m_mipmaps));
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void TextureArray::Destroy()
+{
+    ForgetGpuTexture(m_texture);
+    DeleteTextures(1, &m_texture);
+    m_texture = 0;
+    m_layers = m_capacity = 0;
+}
+
+// twice the layers; level 0 of the old ones is copied, mipmaps are rebuilt at the next bind
+bool TextureArray::Grow()
+{
+    GLuint grown = CreateArray(m_width, m_height, 2 * m_capacity, m_mipmaps);
+
+    if (CopyImageSubDataFunction copy = CopyImageSubData()) {
+        copy(m_texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, grown, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+             m_width, m_height, m_layers);
+    } else {
+        GLuint framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        BindTexture(GL_TEXTURE_2D_ARRAY, grown);
+        for (int layer = 0; layer < m_layers; ++layer) {
+            glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_texture, 0, layer);
+            glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0, m_width, m_height);
+        }
+        BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+
+    ForgetGpuTexture(m_texture);
+    DeleteTextures(1, &m_texture);
+    m_texture = grown;
+    m_capacity *= 2;
+    CountGpuTexture(MEMORY_TEXTURES, m_texture, TextureBytes(m_width, m_height, m_capacity, 4, m_mipmaps));
+    m_growCount++;
+    m_mipmapsDirty = m_mipmaps;
+    return glGetError() == GL_NO_ERROR;
+}
+
+bool TextureArray::Add(const unsigned char *rgba, int width, int height, TextureArraySlot *slot)
+{
+    if (width > m_width || height > m_height || width <= 0 || height <= 0) {
+        cout << "TextureArray ERROR: a " << width << "x" << height << " image does not fit "
+             << m_width << "x" << m_height << " layers" << endl;
+        return false;
+    }
+    if (m_layers == m_capacity && !Grow()) return false;
+
+    // the padding repeats the edge, so filtering at the rectangle's border never
+    // blends in texels from outside the image
+    CountedVector<unsigned char, MEMORY_TEXTURES> layer(4 * size_t(m_width) * m_height);
+    for (int y = 0; y < m_height; ++y)
+        for (int x = 0; x < m_width; ++x)
+            memcpy(&layer[4 * (size_t(y) * m_width + x)],
+                   &rgba[4 * (size_t(std::min(y, height - 1)) * width + std::min(x, width - 1))], 4);
+
+    BindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, m_layers, m_width, m_height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                    layer.data());
+    BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    slot->layer = m_layers++;
+    slot->rect = vec4(0.0f, 0.0f, float(width) / m_width, float(height) / m_height);
+    m_mipmapsDirty = m_mipmaps;
+    return glGetError() == GL_NO_ERROR;
+}
+
+bool TextureArray::AddFile(const string &filename, TextureArraySlot *slot)
+{
+    int width, height, components;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char *pixels = stbi_load(filename.c_str(), &width, &height, &components, 4);
+    if (!pixels) {
+        cout << "TextureArray ERROR: could not decode " << filename << endl;
+        return false;
+    }
+    bool added = Add(pixels, width, height, slot);
+    stbi_image_free(pixels);
+    return added;
+}
+
+void TextureArray::Bind(GLuint unit)
+{
+    ActiveTexture(GL_TEXTURE0 + unit);
+    BindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    if (m_mipmapsDirty) {
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        m_mipmapsDirty = false;
+    }
+    ActiveTexture(GL_TEXTURE0);
+}
+
+// --------------------------------------------------------------------------
+
+SpriteBatch::SpriteBatch() : m_vertexArray(0), m_instanceBuffer(0), m_dirty(false)
+{}
+
+bool SpriteBatch::Initialize()
+{
+    // per instance attributes only; the four corners come from gl_VertexID
+    const GLuint CENTRE_INDEX = 0, SIZE_INDEX = 1, RECT_INDEX = 2, LAYER_INDEX = 3;
+    const GLsizei STRIDE = sizeof(SpriteInstance);
+
+    glGenBuffers(1, &m_instanceBuffer);
+    glGenVertexArrays(1, &m_vertexArray);
+    BindVertexArray(m_vertexArray);
+    BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+
+    glVertexAttribPointer(CENTRE_INDEX, 2, GL_FLOAT, GL_FALSE, STRIDE, (void*)offsetof(SpriteInstance, centre));
+    glVertexAttribPointer(SIZE_INDEX, 2, GL_FLOAT, GL_FALSE, STRIDE, (void*)offsetof(SpriteInstance, size));
+    glVertexAttribPointer(RECT_INDEX, 4, GL_FLOAT, GL_FALSE, STRIDE, (void*)offsetof(SpriteInstance, rect));
+    glVertexAttribPointer(LAYER_INDEX, 1, GL_FLOAT, GL_FALSE, STRIDE, (void*)offsetof(SpriteInstance, layer));
+    for (GLuint index = CENTRE_INDEX; index <= LAYER_INDEX; ++index) {
+        glVertexAttribDivisor(index, 1);
+        glEnableVertexAttribArray(index);
+    }
+
+    BindBuffer(GL_ARRAY_BUFFER, 0);
+    BindVertexArray(0);
+    return glGetError() == GL_NO_ERROR;
+}
+
+void SpriteBatch::Destroy()
+{
+    DeleteVertexArrays(1, &m_vertexArray);
+    ForgetGpuBuffer(m_instanceBuffer);
+    DeleteBuffers(1, &m_instanceBuffer);
+    m_vertexArray = m_instanceBuffer = 0;
+}
+
+void SpriteBatch::Clear()
+{
+    m_sprites.clear();
+    m_dirty = true;
+}
+
+void SpriteBatch::Add(const TextureArraySlot &slot, const vec2 &centre, const vec2 &size)
+{
+    SpriteInstance sprite;
+    sprite.centre = centre;
+    sprite.size = size;
+    sprite.rect = slot.rect;
+    sprite.layer = float(slot.layer);
+    m_sprites.push_back(sprite);
+    m_dirty = true;
+}
+
+void SpriteBatch::Render(GLuint program, TextureArray *array, const mat4 &model)
+{
+    if (m_dirty) {
+        BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(SpriteInstance) * m_sprites.size(), m_sprites.data(), GL_STATIC_DRAW);
+        CountGpuBuffer(MEMORY_SCENES, m_instanceBuffer, sizeof(SpriteInstance) * m_sprites.size());
+        BindBuffer(GL_ARRAY_BUFFER, 0);
+        m_dirty = false;
+    }
+    if (m_sprites.empty()) return;
+
+    array->Bind(SPRITE_TEXTURE_UNIT);
+    UseProgram(program);
+    glUniform1i(UniformLocation(program, "sprites"), SPRITE_TEXTURE_UNIT);
+    glUniformMatrix4fv(UniformLocation(program, "model"), 1, GL_FALSE, value_ptr(model));
+
+    // sprites overlap, and their padding and corners are transparent
+    SetBlend(true);
+    SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    BindVertexArray(m_vertexArray);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(m_sprites.size()));
+    SetBlend(false);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,108 @@
+// ==========================================================================
+// Texture Arrays and Sprites
+//
+// This module packs many images into one GL_TEXTURE_2D_ARRAY, so elements
+// drawn with different images need no texture binds in between:
+//  - TextureArray puts each image in a layer of its own, padded to the
+//    layer size by repeating its last row and column, and returns where it
+//    went: the layer and the rectangle of texture coordinates it covers
+//  - when the layers run out it reallocates with twice as many and copies
+//    the old ones on the GPU, with glCopyImageSubData where the driver has
+//    it (OpenGL 4.3) and a framebuffer read per layer otherwise
+//  - SpriteBatch draws any number of sprites from one array in a single
+//    instanced call, each instance choosing its own layer
+//
+// Slots stay valid when the array grows; only the texture name changes, so
+// draw code asks the array for it every time (Bind()).
+// ==========================================================================
+#ifndef TEXTUREARRAY_H
+#define TEXTUREARRAY_H
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "MemoryAccount.h"
+
+// --------------------------------------------------------------------------
+
+struct TextureArraySlot
+{
+    int layer;
+    glm::vec4 rect;     // texture coordinates covered: u0, v0, u1, v1
+};
+
+class TextureArray
+{
+    GLuint m_texture;
+    int m_width, m_height;
+    int m_layers, m_capacity;
+    int m_growCount;
+    bool m_mipmaps;
+    bool m_mipmapsDirty;
+
+    bool Grow();
+
+public:
+    TextureArray();
+
+    // allocates capacity layers of layerWidth x layerHeight 8 bit RGBA
+    bool Initialize(int layerWidth, int layerHeight, int capacity = 16, bool mipmaps = true);
+
+    void Destroy();
+
+    // copies an 8 bit RGBA image, bottom row first, into the next layer;
+    // returns false if it is larger than a layer
+    bool Add(const unsigned char *rgba, int width, int height, TextureArraySlot *slot);
+
+    // the same for any image file stb_image reads
+    bool AddFile(const std::string &filename, TextureArraySlot *slot);
+
+    // binds the array to a texture unit, first generating the mipmaps of
+    // layers added since the last bind
+    void Bind(GLuint unit);
+
+    int LayerCount() const { return m_layers; }
+    int Capacity() const { return m_capacity; }
+    int GrowCount() const { return m_growCount; }
+};
+
+// --------------------------------------------------------------------------
+
+struct SpriteInstance
+{
+    glm::vec2 centre;
+    glm::vec2 size;
+    glm::vec4 rect;
+    float layer;
+};
+
+class SpriteBatch
+{
+    GLuint m_vertexArray;
+    GLuint m_instanceBuffer;
+
+    CountedVector<SpriteInstance, MEMORY_SCENES> m_sprites;
+    bool m_dirty;   // sprites changed since the last upload
+
+public:
+    SpriteBatch();
+
+    bool Initialize();
+    void Destroy();
+
+    void Clear();
+
+    // a sprite showing the image in slot, centred and sized in world units
+    void Add(const TextureArraySlot &slot, const glm::vec2 &centre, const glm::vec2 &size);
+    size_t Count() const { return m_sprites.size(); }
+
+    // draws every sprite with one glDrawArraysInstanced call, uploading the
+    // instances first if they changed
+    void Render(GLuint program, TextureArray *array, const glm::mat4 &model);
+};
+
+// --------------------------------------------------------------------------
+#endif // TEXTUREARRAY_H
@@ -0,0 +1,481 @@
+// ==========================================================================
+// Asynchronous Texture Loading
+//
+// Workers only decode; uploads are sliced into bands of whole rows so a
+// large image is spread over as many frames as the byte budget needs.
+// Compressed files go level by level, in bands of whole rows of blocks.
+// ==========================================================================
+
+#include "TextureLoader.h"
+#include "GLState.h"
+#include "MemoryAccount.h"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+static GLenum PixelFormat(int components)
+{
+    switch (components) {
+    case 1: return GL_RED;
+    case 2: return GL_RG;
+    case 3: return GL_RGB;
+    default: return GL_RGBA;
+    }
+}
+
+static GLint InternalFormat(int components)
+{
+    switch (components) {
+    case 1: return GL_R8;
+    case 2: return GL_RG8;
+    case 3: return GL_RGB8;
+    default: return GL_RGBA8;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+TextureLoader::TextureLoader() : m_stop(true), m_nextBuffer(0), m_bytesPerFrame(0)
+{
+    for (int i = 0; i < RING_SIZE; ++i) {
+        m_buffers[i] = 0;
+        m_fences[i] = 0;
+    }
+}
+
+TextureLoader::~TextureLoader()
+{
+    Stop();
+}
+
+bool TextureLoader::Initialize(int workers, size_t bytesPerFrame)
+{
+    // set before any worker runs: stb_image keeps the flag in a global
+    stbi_set_flip_vertically_on_load(true);
+
+    m_bytesPerFrame = bytesPerFrame;
+    glGenBuffers(RING_SIZE, m_buffers);
+    for (int i = 0; i < RING_SIZE; ++i) {
+        BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, m_bytesPerFrame, 0, GL_STREAM_DRAW);
+        CountGpuBuffer(MEMORY_TEXTURES, m_buffers[i], m_bytesPerFrame);
+    }
+    BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    Stop();
+    m_stop = false;
+    for (int i = 0; i < workers; ++i)
+        m_workers.push_back(thread(&TextureLoader::Decode, this));
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void TextureLoader::Stop()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+        m_requests.clear();
+    }
+    m_wake.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+        m_workers[i].join();
+    m_workers.clear();
+
+    for (size_t i = 0; i < m_finished.size(); ++i)
+        FreePixels(&m_finished[i]);
+    m_finished.clear();
+
+    // their requests were dropped above, so nothing would ever finish them
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        if (m_entries[i].state == TEXTURE_DECODING)
+            m_entries[i].state = TEXTURE_FAILED;
+}
+
+void TextureLoader::Destroy()
+{
+    Stop();
+
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        Release(TextureHandle(i));
+    m_entries.clear();
+    m_uploads.clear();
+
+    for (int i = 0; i < RING_SIZE; ++i) {
+        if (m_fences[i]) glDeleteSync(m_fences[i]);
+        m_fences[i] = 0;
+    }
+    for (int i = 0; i < RING_SIZE; ++i)
+        ForgetGpuBuffer(m_buffers[i]);
+    DeleteBuffers(RING_SIZE, m_buffers);
+    for (int i = 0; i < RING_SIZE; ++i)
+        m_buffers[i] = 0;
+}
+
+// --------------------------------------------------------------------------
+// Decoding
+
+TextureHandle TextureLoader::Load(const string &filename, bool mipmaps, GLenum target)
+{
+    TextureHandle handle = TextureHandle(m_entries.size());
+
+    Entry entry;
+    entry.texture.target = target;
+    entry.state = TEXTURE_DECODING;
+    entry.mipmaps = mipmaps && target != GL_TEXTURE_RECTANGLE;
+    entry.filename = filename;
+    entry.image.pixels = 0;
+    entry.image.compressed = 0;
+    entry.level = 0;
+    entry.rowsUploaded = 0;
+    entry.uploadFrames = 0;
+    m_entries.push_back(entry);
+
+    bool running;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        running = !m_stop;
+        if (running) m_requests.push_back(make_pair(handle, filename));
+    }
+    if (!running) {
+        cout << "TextureLoader ERROR: not initialized, cannot load " << filename << endl;
+        m_entries[handle].state = TEXTURE_FAILED;
+        return handle;
+    }
+    m_wake.notify_one();
+    return handle;
+}
+
+void TextureLoader::Decode()
+{
+    unique_lock<mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_stop || !m_requests.empty(); });
+        if (m_stop) return;
+
+        pair<TextureHandle, string> request = m_requests.front();
+        m_requests.pop_front();
+        lock.unlock();
+
+        // decoded without the lock, so the other workers and the GL thread carry on
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        DecodedImage image;
+        image.handle = request.first;
+        image.pixels = 0;
+        image.compressed = 0;
+        if (IsCompressedTextureFile(request.second)) {
+            CompressedImage *compressed = new CompressedImage;
+            if (LoadCompressedImage(request.second, compressed)) {
+                image.compressed = compressed;
+                image.width = compressed->levels[0].width;
+                image.height = compressed->levels[0].height;
+                image.components = 0;
+                CountCpuBytes(MEMORY_TEXTURES, compressed->Bytes());
+            }
+            else delete compressed;
+        }
+        else {
+            image.pixels = stbi_load(request.second.c_str(), &image.width, &image.height, &image.components, 0);
+            if (image.pixels)
+                CountCpuBytes(MEMORY_TEXTURES, (long long)image.width * image.height * image.components);
+        }
+        image.decodeSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+        lock.lock();
+        m_finished.push_back(image);
+        m_decoded.notify_all();
+    }
+}
+
+void TextureLoader::TakeDecoded()
+{
+    vector<DecodedImage> finished;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        finished.swap(m_finished);
+    }
+
+    for (size_t i = 0; i < finished.size(); ++i)
+    {
+        DecodedImage &image = finished[i];
+        Entry &entry = m_entries[image.handle];
+
+        // released while it was decoding
+        if (entry.state != TEXTURE_DECODING) {
+            FreePixels(&image);
+            continue;
+        }
+        if (!image.pixels && !image.compressed) {
+            cout << "TextureLoader ERROR: could not decode " << entry.filename << endl;
+            entry.state = TEXTURE_FAILED;
+            continue;
+        }
+        if (image.compressed && entry.texture.target != GL_TEXTURE_2D) {
+            cout << "TextureLoader ERROR: compressed textures must be GL_TEXTURE_2D: " << entry.filename << endl;
+            FreePixels(&image);
+            entry.state = TEXTURE_FAILED;
+            continue;
+        }
+        if (image.compressed && !BlockFormatSupported(image.compressed->format)) {
+            cout << "TextureLoader ERROR: " << BlockFormatName(image.compressed->format)
+                 << " textures are not supported here, cannot load " << entry.filename << endl;
+            FreePixels(&image);
+            entry.state = TEXTURE_FAILED;
+            continue;
+        }
+        if (RowBytes(image, 0) > m_bytesPerFrame) {
+            cout << "TextureLoader ERROR: a row of " << entry.filename << " is over the upload budget" << endl;
+            FreePixels(&image);
+            entry.state = TEXTURE_FAILED;
+            continue;
+        }
+
+        // a compressed file brings its mip chain, or goes without
+        if (image.compressed) entry.mipmaps = image.compressed->levels.size() > 1;
+        entry.image = image;
+        entry.texture.width = image.width;
+        entry.texture.height = image.height;
+        entry.state = TEXTURE_UPLOADING;
+        m_uploads.push_back(image.handle);
+    }
+}
+
+// decoded pixels count as texture memory until they are uploaded or dropped
+void TextureLoader::FreePixels(DecodedImage *image)
+{
+    if (image->pixels)
+        CountCpuBytes(MEMORY_TEXTURES, -(long long)image->width * image->height * image->components);
+    stbi_image_free(image->pixels);
+    image->pixels = 0;
+
+    if (image->compressed)
+        CountCpuBytes(MEMORY_TEXTURES, -(long long)image->compressed->Bytes());
+    delete image->compressed;
+    image->compressed = 0;
+}
+
+int TextureLoader::Levels(const DecodedImage &image)
+{
+    return image.compressed ? int(image.compressed->levels.size()) : 1;
+}
+
+int TextureLoader::Rows(const DecodedImage &image, int level)
+{
+    return image.compressed ? (image.compressed->levels[level].height + 3) / 4 : image.height;
+}
+
+size_t TextureLoader::RowBytes(const DecodedImage &image, int level)
+{
+    if (!image.compressed) return size_t(image.width) * image.components;
+    return size_t(image.compressed->levels[level].width + 3) / 4 * BlockBytes(image.compressed->format);
+}
+
+const unsigned char *TextureLoader::LevelData(const DecodedImage &image, int level)
+{
+    return image.compressed ? image.compressed->levels[level].data.data() : image.pixels;
+}
+
+// --------------------------------------------------------------------------
+// Uploading
+
+// makes the next ring buffer writable; false if the GPU still reads it and
+// block is false
+bool TextureLoader::NextBuffer(bool block)
+{
+    GLsync &fence = m_fences[m_nextBuffer];
+    if (!fence) return true;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    while (block && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    if (status == GL_TIMEOUT_EXPIRED) return false;
+
+    glDeleteSync(fence);
+    fence = 0;
+    return true;
+}
+
+// copies the next rows of an entry's level, at most maxBytes of them but at
+// least one, and returns the bytes copied
+size_t TextureLoader::UploadBand(Entry *entry, size_t maxBytes)
+{
+    const DecodedImage &image = entry->image;
+    size_t rowBytes = RowBytes(image, entry->level);
+    int levelRows = Rows(image, entry->level);
+    int rows = int(std::min<size_t>(levelRows - entry->rowsUploaded, std::max<size_t>(1, maxBytes / rowBytes)));
+    size_t bytes = rows * rowBytes;
+
+    // the fence has passed, so nothing reads the buffer and it needs no synchronisation
+    BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[m_nextBuffer]);
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped) {
+        memcpy(mapped, LevelData(image, entry->level) + entry->rowsUploaded * rowBytes, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        BindTexture(entry->texture.target, entry->texture.textureID);
+        if (image.compressed) {
+            // a band of blocks may end short of 4 texel rows only at the top of the level
+            const CompressedLevel &level = image.compressed->levels[entry->level];
+            int y = entry->rowsUploaded * 4;
+            glCompressedTexSubImage2D(entry->texture.target, entry->level, 0, y, level.width,
+                                      std::min(rows * 4, level.height - y),
+                                      BlockInternalFormat(image.compressed->format), GLsizei(bytes), 0);
+        }
+        else
+            glTexSubImage2D(entry->texture.target, 0, 0, entry->rowsUploaded, image.width, rows,
+                            PixelFormat(image.components), GL_UNSIGNED_BYTE, 0);
+        BindTexture(entry->texture.target, 0);
+        m_fences[m_nextBuffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_nextBuffer = (m_nextBuffer + 1) % RING_SIZE;
+    }
+    BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // a failed map leaves the rows undefined rather than retrying forever
+    entry->rowsUploaded += rows;
+    if (entry->rowsUploaded == levelRows) {
+        entry->level++;
+        entry->rowsUploaded = 0;
+    }
+    return bytes;
+}
+
+void TextureLoader::Upload(size_t budget, bool block)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    TextureHandle touched = NO_TEXTURE;
+    while (!m_uploads.empty())
+    {
+        Entry *entry = &m_entries[m_uploads.front()];
+        if (budget < RowBytes(entry->image, entry->level) || !NextBuffer(block)) break;
+
+        // storage for every row of every level first, with no unpack buffer bound
+        if (!entry->texture.textureID) {
+            const DecodedImage &image = entry->image;
+            glGenTextures(1, &entry->texture.textureID);
+            BindTexture(entry->texture.target, entry->texture.textureID);
+            if (image.compressed) {
+                const CompressedImage &compressed = *image.compressed;
+                for (size_t i = 0; i < compressed.levels.size(); ++i) {
+                    const CompressedLevel &level = compressed.levels[i];
+                    glCompressedTexImage2D(entry->texture.target, GLint(i), BlockInternalFormat(compressed.format),
+                                           level.width, level.height, 0, GLsizei(level.data.size()), 0);
+                }
+                // the chain may stop short of 1x1; sampling must not look past its last level
+                glTexParameteri(entry->texture.target, GL_TEXTURE_MAX_LEVEL, GLint(compressed.levels.size()) - 1);
+                CountGpuTexture(MEMORY_TEXTURES, entry->texture.textureID, compressed.Bytes());
+            }
+            else {
+                glTexImage2D(entry->texture.target, 0, InternalFormat(image.components), image.width, image.height, 0,
+                             PixelFormat(image.components), GL_UNSIGNED_BYTE, 0);
+                CountGpuTexture(MEMORY_TEXTURES, entry->texture.textureID,
+                                TextureBytes(image.width, image.height, 1, image.components, entry->mipmaps));
+            }
+            BindTexture(entry->texture.target, 0);
+        }
+        if (touched != m_uploads.front()) {
+            touched = m_uploads.front();
+            entry->uploadFrames++;
+        }
+
+        budget -= UploadBand(entry, std::min(budget, m_bytesPerFrame));
+
+        if (entry->level == Levels(entry->image)) {
+            Finish(entry);
+            m_uploads.pop_front();
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void TextureLoader::Finish(Entry *entry)
+{
+    MyTexture &texture = entry->texture;
+    BindTexture(texture.target, texture.textureID);
+    if (entry->mipmaps && !entry->image.compressed) glGenerateMipmap(texture.target);
+
+    // Note: GL_TEXTURE_RECTANGLE only supports GL_CLAMP_TO_EDGE and GL_CLAMP_TO_BORDER
+    glTexParameteri(texture.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(texture.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, entry->mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    BindTexture(texture.target, 0);
+
+    FreePixels(&entry->image);
+    entry->state = TEXTURE_READY;
+
+    cout << "texture " << entry->filename << ": " << texture.width << "x" << texture.height
+         << ", decoded in " << entry->image.decodeSeconds * 1e3 << " ms, uploaded over "
+         << entry->uploadFrames << " frames" << endl;
+}
+
+// --------------------------------------------------------------------------
+
+void TextureLoader::Update()
+{
+    TakeDecoded();
+    Upload(m_bytesPerFrame, false);
+}
+
+TextureState TextureLoader::State(TextureHandle handle) const
+{
+    if (handle < 0 || handle >= int(m_entries.size())) return TEXTURE_FAILED;
+    return m_entries[handle].state;
+}
+
+const MyTexture *TextureLoader::Texture(TextureHandle handle) const
+{
+    if (State(handle) != TEXTURE_READY) return 0;
+    return &m_entries[handle].texture;
+}
+
+bool TextureLoader::Wait(TextureHandle handle)
+{
+    if (handle < 0 || handle >= int(m_entries.size())) return false;
+
+    while (true)
+    {
+        TakeDecoded();
+        TextureState state = m_entries[handle].state;
+        if (state == TEXTURE_READY) return true;
+        if (state == TEXTURE_FAILED) return false;
+
+        // uploads go in order, so the ones queued before this handle go too
+        if (state == TEXTURE_UPLOADING) {
+            Upload(size_t(-1), true);
+            continue;
+        }
+
+        unique_lock<mutex> lock(m_mutex);
+        m_decoded.wait(lock, [this]() { return !m_finished.empty(); });
+    }
+}
+
+void TextureLoader::Release(TextureHandle handle)
+{
+    if (handle < 0 || handle >= int(m_entries.size())) return;
+    Entry &entry = m_entries[handle];
+
+    if (entry.state == TEXTURE_UPLOADING) {
+        m_uploads.erase(find(m_uploads.begin(), m_uploads.end(), handle));
+        FreePixels(&entry.image);
+    }
+    if (entry.texture.textureID) DestroyTexture(&entry.texture);
+    entry.texture.textureID = 0;
+
+    // one still decoding is freed by TakeDecoded()
+    entry.state = TEXTURE_FAILED;
+}
+
+// --------------------------------------------------------------------------
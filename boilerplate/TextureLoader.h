@@ -0,0 +1,145 @@
+// ==========================================================================
+// Asynchronous Texture Loading
+//
+// This module loads image files into textures without ever costing a frame
+// more than a set amount of work:
+//  - files are decoded with stb_image on a pool of worker threads; .ktx and
+//    .dds files (see CompressedTexture.h) are read there too, and keep the
+//    blocks and mip chain they hold
+//  - decoded pixels reach the GPU through a ring of pixel unpack buffers, a
+//    band of rows at a time, with no more than a set number of bytes per
+//    frame; a fence per buffer keeps the CPU from writing one the GPU is
+//    still reading from
+//  - mipmaps are generated once the last band is in, if asked for and the
+//    file did not bring its own
+//  - Load() returns a handle at once; scenes poll its state every frame, or
+//    Wait() for it when they cannot draw anything without it
+//
+// Everything but decoding happens on the thread that owns the GL context,
+// in Update(), which is called once per frame.
+// ==========================================================================
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CompressedTexture.h"
+#include "texture.h"
+
+// --------------------------------------------------------------------------
+
+typedef int TextureHandle;
+const TextureHandle NO_TEXTURE = -1;
+
+enum TextureState
+{
+    TEXTURE_DECODING,   // waiting for or on a worker
+    TEXTURE_UPLOADING,  // decoded, bands still to copy
+    TEXTURE_READY,      // complete, with mipmaps if asked for
+    TEXTURE_FAILED      // unreadable file, released, or dropped by Destroy()
+};
+
+class TextureLoader
+{
+    // pixels as stb_image returned them, or the levels of a compressed
+    // file; both bottom row first
+    struct DecodedImage
+    {
+        TextureHandle handle;
+        unsigned char *pixels;
+        CompressedImage *compressed;
+        int width, height, components;
+        double decodeSeconds;
+    };
+
+    struct Entry
+    {
+        MyTexture texture;
+        TextureState state;
+        bool mipmaps;
+        std::string filename;
+
+        DecodedImage image;
+        int level;              // being uploaded
+        int rowsUploaded;       // of that level; rows of blocks when compressed
+        int uploadFrames;
+    };
+
+    // decoding, shared with the workers under m_mutex
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_decoded;
+    std::deque<std::pair<TextureHandle, std::string> > m_requests;
+    std::vector<DecodedImage> m_finished;
+    bool m_stop;
+
+    // uploading, on the GL thread only
+    static const int RING_SIZE = 3;
+    GLuint m_buffers[RING_SIZE];
+    GLsync m_fences[RING_SIZE];
+    int m_nextBuffer;
+    size_t m_bytesPerFrame;
+
+    std::vector<Entry> m_entries;
+    std::deque<TextureHandle> m_uploads;    // decoded, oldest first
+
+    void Stop();
+    void Decode();
+    void TakeDecoded();
+    static void FreePixels(DecodedImage *image);
+    static int Levels(const DecodedImage &image);
+    static int Rows(const DecodedImage &image, int level);
+    static size_t RowBytes(const DecodedImage &image, int level);
+    static const unsigned char *LevelData(const DecodedImage &image, int level);
+    bool NextBuffer(bool block);
+    size_t UploadBand(Entry *entry, size_t maxBytes);
+    void Upload(size_t budget, bool block);
+    void Finish(Entry *entry);
+
+    // not copyable, the workers refer to this object
+    TextureLoader(const TextureLoader &);
+    TextureLoader &operator=(const TextureLoader &);
+
+public:
+    TextureLoader();
+    ~TextureLoader();
+
+    // starts the decoding workers and creates the upload buffers; at most
+    // bytesPerFrame of pixels are copied to textures by each Update()
+    bool Initialize(int workers = 2, size_t bytesPerFrame = 4 << 20);
+
+    // stops the workers and deletes the buffers and every texture loaded
+    void Destroy();
+
+    // queues an image file for loading and returns its handle at once;
+    // mipmaps are ignored for GL_TEXTURE_RECTANGLE, which cannot have them,
+    // and for compressed files, which have their own or none; the handle
+    // fails at once if the loader is not initialized
+    TextureHandle Load(const std::string &filename, bool mipmaps = true, GLenum target = GL_TEXTURE_2D);
+
+    // once per frame: takes decoded images and uploads the next bands
+    void Update();
+
+    TextureState State(TextureHandle handle) const;
+
+    // the texture of a ready handle, or 0
+    const MyTexture *Texture(TextureHandle handle) const;
+
+    // finishes loading a handle now, whatever it costs the frame; returns
+    // false if it failed
+    bool Wait(TextureHandle handle);
+
+    // deletes a texture, or drops it when it has not finished loading
+    void Release(TextureHandle handle);
+};
+
+// --------------------------------------------------------------------------
+#endif // TEXTURELOADER_H
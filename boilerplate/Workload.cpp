@@ -0,0 +1,241 @@
+// ==========================================================================
+// Synthetic Workloads
+//
+// Random patch fields and random text pages for throughput measurements.
+// ==========================================================================
+
+#include "Workload.h"
+#include "Bezier.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace glm;
+
+const WorkloadConfig WORKLOADS[] = {
+    { 1000, 0 }, { 10000, 0 }, { 100000, 0 }, { 1000000, 0 }, { 10000000, 0 },
+    { 0, 1000 }, { 0, 10000 }, { 0, 100000 }
+};
+const int WORKLOAD_COUNT = sizeof(WORKLOADS) / sizeof(WORKLOADS[0]);
+
+// glyph cache slots per font: printable ASCII is all the text uses
+static const int CHARACTERS = 128;
+
+// --------------------------------------------------------------------------
+
+// xorshift, so a seed gives the same scene whatever the C library
+struct WorkloadRandom
+{
+    unsigned int state;
+
+    WorkloadRandom(unsigned int seed) : state(seed ? seed : 1)
+    {}
+
+    unsigned int Next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // uniform in [0,1)
+    float Uniform() { return (Next() >> 8) * (1.0f / 16777216.0f); }
+    float Uniform(float lo, float hi) { return lo + (hi - lo) * Uniform(); }
+    unsigned int Below(unsigned int n) { return Next() % n; }
+};
+
+static string Count(size_t n)
+{
+    ostringstream text;
+    if (n >= 1000000 && n % 1000000 == 0) text << n / 1000000 << "M";
+    else if (n >= 1000 && n % 1000 == 0) text << n / 1000 << "k";
+    else text << n;
+    return text.str();
+}
+
+string WorkloadName(const WorkloadConfig &config)
+{
+    if (config.glyphs > 0) return Count(config.glyphs) + " glyphs";
+    return Count(config.patches) + " patches";
+}
+
+// --------------------------------------------------------------------------
+// Fonts
+
+static bool IsFontFile(const string &name)
+{
+    if (name.size() < 4) return false;
+    string extension = name.substr(name.size() - 4);
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".ttf" || extension == ".otf";
+}
+
+static void ListFontFiles(const string &directory, vector<string> *files)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) return;
+    while (dirent *entry = readdir(dir))
+    {
+        string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+
+        string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) continue;
+        if (S_ISDIR(info.st_mode)) ListFontFiles(path, files);
+        else if (IsFontFile(name)) files->push_back(path);
+    }
+    closedir(dir);
+}
+
+vector<string> FindFontFiles(const string &directory)
+{
+    vector<string> files;
+    ListFontFiles(directory, &files);
+    sort(files.begin(), files.end());
+    return files;
+}
+
+bool WorkloadGenerator::LoadFonts(const string &directory)
+{
+    if (m_fontsLoaded) return true;
+
+    vector<string> files = FindFontFiles(directory);
+    m_fontsLoaded = m_fonts.AddFonts(files);
+    if (!m_fontsLoaded) {
+        cout << "Workload ERROR: no fonts found in " << directory << endl;
+        return false;
+    }
+
+    size_t slots = size_t(m_fonts.FaceCount()) * CHARACTERS;
+    m_glyphPatches.assign(slots, vector<vec2>());
+    m_advances.assign(slots, 0.0f);
+    m_extracted.assign(slots, false);
+    cout << "workload text: " << m_fonts.FaceCount() << " fonts from " << directory << endl;
+    return true;
+}
+
+const vector<vec2> &WorkloadGenerator::GlyphPatches(int face, char character, float *advance)
+{
+    size_t slot = size_t(face) * CHARACTERS + (character & (CHARACTERS - 1));
+    if (!m_extracted[slot]) {
+        MyGlyph glyph = m_fonts.Face(face).ExtractGlyph(character);
+        for (size_t i = 0; i < glyph.contours.size(); ++i)
+            for (size_t j = 0; j < glyph.contours[i].size(); ++j)
+                AppendCubicPatch(glyph.contours[i][j], &m_glyphPatches[slot]);
+        m_advances[slot] = glyph.advance;
+        m_extracted[slot] = true;
+    }
+    *advance = m_advances[slot];
+    return m_glyphPatches[slot];
+}
+
+// --------------------------------------------------------------------------
+// Generation
+
+void WorkloadGenerator::GeneratePatches(size_t count, unsigned int seed, vector<vec2> *vertices) const
+{
+    WorkloadRandom random(seed);
+    vertices->reserve(vertices->size() + 4 * count);
+
+    // patch size shrinks with the count so the field keeps a similar density
+    float size = std::min(0.5f, 4.0f / sqrtf(float(count)));
+    for (size_t i = 0; i < count; ++i)
+    {
+        vec2 centre(random.Uniform(-1.0f, 1.0f), random.Uniform(-1.0f, 1.0f));
+        int corners = i % 2 ? 4 : 3;
+        for (int k = 0; k < corners; ++k)
+            vertices->push_back(centre + size * vec2(random.Uniform(-0.5f, 0.5f), random.Uniform(-0.5f, 0.5f)));
+        if (corners == 3) vertices->push_back(vec2(0.0f));
+    }
+}
+
+size_t WorkloadGenerator::GenerateText(size_t glyphs, unsigned int seed, vector<vec2> *vertices)
+{
+    if (!m_fontsLoaded || glyphs == 0) return 0;
+    WorkloadRandom random(seed);
+
+    // an EM size that fits the page into [-0.95,0.95]: with the spaces and
+    // ragged line ends, glyphs take about 0.53 EMs on lines 1.2 EMs apart
+    const float LEFT = -0.95f, RIGHT = 0.95f, TOP = 0.95f;
+    float em = sqrtf((RIGHT - LEFT) * (RIGHT - LEFT) / (0.53f * 1.2f * float(glyphs)));
+    vec2 pen(LEFT, TOP - em);
+
+    size_t placed = 0;
+    vector<char> word;
+    while (placed < glyphs)
+    {
+        // a random word, capitalised now and then, in a random font
+        word.resize(std::min<size_t>(2 + random.Below(8), glyphs - placed));
+        for (size_t i = 0; i < word.size(); ++i)
+            word[i] = 'a' + random.Below(26);
+        if (random.Below(8) == 0) word[0] += 'A' - 'a';
+        int face = random.Below(m_fonts.FaceCount());
+
+        float width = 0, advance;
+        for (size_t i = 0; i < word.size(); ++i) {
+            GlyphPatches(face, word[i], &advance);
+            width += advance * em;
+        }
+        if (pen.x + width > RIGHT && pen.x > LEFT) pen = vec2(LEFT, pen.y - 1.2f * em);
+
+        for (size_t i = 0; i < word.size(); ++i) {
+            const vector<vec2> &patches = GlyphPatches(face, word[i], &advance);
+            for (size_t k = 0; k < patches.size(); ++k)
+                vertices->push_back(pen + em * patches[k]);
+            pen.x += advance * em;
+        }
+        pen.x += 0.3f * em;
+        placed += word.size();
+    }
+    return placed;
+}
+
+void WorkloadGenerator::Generate(const WorkloadConfig &config, unsigned int seed, Workload *workload)
+{
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+    workload->config = config;
+    workload->vertices.clear();
+    GeneratePatches(config.patches, seed, &workload->vertices);
+    workload->glyphs = GenerateText(config.glyphs, seed, &workload->vertices);
+    workload->patches = workload->vertices.size() / 4;
+
+    workload->generateSeconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------------------------
+
+void WorkloadReport::Print(const Workload &workload) const
+{
+    double megabytes = workload.Bytes() / 1e6;
+    size_t patches = workload.patches;
+
+    cout << "workload " << WorkloadName(workload.config) << ": " << patches << " patches";
+    if (workload.glyphs) cout << " in " << workload.glyphs << " glyphs";
+    cout << ", " << megabytes << " MB" << endl;
+
+    cout << "  generate: " << workload.generateSeconds * 1e3 << " ms";
+    if (workload.generateSeconds > 0) cout << ", " << patches / workload.generateSeconds / 1e6 << " M patches/s";
+    cout << endl;
+
+    cout << "  upload: " << uploadSeconds * 1e3 << " ms";
+    if (uploadSeconds > 0) cout << ", " << megabytes / uploadSeconds << " MB/s";
+    cout << endl;
+
+    if (frames == 0 || frameSeconds <= 0) return;
+    cout << "  frame: " << frameSeconds * 1e3 << " ms (mean of " << frames << "), "
+         << patches / frameSeconds / 1e6 << " M patches/s";
+    if (workload.glyphs) cout << ", " << workload.glyphs / frameSeconds / 1e6 << " M glyphs/s";
+    cout << endl;
+}
+
+// --------------------------------------------------------------------------
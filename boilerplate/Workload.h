@@ -0,0 +1,107 @@
+// ==========================================================================
+// Synthetic Workloads
+//
+// This module generates procedural scenes at production scale, so the
+// pipeline's scaling limits can be found and compared between changes:
+//  - random quadratic and cubic patches, 1 thousand to 10 million, spread
+//    over the [-1,1] square; quadratics use the tessEval.glsl (0,0) marker
+//  - pages of random text set in every font found under a directory, each
+//    word in a randomly chosen font
+//
+// Both are plain 4 vertex patch arrays, drawn with one colour. A workload is
+// a pure function of its configuration and seed (the generator does not use
+// rand()), so the same configuration produces the same scene on every run
+// and platform. WorkloadReport turns upload and frame timings into
+// patches/s, glyphs/s and upload MB/s.
+// ==========================================================================
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FontSet.h"
+
+// --------------------------------------------------------------------------
+
+struct WorkloadConfig
+{
+    size_t patches;     // random patches, half quadratic and half cubic
+    size_t glyphs;      // glyphs of random text
+};
+
+// the configurations cycled through by the workload scene, smallest first
+extern const WorkloadConfig WORKLOADS[];
+extern const int WORKLOAD_COUNT;
+
+// a short description such as "100k patches" or "10k glyphs"
+std::string WorkloadName(const WorkloadConfig &config);
+
+// every .ttf and .otf file (any case) in directory and its subdirectories,
+// sorted by path, so font numbering does not depend on the file system
+std::vector<std::string> FindFontFiles(const std::string &directory);
+
+struct Workload
+{
+    WorkloadConfig config;
+    std::vector<glm::vec2> vertices;    // 4 per patch; may be freed once uploaded
+    size_t patches;                     // patches generated, kept for reports
+    size_t glyphs;                      // glyphs actually placed
+    double generateSeconds;
+
+    Workload() : patches(0), glyphs(0), generateSeconds(0)
+    {
+        config.patches = config.glyphs = 0;
+    }
+
+    size_t Bytes() const { return 4 * patches * sizeof(glm::vec2); }
+};
+
+class WorkloadGenerator
+{
+    FontSet m_fonts;
+    bool m_fontsLoaded;
+
+    // patches of each glyph in the EM box, extracted the first time it is set
+    std::vector<std::vector<glm::vec2> > m_glyphPatches;
+    std::vector<float> m_advances;
+    std::vector<bool> m_extracted;
+
+    const std::vector<glm::vec2> &GlyphPatches(int face, char character, float *advance);
+    void GeneratePatches(size_t count, unsigned int seed, std::vector<glm::vec2> *vertices) const;
+    size_t GenerateText(size_t glyphs, unsigned int seed, std::vector<glm::vec2> *vertices);
+
+public:
+    WorkloadGenerator() : m_fontsLoaded(false)
+    {}
+
+    // loads every .ttf and .otf file in directory and its subdirectories;
+    // returns false if none could be loaded
+    bool LoadFonts(const std::string &directory);
+    int FontCount() const { return m_fonts.FaceCount(); }
+
+    // replaces workload with the scene for config; text needs LoadFonts()
+    void Generate(const WorkloadConfig &config, unsigned int seed, Workload *workload);
+};
+
+// --------------------------------------------------------------------------
+// Measurements
+
+struct WorkloadReport
+{
+    double uploadSeconds;   // glBufferData of the vertices, to glFinish
+    double frameSeconds;    // mean time to draw the workload, to glFinish
+    int frames;             // frames averaged
+
+    WorkloadReport() : uploadSeconds(0), frameSeconds(0), frames(0)
+    {}
+
+    // prints generation, upload and draw rates
+    void Print(const Workload &workload) const;
+};
+
+// --------------------------------------------------------------------------
+#endif // WORKLOAD_H
@@ -16,8 +16,13 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <iterator>
+#include <random>
+#include <thread>
+#include <sys/stat.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -28,6 +33,28 @@
 #include <math.h>
 
 #include "texture.h"
+#include "Camera.h"
+#include "Document.h"
+#include "SegmentBVH.h"
+#include "ControlPointEditor.h"
+#include "Bezier.h"
+#include "BezierBatch.h"
+#include "TextOnPath.h"
+#include "Stroke.h"
+#include "OutlineSimplifier.h"
+#include "FontSet.h"
+#include "SceneFile.h"
+#include "SvgImport.h"
+#include "Workload.h"
+#include "SceneBuilder.h"
+#include "Snapshot.h"
+#include "TextureLoader.h"
+#include "CompressedTexture.h"
+#include "TextureArray.h"
+#include "FrameCapture.h"
+#include "Microbench.h"
+#include "MemoryAccount.h"
+#include "GLState.h"
 
 #include "GlyphExtractor.h"
 
@@ -41,7 +68,7 @@ bool CheckGLErrors();
 
 string LoadSource(const string &filename);
 GLuint CompileShader(GLenum shaderType, const string &source);
-GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader, GLuint tesShader);
+GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader, GLuint tesShader, GLuint gsShader = 0);
 
 // --------------------------------------------------------------------------
 // Functions to set up OpenGL shader programs for rendering
@@ -99,6 +126,109 @@ GLuint InitializeShaders()
         return program;
 }
 
+// load, compile, and link the text-on-path shaders, returning 0 on failure
+GLuint InitializePathShaders()
+{
+	// same tessellation stages as the curves, with glyphs placed along a path first
+	string vertexSource = LoadSource("shaders/pathVertex.glsl");
+	string fragmentSource = LoadSource("shaders/fragment.glsl");
+        string tcsSource = LoadSource("shaders/tessControl.glsl");
+        string tesSource = LoadSource("shaders/tessEval.glsl");
+
+	if (vertexSource.empty() || fragmentSource.empty()) return 0;
+
+	GLuint vertex = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	GLuint tcs = CompileShader(GL_TESS_CONTROL_SHADER, tcsSource);
+	GLuint tes = CompileShader(GL_TESS_EVALUATION_SHADER, tesSource);
+
+	GLuint program = LinkProgram(vertex, fragment, tcs, tes);
+
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+        glDeleteShader(tcs);
+	glDeleteShader(tes);
+
+	if (CheckGLErrors())
+		return 0;
+
+        return program;
+}
+
+// load, compile, and link the thick stroke shaders, returning 0 on failure
+GLuint InitializeStrokeShaders()
+{
+	// the curve tessellation stages, then a geometry stage that widens the isolines
+	string vertexSource = LoadSource("shaders/vertex.glsl");
+	string fragmentSource = LoadSource("shaders/strokeFragment.glsl");
+        string tcsSource = LoadSource("shaders/tessControl.glsl");
+        string tesSource = LoadSource("shaders/tessEval.glsl");
+        string gsSource = LoadSource("shaders/strokeGeometry.glsl");
+
+	if (vertexSource.empty() || fragmentSource.empty() || gsSource.empty()) return 0;
+
+	GLuint vertex = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	GLuint tcs = CompileShader(GL_TESS_CONTROL_SHADER, tcsSource);
+	GLuint tes = CompileShader(GL_TESS_EVALUATION_SHADER, tesSource);
+	GLuint gs = CompileShader(GL_GEOMETRY_SHADER, gsSource);
+
+	GLuint program = LinkProgram(vertex, fragment, tcs, tes, gs);
+
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+        glDeleteShader(tcs);
+	glDeleteShader(tes);
+	glDeleteShader(gs);
+
+	if (CheckGLErrors())
+		return 0;
+
+        return program;
+}
+
+// load, compile, and link the background image shaders, returning 0 on failure
+GLuint InitializeBackgroundShaders()
+{
+	string vertexSource = LoadSource("shaders/backgroundVertex.glsl");
+	string fragmentSource = LoadSource("shaders/backgroundFragment.glsl");
+	if (vertexSource.empty() || fragmentSource.empty()) return 0;
+
+	GLuint vertex = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+	GLuint program = LinkProgram(vertex, fragment, 0, 0);
+
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	if (CheckGLErrors())
+		return 0;
+
+        return program;
+}
+
+// load, compile, and link the instanced sprite shaders, returning 0 on failure
+GLuint InitializeSpriteShaders()
+{
+	string vertexSource = LoadSource("shaders/spriteVertex.glsl");
+	string fragmentSource = LoadSource("shaders/spriteFragment.glsl");
+	if (vertexSource.empty() || fragmentSource.empty()) return 0;
+
+	GLuint vertex = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+	GLuint program = LinkProgram(vertex, fragment, 0, 0);
+
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	if (CheckGLErrors())
+		return 0;
+
+        return program;
+}
+
 // --------------------------------------------------------------------------
 // Functions to set up OpenGL buffers for storing geometry data
 
@@ -111,8 +241,23 @@ struct Geometry
 	GLuint  vertexArray;
 	GLsizei elementCount;
 
+	// texture buffer view of vertexBuffer, read by the stroke geometry stage
+	GLuint  patchTexture;
+
+	// indexed scenes: patch, polygon and point indices into vertexBuffer (see SceneFile.h)
+	GLuint  elementBuffer;
+	GLuint  indexTexture;
+
+	// animated scenes: per vertex motion parameters, uploaded once (see SceneFile.h)
+	GLuint  animationBuffer;
+	GLuint  animationTexture;
+
+	// placement of this object in the world, applied on the GPU
+	mat4 model;
+
 	// initialize object names to zero (OpenGL reserved value)
-	Geometry() : vertexBuffer(0), colourBuffer(0), vertexArray(0), elementCount(0)
+	Geometry() : vertexBuffer(0), colourBuffer(0), vertexArray(0), elementCount(0), patchTexture(0),
+	             elementBuffer(0), indexTexture(0), animationBuffer(0), animationTexture(0), model(1.0f)
 	{}
 };
 
@@ -120,6 +265,7 @@ bool InitializeVAO(Geometry *geometry){
 
 	const GLuint VERTEX_INDEX = 0;
 	const GLuint COLOUR_INDEX = 1;
+	const GLuint ANIMATION_INDEX = 2;
 
 	//Generate Vertex Buffer Objects
 	// create an array buffer object for storing our vertices
@@ -131,10 +277,10 @@ bool InitializeVAO(Geometry *geometry){
 	//Set up Vertex Array Object
 	// create a vertex array object encapsulating all our vertex attributes
 	glGenVertexArrays(1, &geometry->vertexArray);
-	glBindVertexArray(geometry->vertexArray);
+	BindVertexArray(geometry->vertexArray);
 
 	// associate the position array with the vertex array object
-	glBindBuffer(GL_ARRAY_BUFFER, geometry->vertexBuffer);
+	BindBuffer(GL_ARRAY_BUFFER, geometry->vertexBuffer);
 	glVertexAttribPointer(
 		VERTEX_INDEX,		//Attribute index 
 		2, 					//# of components
@@ -145,7 +291,7 @@ bool InitializeVAO(Geometry *geometry){
 	glEnableVertexAttribArray(VERTEX_INDEX);
 
 	// associate the colour array with the vertex array object
-	glBindBuffer(GL_ARRAY_BUFFER, geometry->colourBuffer);
+	BindBuffer(GL_ARRAY_BUFFER, geometry->colourBuffer);
 	glVertexAttribPointer(
 		COLOUR_INDEX,		//Attribute index 
 		3, 					//# of components
@@ -155,41 +301,168 @@ bool InitializeVAO(Geometry *geometry){
 		0);					//Offset to first element
 	glEnableVertexAttribArray(COLOUR_INDEX);
 
+	// animation parameters stay disabled until a scene with them is loaded,
+	// leaving the shaders the default amplitude of 0
+	glGenBuffers(1, &geometry->animationBuffer);
+	BindBuffer(GL_ARRAY_BUFFER, geometry->animationBuffer);
+	glVertexAttribPointer(ANIMATION_INDEX, 4, GL_FLOAT, GL_FALSE, sizeof(vec4), 0);
+
+	// the element buffer binding is part of the vertex array object's state
+	glGenBuffers(1, &geometry->elementBuffer);
+	BindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry->elementBuffer);
+
 	// unbind our buffers, resetting to default state
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	BindBuffer(GL_ARRAY_BUFFER, 0);
+	BindVertexArray(0);
+	BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// thick strokes read neighbouring patches straight out of the vertex buffer
+	geometry->patchTexture = CreatePatchTexture(geometry->vertexBuffer);
+	geometry->indexTexture = CreateIndexTexture(geometry->elementBuffer);
+	geometry->animationTexture = CreateAnimationTexture(geometry->animationBuffer);
 
 	return !CheckGLErrors();
 }
 
 // create buffers and fill with geometry data, returning true if successful
-bool LoadGeometry(Geometry *geometry, vec2 *vertices, vec3 *colours, int elementCount)
+bool LoadGeometry(Geometry *geometry, const vec2 *vertices, const vec3 *colours, int elementCount)
 {
 	geometry->elementCount = elementCount;
 
 	// create an array buffer object for storing our vertices
-	glBindBuffer(GL_ARRAY_BUFFER, geometry->vertexBuffer);
+	BindBuffer(GL_ARRAY_BUFFER, geometry->vertexBuffer);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2)*geometry->elementCount, vertices, GL_STATIC_DRAW);
 
 	// create another one for storing our colours
-	glBindBuffer(GL_ARRAY_BUFFER, geometry->colourBuffer);
+	BindBuffer(GL_ARRAY_BUFFER, geometry->colourBuffer);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vec3)*geometry->elementCount, colours, GL_STATIC_DRAW);
+	CountGpuBuffer(MEMORY_SCENES, geometry->vertexBuffer, sizeof(vec2)*geometry->elementCount);
+	CountGpuBuffer(MEMORY_SCENES, geometry->colourBuffer, sizeof(vec3)*geometry->elementCount);
 
 	//Unbind buffer to reset to default state
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// plain geometry does not move
+	const GLuint ANIMATION_INDEX = 2;
+	BindVertexArray(geometry->vertexArray);
+	glDisableVertexAttribArray(ANIMATION_INDEX);
+	BindVertexArray(0);
 
 	// check for OpenGL errors and return false if error occurred
 	return !CheckGLErrors();
 }
 
+// uploads a mapped scene file: its points, colours and indices go to the
+// buffers straight from the mapping, with no copy on the CPU
+bool LoadSceneFile(Geometry *geometry, const SceneFile &scene)
+{
+	if (!LoadGeometry(geometry, scene.Points(), scene.Colours(), scene.PointCount()))
+		return false;
+
+	// binding through the vertex array object leaves its element buffer in place
+	BindVertexArray(geometry->vertexArray);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)*scene.IndexCount(), scene.Indices(), GL_STATIC_DRAW);
+	CountGpuBuffer(MEMORY_SCENES, geometry->elementBuffer, sizeof(GLuint)*scene.IndexCount());
+
+	// motion parameters are uploaded with the points, never again per frame
+	const GLuint ANIMATION_INDEX = 2;
+	BindBuffer(GL_ARRAY_BUFFER, geometry->animationBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vec4)*scene.PointCount(), scene.Animations(), GL_STATIC_DRAW);
+	CountGpuBuffer(MEMORY_SCENES, geometry->animationBuffer, sizeof(vec4)*scene.PointCount());
+	BindBuffer(GL_ARRAY_BUFFER, 0);
+	glEnableVertexAttribArray(ANIMATION_INDEX);
+	BindVertexArray(0);
+
+	return !CheckGLErrors();
+}
+
+// uploads a workload's patches; they are drawn in one colour, so the colour
+// buffer is left empty
+bool LoadWorkload(Geometry *geometry, const Workload &workload)
+{
+	geometry->elementCount = workload.vertices.size();
+
+	BindBuffer(GL_ARRAY_BUFFER, geometry->vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2)*geometry->elementCount, workload.vertices.data(), GL_STATIC_DRAW);
+	BindBuffer(GL_ARRAY_BUFFER, geometry->colourBuffer);
+	glBufferData(GL_ARRAY_BUFFER, 0, 0, GL_STATIC_DRAW);
+	BindBuffer(GL_ARRAY_BUFFER, 0);
+	CountGpuBuffer(MEMORY_SCENES, geometry->vertexBuffer, sizeof(vec2)*geometry->elementCount);
+	CountGpuBuffer(MEMORY_SCENES, geometry->colourBuffer, 0);
+
+	return !CheckGLErrors();
+}
+
 // deallocate geometry-related objects
 void DestroyGeometry(Geometry *geometry)
 {
 	// unbind and destroy our vertex array object and associated buffers
-	glBindVertexArray(0);
-	glDeleteVertexArrays(1, &geometry->vertexArray);
-	glDeleteBuffers(1, &geometry->vertexBuffer);
-	glDeleteBuffers(1, &geometry->colourBuffer);
+	BindVertexArray(0);
+	for(GLuint buffer : {geometry->vertexBuffer, geometry->colourBuffer, geometry->elementBuffer, geometry->animationBuffer})
+		ForgetGpuBuffer(buffer);
+	DeleteVertexArrays(1, &geometry->vertexArray);
+	DeleteBuffers(1, &geometry->vertexBuffer);
+	DeleteBuffers(1, &geometry->colourBuffer);
+	DeleteBuffers(1, &geometry->elementBuffer);
+	DeleteBuffers(1, &geometry->animationBuffer);
+	DeleteTextures(1, &geometry->patchTexture);
+	DeleteTextures(1, &geometry->indexTexture);
+	DeleteTextures(1, &geometry->animationTexture);
+}
+
+// target of frames drawn without a window (--record): 4x multisampled like the
+// window, then resolved into a single sample framebuffer that is read back
+struct Offscreen
+{
+	GLuint framebuffer, colour;
+	GLuint resolved, resolvedColour;
+	int width, height;
+};
+
+// allocates both framebuffers, returning true if they are complete
+bool InitializeOffscreen(Offscreen *target, int width, int height)
+{
+	target->width = width;
+	target->height = height;
+
+	glGenRenderbuffers(1, &target->colour);
+	glBindRenderbuffer(GL_RENDERBUFFER, target->colour);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGBA8, width, height);
+	glGenFramebuffers(1, &target->framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->colour);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	glGenRenderbuffers(1, &target->resolvedColour);
+	glBindRenderbuffer(GL_RENDERBUFFER, target->resolvedColour);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenFramebuffers(1, &target->resolved);
+	glBindFramebuffer(GL_FRAMEBUFFER, target->resolved);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->resolvedColour);
+	complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return complete && !CheckGLErrors();
+}
+
+// resolves the samples drawn and leaves the result bound for reading
+void ResolveOffscreen(const Offscreen &target)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.resolved);
+	glBlitFramebuffer(0, 0, target.width, target.height, 0, 0, target.width, target.height,
+	                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, target.resolved);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+void DestroyOffscreen(Offscreen *target)
+{
+	glDeleteFramebuffers(1, &target->framebuffer);
+	glDeleteFramebuffers(1, &target->resolved);
+	glDeleteRenderbuffers(1, &target->colour);
+	glDeleteRenderbuffers(1, &target->resolvedColour);
 }
 
 // --------------------------------------------------------------------------
@@ -199,11 +472,16 @@ void RenderScene(Geometry *geometry, GLuint program, int type)
 {
 
 	// bind our shader program and the vertex array object containing our
-	// scene geometry, then tell OpenGL to draw our geometry
-	glUseProgram(program);
-	glBindVertexArray(geometry->vertexArray);
+	// scene geometry, then tell OpenGL to draw our geometry; both stay bound,
+	// so the next draw with the same ones binds nothing
+	UseProgram(program);
+	BindVertexArray(geometry->vertexArray);
+
+	// the view matrix comes from the Camera block; only the model is per draw
+	glUniformMatrix4fv(UniformLocation(program, "model"), 1, GL_FALSE, value_ptr(geometry->model));
 
         if(type == 0){
+                SetStrokePatches(program, geometry->patchTexture, 0, geometry->elementCount/4);
                 glDrawArrays(GL_PATCHES, 0, geometry->elementCount);
         }else if(type == 1){
 	        glDrawArrays(GL_LINE_STRIP, 0, geometry->elementCount);
@@ -211,14 +489,88 @@ void RenderScene(Geometry *geometry, GLuint program, int type)
                 glDrawArrays(GL_POINTS, 0, geometry->elementCount);
         }
 
-	// reset state to default (no shader or geometry bound)
-	glBindVertexArray(0);
-	glUseProgram(0);
-
 	// check for an report any OpenGL errors
 	CheckGLErrors();
 }
 
+//draws one view of every shape of a scene loaded with LoadSceneFile that asks
+//for it: patches (type 0), control polygon (type 1) or points (type 2), each
+//from its range of the element buffer
+void RenderSceneFile(Geometry *geometry, const SceneFile &scene, GLuint program, int type)
+{
+	const GLuint COLOUR_INDEX = 1;
+	const unsigned int MODES[] = {DRAW_CURVES, DRAW_POLYGON, DRAW_POINTS};
+
+	UseProgram(program);
+	BindVertexArray(geometry->vertexArray);
+	glUniformMatrix4fv(UniformLocation(program, "model"), 1, GL_FALSE, value_ptr(geometry->model));
+
+	// curves and polygon are one colour per shape, so they skip the per point colours
+	if (type != 2) glDisableVertexAttribArray(COLOUR_INDEX);
+
+	for (size_t i = 0; i < scene.ShapeCount(); i++) {
+		const SceneShapeRecord &shape = scene.Shape(i);
+		if (!(shape.drawModes & MODES[type])) continue;
+
+		if (type == 0) {
+			glVertexAttrib3fv(COLOUR_INDEX, shape.curveColour);
+			SetStrokePatches(program, geometry->patchTexture, shape.firstPatchIndex/4, shape.patchIndexCount/4,
+			                 geometry->indexTexture, geometry->animationTexture);
+			glDrawElements(GL_PATCHES, shape.patchIndexCount, GL_UNSIGNED_INT, (void*)(sizeof(GLuint)*shape.firstPatchIndex));
+		}else if (type == 1) {
+			glVertexAttrib3fv(COLOUR_INDEX, shape.polygonColour);
+			glDrawElements(GL_LINES, shape.polygonIndexCount, GL_UNSIGNED_INT, (void*)(sizeof(GLuint)*shape.firstPolygonIndex));
+		}else if (type == 2) {
+			glDrawElements(GL_POINTS, shape.pointIndexCount, GL_UNSIGNED_INT, (void*)(sizeof(GLuint)*shape.firstPointIndex));
+		}
+	}
+
+	glEnableVertexAttribArray(COLOUR_INDEX);
+
+	CheckGLErrors();
+}
+
+//draws the patches of a geometry loaded with LoadWorkload in a single colour
+void RenderWorkload(Geometry *geometry, GLuint program, vec3 colour)
+{
+	const GLuint COLOUR_INDEX = 1;
+
+	UseProgram(program);
+	BindVertexArray(geometry->vertexArray);
+	glUniformMatrix4fv(UniformLocation(program, "model"), 1, GL_FALSE, value_ptr(geometry->model));
+
+	glDisableVertexAttribArray(COLOUR_INDEX);
+	glVertexAttrib3fv(COLOUR_INDEX, value_ptr(colour));
+	SetStrokePatches(program, geometry->patchTexture, 0, geometry->elementCount/4);
+	glDrawArrays(GL_PATCHES, 0, geometry->elementCount);
+	glEnableVertexAttribArray(COLOUR_INDEX);
+
+	CheckGLErrors();
+}
+
+//draws an image over the whole window, behind everything else; vertexArray
+//may be empty, the quad comes from gl_VertexID
+void RenderBackground(GLuint program, GLuint vertexArray, const MyTexture& image)
+{
+	UseProgram(program);
+	BindVertexArray(vertexArray);
+
+	ActiveTexture(GL_TEXTURE0);
+	BindTexture(image.target, image.textureID);
+	glUniform1i(UniformLocation(program, "image"), 0);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	CheckGLErrors();
+}
+
+//sets the animation clock of a program; the only per frame input animated
+//scenes need, whatever the number of shapes
+void SetAnimationTime(GLuint program, float time)
+{
+	UseProgram(program);
+	glUniform1f(UniformLocation(program, "time"), time);
+}
+
 // -------------------------------------------------------------------------- vec2 position = (1-u)*(1-u)*(1-u)*p0 + 3*u*(1-u)*(1-u)*p1 + 3*u*u*(1-u)*p2 + u*u*u*p3; 
 // GLFW callback functions
 
@@ -232,7 +584,169 @@ void ErrorCallback(int error, const char* description)
 
 
 //GLOBAL VARS
-int sceneId = 0;
+//document line width in EMs, and the step and minimum of [ and ]
+const float DOCUMENT_WRAP_WIDTH = 46.0f;
+const float WRAP_WIDTH_STEP = 2.0f;
+const float MIN_WRAP_WIDTH = 8.0f;
+
+//the GLFW thread only turns events into input state; the render thread owns the GL
+//context and everything drawn, and sees the input as snapshots published after each
+//batch of events. Presses and scrolls are counted or summed, so a slow frame that
+//skips snapshots still sees every one of them
+struct InputState
+{
+        int sceneId;
+        double sceneSwitchTime;         //key press that chose sceneId, for switch latency
+        unsigned int workloadAdvances;  //k presses while the workload was shown
+        unsigned int fontRebuilds;      //s presses; outlineTolerance is the latest choice
+        float outlineTolerance;
+        bool animationPaused;
+        bool slowFrames;                //l adds 50 ms to every frame
+        unsigned int recordToggles;     //r presses: recording starts and stops in turn
+        StrokeStyle stroke;             //outline width, joins and caps; width 0 keeps the 1 pixel isolines
+
+        vec2 viewCentre;
+        float viewZoom;
+        double scrollLines;             //document scrolling since startup
+        float wrapWidth;                //document line width in EMs, [ and ] narrow and widen it
+        TextAlignment alignment;        //t cycles the document's alignment
+        LineBreaking lineBreaking;      //o switches between greedy and optimal line breaks
+        int framebufferWidth, framebufferHeight;
+
+        //cursor and buttons in normalized device coordinates
+        vec2 cursor;
+        bool leftDown;
+        unsigned int leftPresses;
+        vec2 leftPressCursor;
+        unsigned int rightClicks;
+        vec2 rightClickCursor;
+
+        InputState() : sceneId(0), sceneSwitchTime(-1), workloadAdvances(0), fontRebuilds(0), outlineTolerance(0),
+                       animationPaused(false), slowFrames(false), recordToggles(0), viewCentre(0.0f), viewZoom(1.0f), scrollLines(0),
+                       wrapWidth(DOCUMENT_WRAP_WIDTH), alignment(ALIGN_LEFT), lineBreaking(BREAK_GREEDY),
+                       framebufferWidth(0), framebufferHeight(0), cursor(0.0f), leftDown(false), leftPresses(0),
+                       leftPressCursor(0.0f), rightClicks(0), rightClickCursor(0.0f)
+        {}
+};
+
+//the render thread's answer to a left press: did it grab a control point?
+struct PressResult
+{
+        unsigned int press;
+        bool onPoint;
+
+        PressResult() : press(0), onPoint(false)
+        {}
+};
+
+SnapshotBuffer<InputState> inputSnapshots;
+SnapshotBuffer<PressResult> pressResults;
+
+//GLFW thread: the input being edited and the view it drives (the camera's GL half is unused here)
+InputState input;
+Camera inputView;
+
+//a left drag pans unless the render thread finds a control point under the press;
+//until it answers, the drag is held back rather than lost
+enum LeftDrag { DRAG_NONE, DRAG_UNDECIDED, DRAG_PAN, DRAG_POINT };
+LeftDrag leftDrag = DRAG_NONE;
+vec2 heldPan(0.0f);
+vec2 lastCursor;
+
+//RENDER THREAD STATE
+Camera camera;
+Document document;
+string documentFile;
+
+//image drawn behind every scene (--background), loaded without stalling a frame
+string backgroundFile;
+
+//spatial index over the curves of the current scene, in object space; scenes
+//that are not resident point it at an empty one
+SegmentBVH noBVH;
+SegmentBVH* sceneBVH = &noBVH;
+mat4 sceneModel(1.0f);
+
+//control point dragging for the mug and fish; releasedPoint asks the main loop to refit sceneBVH
+ControlPointEditor noEditor;
+ControlPointEditor* editor = &noEditor;
+int dragPoint = -1;
+int releasedPoint = -1;
+
+//fonts tried in order for characters a font is missing
+const vector<string> FONT_CHAIN = {"Lora-Regular.ttf", "SourceSansPro-Regular.otf", "Inconsolata.otf"};
+
+//a fallback chain starting with the given font, then the rest of FONT_CHAIN
+vector<string> fallbackChain(string first){
+        vector<string> chain(1, first);
+        for(const string& font : FONT_CHAIN)
+                if(font != first) chain.push_back(font);
+        return chain;
+}
+
+//outline simplification of the font scenes, in EMs; 0 leaves glyphs untouched
+//(read by the scene builder thread)
+const float SIMPLIFY_TOLERANCE = 0.002f;
+atomic<float> outlineTolerance(0);
+bool rebuildScene = false;
+
+//key press time of a scene switch, until the frame showing the new scene is measured
+double switchRequested = -1;
+
+//clock of the animated scenes; a pause stops it, so motion resumes where it left off
+double animationTime = 0;
+
+//synthetic workloads (scene 7): K cycles through WORKLOADS, reporting each one's rates;
+//--bench-workload steps through them all and exits
+int workloadIndex = 0;
+bool benchmarkWorkloads = false;
+
+//frames drawn before timing starts, then timed until either limit is reached
+const int WORKLOAD_WARMUP_FRAMES = 3;
+const int WORKLOAD_TIMED_FRAMES = 30;
+const double WORKLOAD_TIMED_SECONDS = 3.0;
+
+//what the l key adds to every frame, to check input keeps up with a slow renderer
+const double SLOW_FRAME_SECONDS = 0.05;
+
+//memory per subsystem is reported this often while it changes, and once at exit
+const double MEMORY_REPORT_SECONDS = 10.0;
+
+//frame recording: r writes every frame shown to CAPTURE_DIRECTORY until pressed again;
+//--record draws recordFrames frames offscreen at RECORD_WIDTH x RECORD_HEIGHT, one
+//animation step of RECORD_FRAME_SECONDS each, writes them all and exits
+const char* CAPTURE_DIRECTORY = "capture";
+const int RECORD_WIDTH = 1920, RECORD_HEIGHT = 1080;
+const double RECORD_FRAME_SECONDS = 1.0/60.0;
+int recordFrames = 0;
+CaptureFormat recordFormat = CAPTURE_PNG;
+
+//starts a recording into CAPTURE_DIRECTORY, creating it if needed
+void BeginRecording(FrameCapture* capture, CaptureFormat format)
+{
+	mkdir(CAPTURE_DIRECTORY, 0755);
+	capture->Begin(string(CAPTURE_DIRECTORY) + "/frame", format);
+}
+
+//converts a window position in screen coordinates to normalized device coordinates
+vec2 CursorToNdc(GLFWwindow* window, double x, double y)
+{
+	int width, height;
+	glfwGetWindowSize(window, &width, &height);
+	return vec2(2.0*x/width - 1.0, 1.0 - 2.0*y/height);
+}
+
+//converts normalized device coordinates to the object space of the current scene
+vec2 NdcToObject(vec2 ndc)
+{
+	return vec2(inverse(sceneModel) * vec4(camera.ScreenToWorld(ndc), 0, 1));
+}
+
+//how close the cursor must be to grab a point, in object space
+float PickRadius()
+{
+	return 0.03f / camera.Zoom() / sceneModel[0][0];
+}
 
 //KEY INPUT
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -240,27 +754,138 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GL_TRUE);
 
+        int previousScene = input.sceneId;
         if(action == GLFW_PRESS){
 		if(key == GLFW_KEY_B){ //mug
-                        sceneId = 0;                
+                        input.sceneId = 0;
                 }else if(key == GLFW_KEY_N){ //fish
-                        sceneId = 1; 
+                        input.sceneId = 1;
                 }else if(key == GLFW_KEY_F){
-                        sceneId = 2; //font Sans Pro
+                        input.sceneId = 2; //font Sans Pro
                 }else if(key == GLFW_KEY_G){
-                        sceneId = 3; //font Lora
+                        input.sceneId = 3; //font Lora
                 }else if(key == GLFW_KEY_H){
-                        sceneId = 4; //font Inconsolata
-                }          
+                        input.sceneId = 4; //font Inconsolata
+                }else if(key == GLFW_KEY_D){
+                        input.sceneId = 5; //document viewer
+                }else if(key == GLFW_KEY_P){
+                        input.sceneId = 6; //text sliding around the mug
+                }else if(key == GLFW_KEY_I){
+                        input.sceneId = 8; //instanced sprites
+                }else if(key == GLFW_KEY_A){
+                        input.animationPaused = !input.animationPaused;
+                }else if(key == GLFW_KEY_L){
+                        input.slowFrames = !input.slowFrames;
+                        cout << "slow frames " << (input.slowFrames ? "on" : "off") << endl;
+                }else if(key == GLFW_KEY_K){ //synthetic workload, the next one if already shown
+                        if(input.sceneId == 7) input.workloadAdvances++;
+                        input.sceneId = 7;
+                }else if(key == GLFW_KEY_SPACE){
+                        inputView.Reset();
+                }else if(key == GLFW_KEY_W){ //stroke width, cycling through hairline, 2, 6 and 16 pixels
+                        const float widths[] = {0, 2, 6, 16};
+                        int i = 0;
+                        while(i < 3 && widths[i] != input.stroke.width) i++;
+                        input.stroke.width = widths[(i + 1) % 4];
+                        cout << "stroke width " << input.stroke.width << endl;
+                }else if(key == GLFW_KEY_J){
+                        input.stroke.join = StrokeJoin((input.stroke.join + 1) % JOIN_COUNT);
+                        cout << "stroke join " << StrokeJoinName(input.stroke.join) << endl;
+                }else if(key == GLFW_KEY_S){ //toggle outline simplification
+                        input.outlineTolerance = input.outlineTolerance > 0 ? 0 : SIMPLIFY_TOLERANCE;
+                        input.fontRebuilds++;
+                }else if(key == GLFW_KEY_C){
+                        input.stroke.cap = StrokeCap((input.stroke.cap + 1) % CAP_COUNT);
+                        cout << "stroke cap " << StrokeCapName(input.stroke.cap) << endl;
+                }else if(key == GLFW_KEY_R){ //start or stop recording frames
+                        input.recordToggles++;
+                }
 	}
+        if(input.sceneId != previousScene) input.sceneSwitchTime = glfwGetTime();
+
+        //document scrolling, repeating while the key is held
+        if(input.sceneId == 5 && action != GLFW_RELEASE){
+                if(key == GLFW_KEY_DOWN) input.scrollLines += 1;
+                else if(key == GLFW_KEY_UP) input.scrollLines -= 1;
+                else if(key == GLFW_KEY_PAGE_DOWN) input.scrollLines += 40;
+                else if(key == GLFW_KEY_PAGE_UP) input.scrollLines -= 40;
+                else if(key == GLFW_KEY_LEFT_BRACKET) input.wrapWidth = std::max(input.wrapWidth - WRAP_WIDTH_STEP, MIN_WRAP_WIDTH);
+                else if(key == GLFW_KEY_RIGHT_BRACKET) input.wrapWidth += WRAP_WIDTH_STEP;
+        }
+        if(input.sceneId == 5 && action == GLFW_PRESS){
+                if(key == GLFW_KEY_T) input.alignment = TextAlignment((input.alignment + 1) % ALIGN_COUNT);
+                else if(key == GLFW_KEY_O) input.lineBreaking = LineBreaking((input.lineBreaking + 1) % BREAK_COUNT);
+        }
+}
+
+//MOUSE INPUT
+void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+        double x, y;
+        glfwGetCursorPos(window, &x, &y);
+        vec2 cursor = CursorToNdc(window, x, y);
+        input.cursor = lastCursor = cursor;
+
+        //left drag moves a control point if one is under the cursor, otherwise pans;
+        //which one is decided by the render thread, which owns the scene
+        if(button == GLFW_MOUSE_BUTTON_LEFT){
+                input.leftDown = (action == GLFW_PRESS);
+                if(action == GLFW_PRESS){
+                        input.leftPresses++;
+                        input.leftPressCursor = cursor;
+                        leftDrag = DRAG_UNDECIDED;
+                        heldPan = vec2(0.0f);
+                }else{
+                        leftDrag = DRAG_NONE;
+                }
+        }
+
+        //right click reports what is under the cursor
+        if(button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS){
+                input.rightClicks++;
+                input.rightClickCursor = cursor;
+        }
+}
+
+void CursorPosCallback(GLFWwindow* window, double x, double y)
+{
+        vec2 cursor = CursorToNdc(window, x, y);
+        if(leftDrag == DRAG_PAN) inputView.Pan(cursor - lastCursor);
+        else if(leftDrag == DRAG_UNDECIDED) heldPan += cursor - lastCursor;
+        input.cursor = lastCursor = cursor;
+}
+
+void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+{
+        //the wheel scrolls the document; hold control to zoom instead
+        if(input.sceneId == 5 && glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) != GLFW_PRESS){
+                input.scrollLines -= 3.0*yoffset;
+                return;
+        }
+
+        double x, y;
+        glfwGetCursorPos(window, &x, &y);
+        inputView.ZoomAt(CursorToNdc(window, x, y), pow(1.1f, (float)yoffset));
+}
+
+//settles an undecided left drag once the render thread has answered for its press
+void ApplyPressResult(const PressResult& result)
+{
+        if(leftDrag != DRAG_UNDECIDED || result.press != input.leftPresses) return;
+        if(result.onPoint){
+                leftDrag = DRAG_POINT;
+        }else{
+                leftDrag = DRAG_PAN;
+                inputView.Pan(heldPan);
+        }
+        heldPan = vec2(0.0f);
 }
 
 
 //EXTRACT FONT
-void extractLetter(vector<vec2>*rPointsLocal, vector<vec3>* rColorsLocal, char letter, string fontString){
-        GlyphExtractor extractor;
-        extractor.LoadFontFile(fontString);
-        MyGlyph rGlyph = extractor.ExtractGlyph(letter);
+void extractLetter(vector<vec2>*rPointsLocal, vector<vec3>* rColorsLocal, unsigned int letter, const FontSet& fonts, SimplifyStats* stats){
+        MyGlyph rGlyph = fonts.ExtractGlyph(letter);
+        if(outlineTolerance > 0) SimplifyGlyph(&rGlyph, outlineTolerance, stats);
         for(int i = 0; i<rGlyph.contours.size(); i++){
                 for(int j = 0; j<rGlyph.contours[i].size(); j++){
 
@@ -279,7 +904,8 @@ void extractLetter(vector<vec2>*rPointsLocal, vector<vec3>* rColorsLocal, char l
 }
 
 
-void extractFont(vector<vec2>*fontPoints, vector<vec3>* fontColors, string fontString){
+//letters are placed in EM units; the glyph geometry's model matrix scales them to the screen
+void extractFont(ScenePoints* fontPoints, SceneColours* fontColors, string fontString){
         vector<vec2> RPoints;
 	vector<vec3> RColors;
         vector<vec2> oPoints;
@@ -293,263 +919,295 @@ void extractFont(vector<vec2>*fontPoints, vector<vec3>* fontColors, string fontS
         vector<vec2> tPoints;
 	vector<vec3> tColors;
 
-        extractLetter(&RPoints, &RColors, 'R', fontString);
-        extractLetter(&oPoints, &oColors, 'o', fontString);
-        extractLetter(&bPoints, &bColors, 'b', fontString);
-        extractLetter(&ePoints, &eColors, 'e', fontString);
-        extractLetter(&rPoints, &rColors, 'r', fontString);
-        extractLetter(&tPoints, &tColors, 't', fontString);
+        FontSet fonts;
+        fonts.AddFonts(fallbackChain(fontString));
+
+        SimplifyStats stats;
+        extractLetter(&RPoints, &RColors, 'R', fonts, &stats);
+        extractLetter(&oPoints, &oColors, 'o', fonts, &stats);
+        extractLetter(&bPoints, &bColors, 'b', fonts, &stats);
+        extractLetter(&ePoints, &eColors, 'e', fonts, &stats);
+        extractLetter(&rPoints, &rColors, 'r', fonts, &stats);
+        extractLetter(&tPoints, &tColors, 't', fonts, &stats);
+        if(outlineTolerance > 0){
+                cout << "simplified " << fontString << ": " << stats.segmentsIn - stats.segmentsOut << " of "
+                     << stats.segmentsIn << " segments, " << stats.VerticesIn() - stats.VerticesOut() << " vertices removed" << endl;
+        }
 
         for(int i = 0; i<RPoints.size(); i++){
-                RPoints.at(i) = RPoints.at(i)/2.f-vec2(0.8,0.1);
+                RPoints.at(i) = RPoints.at(i)-vec2(1.6,0.2);
                 fontPoints->push_back(RPoints.at(i));
                 fontColors->push_back(vec3(1.f,0.f,0.f));
         }
         for(int i = 0; i<oPoints.size(); i++){
-                oPoints.at(i) = oPoints.at(i)/2.f-vec2(0.5,0.1);
+                oPoints.at(i) = oPoints.at(i)-vec2(1.0,0.2);
                 fontPoints->push_back(oPoints.at(i));
                 fontColors->push_back(vec3(1.f,0.f,0.f));
         }
         for(int i = 0; i<bPoints.size(); i++){
-                bPoints.at(i) = bPoints.at(i)/2.f-vec2(0.2,0.1);
+                bPoints.at(i) = bPoints.at(i)-vec2(0.4,0.2);
                 fontPoints->push_back(bPoints.at(i));
                 fontColors->push_back(vec3(1.f,0.f,0.f));
         }
         for(int i = 0; i<ePoints.size(); i++){
-                ePoints.at(i) = ePoints.at(i)/2.f-vec2(-0.1,0.1);
+                ePoints.at(i) = ePoints.at(i)-vec2(-0.2,0.2);
                 fontPoints->push_back(ePoints.at(i));
                 fontColors->push_back(vec3(1.f,0.f,0.f));
         }
         for(int i = 0; i<rPoints.size(); i++){
-                rPoints.at(i) = rPoints.at(i)/2.f-vec2(-0.4,0.1);
+                rPoints.at(i) = rPoints.at(i)-vec2(-0.8,0.2);
                 fontPoints->push_back(rPoints.at(i));
                 fontColors->push_back(vec3(1.f,0.f,0.f));
         }
         for(int i = 0; i<tPoints.size(); i++){
-                tPoints.at(i) = tPoints.at(i)/2.f-vec2(-0.65,0.1);
+                tPoints.at(i) = tPoints.at(i)-vec2(-1.3,0.2);
                 fontPoints->push_back(tPoints.at(i));
                 fontColors->push_back(vec3(1.f,0.f,0.f));
         }     
 }
 
 
-//COFFEE
-void mug(vector<vec2>* vertices, vector<vec3>* colours, vector<vec2>* verticesControl, vector<vec3>* coloursControl, vector<vec2>* verticesControlPoints, vector<vec3>* coloursControlPoints){
-       
-        //mug colors and  vertices
-        vertices->push_back(vec2(1.f/3.f, 1.f/3.f));
-        vertices->push_back(vec2(2.f/3.f, -1.f/3.f));
-        vertices->push_back(vec2(0,-1.f/3.f));
-        vertices->push_back(vec2(0,0));
-
-        vertices->push_back(vec2(0,-1.f/3.f));
-        vertices->push_back(vec2(-2.f/3.f,-1.f/3.f));
-        vertices->push_back(vec2(-1.f/3.f,1.f/3.f));
-        vertices->push_back(vec2(0,0));
-
-        vertices->push_back(vec2(-1.f/3.f,1.f/3.f));
-        vertices->push_back(vec2(0,1.f/3.f));
-        vertices->push_back(vec2(1/3.f,1.f/3.f));
-        vertices->push_back(vec2(0,0));
-        
-        vertices->push_back(vec2(0.4,0.5/3.f));
-        vertices->push_back(vec2(2.5/3.f,1.f/3.f));
-        vertices->push_back(vec2(1.3/3.f,-0.4/3.f));
-        vertices->push_back(vec2(0,0));
-
-        for(int i = 0; i<16; i++) colours->push_back(vec3(1.0f, 0.0f, 1.0f));
-        
+//DOCUMENT
+//loads the file given on the command line, or the READMEs repeated into a multi-megabyte stress test
+void loadDocument(Document* doc, string filename){
+        if(!doc->Initialize(fallbackChain("Inconsolata.otf"), 160, 8192)){
+                cout << "Failed to initialize document viewer" << endl;
+                return;
+        }
+        doc->SetLayout(0.04f, DOCUMENT_WRAP_WIDTH, vec2(-0.95f, 0.95f));
+
+        if(!filename.empty()){
+                doc->LoadFile(filename);
+        }else{
+                string readmes;
+                for(const char* name : {"README", "ASSIGNMENT README.txt"}){
+                        ifstream input(name);
+                        readmes.append(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+                }
+                string text;
+                for(int i = 0; i<4000; i++) text += readmes;
+                doc->SetText(text);
+        }
+        cout << "document: " << doc->ByteSize() << " bytes" << endl;
+}
 
-        //control points of the control polygon and its colors
-        verticesControl->push_back(vec2(1.f/3.f, 1.f/3.f));
-        for(int i = 0; i<2; i++) verticesControl->push_back(vec2(2.f/3.f, -1.f/3.f));
-        for(int i = 0; i<2; i++)verticesControl->push_back(vec2(0,-1.f/3.f));
 
-        for(int i = 0; i<2; i++)verticesControl->push_back(vec2(0,-1.f/3.f));
-        for(int i = 0; i<2; i++)verticesControl->push_back(vec2(-2.f/3.f,-1.f/3.f));
-        for(int i = 0; i<2; i++)verticesControl->push_back(vec2(-1.f/3.f,1.f/3.f));
+//scenes 0 and 1 (and the mug under the text of scene 6), converted from scenes/*.txt
+const char* SCENE_FILES[] = {"scenes/mug.bzs", "scenes/fish.bzs"};
 
-        for(int i = 0; i<2; i++)verticesControl->push_back(vec2(-1.f/3.f,1.f/3.f));
-        for(int i = 0; i<2; i++)verticesControl->push_back(vec2(0,1.f/3.f));
-        for(int i = 0; i<2; i++)verticesControl->push_back(vec2(1.f/3.f,1.f/3.f));
-        
-        for(int i = 0; i<2; i++)verticesControl->push_back(vec2(0.4,0.5/3.f));
-        for(int i = 0; i<2; i++)verticesControl->push_back(vec2(2.5/3.f,1.f/3.f));
-        verticesControl->push_back(vec2(1.3/3.f,-0.4/3.f));
+string sceneFileName(int id){
+        return SCENE_FILES[id == 1 ? 1 : 0];
+}
 
-        for(int i = 0; i<22; i++) coloursControl->push_back(vec3(0.0f, 0.0f, 1.0f));
-        
+//fonts of scenes 2, 3 and 4
+const char* SCENE_FONTS[] = {"SourceSansPro-Regular.otf", "Lora-Regular.ttf", "Inconsolata.otf"};
 
-        //control points and colours
-        verticesControlPoints->push_back(vec2(1.f/3.f, 1.f/3.f));
-        verticesControlPoints->push_back(vec2(2.f/3.f, -1.f/3.f));
-        verticesControlPoints->push_back(vec2(0,-1.f/3.f));
+//placement of each scene's geometry in the world
+mat4 SceneModel(int id){
+        if(id == 1) return translate(mat4(1.0f), vec3(-0.75f, -0.5f, 0.0f)); //our shift to make it nicer
+        if(id >= 2 && id <= 4) return scale(mat4(1.0f), vec3(0.5f, 0.5f, 1.0f));
+        return mat4(1.0f);
+}
 
-        verticesControlPoints->push_back(vec2(0,-1.f/3.f));
-        verticesControlPoints->push_back(vec2(-2.f/3.f,-1.f/3.f));
-        verticesControlPoints->push_back(vec2(-1.f/3.f,1.f/3.f));
+//the mug's body (its first three patches) as a spline for text to follow
+vector<MySegment> mugPath(const SceneFile& scene){
+        vector<MySegment> path;
+        for(size_t i = 0; i < scene.PatchCount() && i < 3; i++)
+                path.push_back(scene.Segment(i));
+        return path;
+}
 
-        verticesControlPoints->push_back(vec2(-1.f/3.f,1.f/3.f));
-        verticesControlPoints->push_back(vec2(0,1.f/3.f));
-        verticesControlPoints->push_back(vec2(1.f/3.f,1.f/3.f));
-        
-        verticesControlPoints->push_back(vec2(0.4,0.5/3.f));
-        verticesControlPoints->push_back(vec2(2.5/3.f,1.f/3.f));
-        verticesControlPoints->push_back(vec2(1.3/3.f,-0.4/3.f));
-        
-        for(int i = 0; i<4; i++){
-                coloursControlPoints->push_back(vec3(1.0f, 0.0f, 0.0f));
-                coloursControlPoints->push_back(vec3(1.0f, 1.0f, 1.0f));
-                coloursControlPoints->push_back(vec3(1.0f, 0.0f, 0.0f));
+//one index range of every shape drawn in the given mode, as plain arrays for the CPU renderer
+void gatherSceneFile(const SceneFile& scene, unsigned int mode, ScenePoints* vertices, SceneColours* colours){
+        const vec2* points = scene.Points();
+        const unsigned int* indices = scene.Indices();
+        for(size_t i = 0; i < scene.ShapeCount(); i++){
+                const SceneShapeRecord& shape = scene.Shape(i);
+                if(!(shape.drawModes & mode)) continue;
+
+                uint32_t first = shape.firstPatchIndex, count = shape.patchIndexCount;
+                const float* colour = shape.curveColour;
+                if(mode == DRAW_POLYGON){ first = shape.firstPolygonIndex; count = shape.polygonIndexCount; colour = shape.polygonColour; }
+                if(mode == DRAW_POINTS){ first = shape.firstPointIndex; count = shape.pointIndexCount; }
+
+                for(uint32_t j = first; j < first + count; j++){
+                        vertices->push_back(points[indices[j]]);
+                        colours->push_back(mode == DRAW_POINTS ? scene.Colours()[indices[j]] : make_vec3(colour));
+                }
         }
-        
 }
 
-//FISH
-void fish(vector<vec2>* vertices, vector<vec3>* colours, vector<vec2>* verticesControl, vector<vec3>* coloursControl, vector<vec2>* verticesControlPoints, vector<vec3>* coloursControlPoints){
-        
-        //shift causes some trouble we need to account for that by clearing the arrays
-        vertices->clear();
-        colours->clear();
-        verticesControl->clear();
-        coloursControl->clear();
-        verticesControlPoints->clear();
-        coloursControlPoints->clear();        
-
-        //fish colors and  vertices
-        vertices->push_back(vec2(1.f/6.f, 1.f/6.f));
-        vertices->push_back(vec2(4.f/6.f, 0));
-        vertices->push_back(vec2(6.f/6.f, 2.f/6.f));
-        vertices->push_back(vec2(9.f/6.f, 1.f/6.f));
-
-        vertices->push_back(vec2(8.f/6.f, 2.f/6.f));
-        vertices->push_back(vec2(0, 8.f/6.f));
-        vertices->push_back(vec2(0, -2.f/6.f));
-        vertices->push_back(vec2(8.f/6.f, 4.f/6.f));
-
-        vertices->push_back(vec2(5.f/6.f, 3.f/6.f));
-        vertices->push_back(vec2(3.f/6.f, 2.f/6.f));
-        vertices->push_back(vec2(3.f/6.f, 3.f/6.f));
-        vertices->push_back(vec2(5.f/6.f, 2.f/6.f));
-
-        vertices->push_back(vec2(3.f/6.f, 2.2/6.f));
-        vertices->push_back(vec2(3.5/6.f, 2.7/6.f));
-        vertices->push_back(vec2(3.5/6.f, 3.3/6.f));
-        vertices->push_back(vec2(3.f/6.f, 3.8/6.f));
-
-        vertices->push_back(vec2(2.8/6.f, 3.5/6.f));
-        vertices->push_back(vec2(2.4/6.f, 3.8/6.f));
-        vertices->push_back(vec2(2.4/6.f, 3.2/6.f));
-        vertices->push_back(vec2(2.8/6.f, 3.5/6.f));
-        
-        for(int i = 0; i<vertices->size();i++){ //our shift to make it nicer
-                vertices->at(i) = vertices->at(i) - vec2(0.75, 0.5);
+//CPU REFERENCE RENDER
+//draws a scene the way the GL path does, with no window or GL context, and saves it as a PNG
+int renderSceneCpu(int id, string filename){
+        SceneFile scene;
+        ScenePoints vertices;
+        SceneColours colours;
+
+        if(id <= 1){
+                if(!scene.Open(sceneFileName(id))) return -1;
+                gatherSceneFile(scene, DRAW_CURVES, &vertices, &colours);
+        }
+        else if(id <= 4) extractFont(&vertices, &colours, SCENE_FONTS[id - 2]);
+        else{
+                cout << "no CPU rendering for scene " << id << endl;
+                return -1;
         }
 
-        for(int i = 0; i<20; i++) colours->push_back(vec3(1.0f, 0.0f, 1.0f));
-        
+        ReferenceRenderer renderer(512, 512);
+        renderer.Clear(vec3(0.2f, 0.2f, 0.2f));
+        mat4 model = SceneModel(id);
+        renderer.DrawPatches(vertices.data(), colours.data(), vertices.size(), model);
+        ScenePoints polygon, points;
+        SceneColours polygonColours, pointColours;
+        gatherSceneFile(scene, DRAW_POLYGON, &polygon, &polygonColours);
+        gatherSceneFile(scene, DRAW_POINTS, &points, &pointColours);
+        renderer.DrawLines(polygon.data(), polygonColours.data(), polygon.size(), model);
+        renderer.DrawPoints(points.data(), pointColours.data(), points.size(), model);
+        return renderer.WritePng(filename) ? 0 : -1;
+}
 
-        //control points of the control polygon and its colors
-        verticesControl->push_back(vec2(1.f/6.f, 1.f/6.f));
-        verticesControl->push_back(vec2(4.f/6.f, 0));
-        verticesControl->push_back(vec2(6.f/6.f, 2.f/6.f));
-        verticesControl->push_back(vec2(9.f/6.f, 1.f/6.f));
-
-        verticesControl->push_back(vec2(8.f/6.f, 2.f/6.f));
-        verticesControl->push_back(vec2(0, 8.f/6.f));
-        verticesControl->push_back(vec2(0, -2.f/6.f));
-        verticesControl->push_back(vec2(8.f/6.f, 4.f/6.f));
-
-        verticesControl->push_back(vec2(5.f/6.f, 3.f/6.f));
-        verticesControl->push_back(vec2(3.f/6.f, 2.f/6.f));
-        verticesControl->push_back(vec2(3.f/6.f, 3.f/6.f));
-        verticesControl->push_back(vec2(5.f/6.f, 2.f/6.f));
-
-        verticesControl->push_back(vec2(3.f/6.f, 2.2/6.f));
-        verticesControl->push_back(vec2(3.5/6.f, 2.7/6.f));
-        verticesControl->push_back(vec2(3.5/6.f, 3.3/6.f));
-        verticesControl->push_back(vec2(3.f/6.f, 3.8/6.f));
-
-        verticesControl->push_back(vec2(2.8/6.f, 3.5/6.f));
-        verticesControl->push_back(vec2(2.4/6.f, 3.8/6.f));
-        verticesControl->push_back(vec2(2.4/6.f, 3.2/6.f));
-        verticesControl->push_back(vec2(2.8/6.f, 3.5/6.f));
-        
-        for(int i = 0; i<verticesControl->size();i++){
-                verticesControl->at(i) = verticesControl->at(i) - vec2(0.75, 0.5);
+//SPRITES
+//scene 8: thousands of sprites of procedurally drawn images in three sizes, packed into
+//one texture array that starts small enough to grow, drawn in a single instanced call
+const int SPRITE_IMAGES = 32;
+const int SPRITE_COUNT = 20000;
+const int SPRITE_LAYER_SIZE = 64;
+
+//an antialiased disc, ring, square or diamond, size pixels across
+vector<unsigned char> spriteImage(int kind, int size, vec3 colour){
+        vector<unsigned char> rgba(4*size*size);
+        for(int y = 0; y < size; y++){
+                for(int x = 0; x < size; x++){
+                        //signed distance to the shape's edge, with the image spanning [-1,1]
+                        vec2 p = (vec2(x, y) + 0.5f)/float(size)*2.0f - 1.0f;
+                        float d;
+                        if(kind == 0) d = length(p) - 0.9f;
+                        else if(kind == 1) d = fabs(length(p) - 0.65f) - 0.25f;
+                        else if(kind == 2) d = std::max(fabs(p.x), fabs(p.y)) - 0.8f;
+                        else d = (fabs(p.x) + fabs(p.y))*0.7071f - 0.65f;
+
+                        unsigned char* texel = &rgba[4*(y*size + x)];
+                        texel[0] = (unsigned char)(255*colour.r);
+                        texel[1] = (unsigned char)(255*colour.g);
+                        texel[2] = (unsigned char)(255*colour.b);
+                        texel[3] = (unsigned char)(255*clamp(0.5f - 0.5f*d*size, 0.0f, 1.0f));
+                }
         }
+        return rgba;
+}
 
-        for(int i = 0; i<20; i++) coloursControl->push_back(vec3(0.0f, 0.0f, 1.0f));
-        
+void buildSprites(TextureArray* array, SpriteBatch* batch){
+        mt19937 random(453);
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
 
-        //control points and colours
-        verticesControlPoints->push_back(vec2(1.f/6.f, 1.f/6.f));
-        verticesControlPoints->push_back(vec2(4.f/6.f, 0));
-        verticesControlPoints->push_back(vec2(6.f/6.f, 2.f/6.f));
-        verticesControlPoints->push_back(vec2(9.f/6.f, 1.f/6.f));
-
-        verticesControlPoints->push_back(vec2(8.f/6.f, 2.f/6.f));
-        verticesControlPoints->push_back(vec2(0, 8.f/6.f));
-        verticesControlPoints->push_back(vec2(0, -2.f/6.f));
-        verticesControlPoints->push_back(vec2(8.f/6.f, 4.f/6.f));
-
-        verticesControlPoints->push_back(vec2(5.f/6.f, 3.f/6.f));
-        verticesControlPoints->push_back(vec2(3.f/6.f, 2.f/6.f));
-        verticesControlPoints->push_back(vec2(3.f/6.f, 3.f/6.f));
-        verticesControlPoints->push_back(vec2(5.f/6.f, 2.f/6.f));
-
-        verticesControlPoints->push_back(vec2(3.f/6.f, 2.2/6.f));
-        verticesControlPoints->push_back(vec2(3.5/6.f, 2.7/6.f));
-        verticesControlPoints->push_back(vec2(3.5/6.f, 3.3/6.f));
-        verticesControlPoints->push_back(vec2(3.f/6.f, 3.8/6.f));
-
-        verticesControlPoints->push_back(vec2(2.8/6.f, 3.5/6.f));
-        verticesControlPoints->push_back(vec2(2.4/6.f, 3.8/6.f));
-        verticesControlPoints->push_back(vec2(2.4/6.f, 3.2/6.f));
-        verticesControlPoints->push_back(vec2(2.8/6.f, 3.5/6.f));
-        
-        for(int i = 0; i<verticesControlPoints->size();i++){
-                verticesControlPoints->at(i) = verticesControlPoints->at(i) - vec2(0.75, 0.5);
+        vector<TextureArraySlot> slots(SPRITE_IMAGES);
+        for(int i = 0; i < SPRITE_IMAGES; i++){
+                int size = 16 << (i % 3);
+                vec3 colour = vec3(0.3f) + 0.7f*vec3(unit(random), unit(random), unit(random));
+                vector<unsigned char> image = spriteImage(i % 4, size, colour);
+                array->Add(image.data(), size, size, &slots[i]);
         }
 
-        for(int i = 0; i<5; i++){
-                coloursControlPoints->push_back(vec3(1.0f, 0.0f, 0.0f));
-                coloursControlPoints->push_back(vec3(1.0f, 1.0f, 1.0f));
-                coloursControlPoints->push_back(vec3(1.0f, 1.0f, 1.0f));
-                coloursControlPoints->push_back(vec3(1.0f, 0.0f, 0.0f));
+        batch->Clear();
+        for(int i = 0; i < SPRITE_COUNT; i++){
+                const TextureArraySlot& slot = slots[random() % SPRITE_IMAGES];
+                float size = 0.02f + 0.06f*unit(random);
+                batch->Add(slot, vec2(2*unit(random) - 1, 2*unit(random) - 1), vec2(size));
         }
-        
+        cout << "sprites: " << batch->Count() << " of " << array->LayerCount() << " images in one draw, array grown "
+             << array->GrowCount() << " times to " << array->Capacity() << " layers" << endl;
 }
 
-// ==========================================================================
-// PROGRAM ENTRY POINT
+//RESIDENT SCENES
+//scenes 0-4 are built once on the scene builder thread and kept in GPU buffers, so a
+//switch is a pointer swap; scene 6 draws the mug of scene 0
+const int RESIDENT_SCENES = 5;
 
-int main(int argc, char *argv[])
+//buffer storage resident scenes may hold; past it the least recently shown are
+//released, keeping their CPU half so they come back without a rebuild
+const size_t RESIDENT_BUDGET = 64 << 20;
+
+struct ResidentScene
 {
-	// initialize the _FW windowing system
-	if (!glfwInit()) {
-		cout << "ERROR: GLFW failed to initialize, TERMINATING" << endl;
-		return -1;
-	}
-	glfwSetErrorCallback(ErrorCallback);
+        SceneData* data; //from the builder, 0 until the first build finishes
+        Geometry geometry;
+        ControlPointEditor editor;
+        bool uploaded;
+        double lastShown;
+
+        ResidentScene() : data(0), uploaded(false), lastShown(0)
+        {}
+};
 
-	// attempt to create a window with an OpenGL 4.1 core profile context
-	GLFWwindow *window = 0;
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-        glfwWindowHint(GLFW_SAMPLES, 4);
-	int width = 512, height = 512;
-	window = glfwCreateWindow(width, height, "CPSC 453 OpenGL Boilerplate", 0, 0);
-	if (!window) {
-		cout << "Program failed to create GLFW window, TERMINATING" << endl;
-		glfwTerminate();
-		return -1;
-	}
+int residentSlot(int id){
+        if(id == 6) return 0;
+        return id < RESIDENT_SCENES ? id : -1;
+}
 
-	// set keyboard callback function and make our context current (active)
-	glfwSetKeyCallback(window, KeyCallback);
+//runs on the builder thread: everything a scene needs before upload
+void buildScene(SceneData* data){
+        data->model = SceneModel(data->id);
+        if(data->id <= 1){
+                if(data->file.Open(sceneFileName(data->id)))
+                        for(size_t i = 0; i < data->file.PatchCount(); i++)
+                                data->bvh.AddSegment(data->file.Segment(i));
+        }else{
+                extractFont(&data->points, &data->colours, SCENE_FONTS[data->id - 2]);
+                data->bvh.AddPatches(data->points.data(), data->points.size());
+        }
+        data->bvh.Build();
+}
+
+void uploadResident(ResidentScene* scene){
+        SceneData* data = scene->data;
+        scene->geometry.model = data->model;
+        scene->editor.Clear();
+        if(data->file.IsOpen()){
+                LoadSceneFile(&scene->geometry, data->file);
+
+                //a dragged point is one vertex, seen by all three views
+                scene->editor.AddTarget(scene->geometry.vertexBuffer, data->file.Points(), data->file.PointCount(),
+                                        data->file.Indices(), 4*data->file.PatchCount());
+                scene->editor.Build();
+        }else{
+                LoadGeometry(&scene->geometry, data->points.data(), data->colours.data(), data->points.size());
+        }
+        scene->uploaded = true;
+}
+
+void releaseResident(ResidentScene* scene){
+        LoadGeometry(&scene->geometry, 0, 0, 0);
+        BindVertexArray(scene->geometry.vertexArray);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, 0, GL_STATIC_DRAW);
+        BindVertexArray(0);
+        CountGpuBuffer(MEMORY_SCENES, scene->geometry.elementBuffer, 0);
+        scene->editor.Clear();
+        scene->uploaded = false;
+}
+
+//releases the least recently shown scenes other than current until the rest fit the budget
+void enforceBudget(ResidentScene* scenes, const ResidentScene* current){
+        while(true){
+                size_t bytes = 0;
+                ResidentScene* oldest = 0;
+                for(int i = 0; i < RESIDENT_SCENES; i++){
+                        if(!scenes[i].uploaded) continue;
+                        bytes += scenes[i].data->GpuBytes();
+                        if(&scenes[i] != current && (!oldest || scenes[i].lastShown < oldest->lastShown))
+                                oldest = &scenes[i];
+                }
+                if(bytes <= RESIDENT_BUDGET || !oldest) return;
+                cout << "scene " << oldest->data->id << " released, " << bytes << " bytes resident" << endl;
+                releaseResident(oldest);
+        }
+}
+
+//RENDER THREAD
+//owns the GL context from set-up to clean-up; each frame draws the latest input
+//snapshot, returning when the window is closed or set-up fails
+int RenderLoop(GLFWwindow* window)
+{
 	glfwMakeContextCurrent(window);
 
 	//Intialize GLAD
@@ -581,17 +1239,83 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	// every program reads its view transform from the shared camera block
+	if (!camera.Initialize())
+		cout << "Program failed to initialize camera!" << endl;
+	camera.AttachProgram(program);
+	camera.AttachProgram(program2);
+	camera.AttachProgram(program3);
+
+        GLuint pathProgram = InitializePathShaders();
+	if (pathProgram == 0) {
+		cout << "Program could not initialize shaders, TERMINATING" << endl;
+		return -1;
+	}
+	camera.AttachProgram(pathProgram);
+
+        GLuint strokeProgram = InitializeStrokeShaders();
+	if (strokeProgram == 0) {
+		cout << "Program could not initialize shaders, TERMINATING" << endl;
+		return -1;
+	}
+	camera.AttachProgram(strokeProgram);
+
+        GLuint backgroundProgram = InitializeBackgroundShaders();
+	if (backgroundProgram == 0) {
+		cout << "Program could not initialize shaders, TERMINATING" << endl;
+		return -1;
+	}
+
+        GLuint spriteProgram = InitializeSpriteShaders();
+	if (spriteProgram == 0) {
+		cout << "Program could not initialize shaders, TERMINATING" << endl;
+		return -1;
+	}
+	camera.AttachProgram(spriteProgram);
+
+        //sprite images start in 4 layers, so filling the array also exercises its growth
+        TextureArray spriteArray;
+        SpriteBatch sprites;
+        if (!spriteArray.Initialize(SPRITE_LAYER_SIZE, SPRITE_LAYER_SIZE, 4) || !sprites.Initialize())
+		cout << "Program failed to initialize sprites!" << endl;
+
+        //the background is decoded on a worker and uploaded a few MB per frame
+        TextureLoader textures;
+        if (!textures.Initialize())
+		cout << "Program failed to initialize texture loader!" << endl;
+        TextureHandle background = backgroundFile.empty() ? NO_TEXTURE : textures.Load(backgroundFile);
+        GLuint backgroundArray;
+        glGenVertexArrays(1, &backgroundArray);
+
+        //frames are read back a few frames late and encoded on workers; --record draws
+        //into an offscreen target instead of the window and records from the first frame
+        FrameCapture capture;
+        if (!capture.Initialize())
+		cout << "Program failed to initialize frame capture!" << endl;
+        Offscreen offscreen;
+        bool offscreenMode = recordFrames > 0;
+        int recordedFrames = 0;
+        double recordStart = glfwGetTime();
+        if(offscreenMode){
+                if (!InitializeOffscreen(&offscreen, RECORD_WIDTH, RECORD_HEIGHT)) {
+                        cout << "Program could not create a " << RECORD_WIDTH << "x" << RECORD_HEIGHT
+                             << " offscreen framebuffer, TERMINATING" << endl;
+                        return -1;
+                }
+                BeginRecording(&capture, recordFormat);
+        }
 
+        //text laid along the mug; its arc length table is only rebuilt when the mug is edited
+        PathText pathText;
+        if (!pathText.Initialize())
+		cout << "Program failed to initialize path text!" << endl;
 
         //INITIAL VALUES FOR EVERYTHING
-        vector<vec2> vertices;
-	vector<vec3> colours;
-        vector<vec2> verticesControl;
-	vector<vec3> coloursControl;
-        vector<vec2> verticesControlPoints;
-	vector<vec3> coloursControlPoints;
-        vector<vec2> fontPoints;
-	vector<vec3> fontColors;
+        WorkloadGenerator workloadGenerator;
+        Workload workload;
+        WorkloadReport workloadReport;
+        int workloadFrames = 0;
+        bool workloadReported = false;
 
         int patchSize = 4;
         int lastScene = -1;
@@ -600,118 +1324,629 @@ int main(int argc, char *argv[])
              
 
 	// call function to create and fill buffers with geometry data
-	Geometry geometry;
-        Geometry geometryControl; //everything that has "Control" at the end refers to the control polygon
-        Geometry geometryControlPoints;
-        Geometry geometryGlyph;
+        ResidentScene residentScenes[RESIDENT_SCENES]; //patches, control polygon and control points all drawn from one vertex buffer
+        ResidentScene* current = 0; //the scene on screen, 0 for the document and workloads
+        Geometry geometryWorkload;
 
+        for(int i = 0; i < RESIDENT_SCENES; i++){
+                if (!InitializeVAO(&residentScenes[i].geometry))
+                        cout << "Program failed to intialize geometry!" << endl;
+        }
 
-        if (!InitializeVAO(&geometryGlyph))
+	if (!InitializeVAO(&geometryWorkload))
 		cout << "Program failed to intialize geometry!" << endl;
-
-	if(!LoadGeometry(&geometryGlyph, fontPoints.data(), fontColors.data(), fontPoints.size()))
-		cout << "Failed to load geometry" << endl;
 	
-	glPatchParameteri(GL_PATCH_VERTICES, patchSize);
+	SetPatchVertices(patchSize);
+
+        //input counters and sums as of the last frame; a change is a new press or scroll
+        InputState frameInput;
+        unsigned int leftPresses = 0, rightClicks = 0, workloadAdvances = 0, fontRebuilds = 0, recordToggles = 0;
+        double scrolledLines = 0;
+        vec2 dragCursor;
+
+        //every resident scene is built in the background, the first one shown first
+        SceneBuilder builder;
+        builder.Start(buildScene);
+        inputSnapshots.Acquire(&frameInput);
+        int firstScene = residentSlot(frameInput.sceneId) >= 0 ? residentSlot(frameInput.sceneId) : 0;
+        builder.Request(firstScene);
+        for(int i = 0; i < RESIDENT_SCENES; i++)
+                if(i != firstScene) builder.Request(i);
+
+        //frame time away from scene switches, for comparison with the switch frame
+        double steadyFrameTime = 0;
+
+        double lastFrameTime = glfwGetTime();
+        double lastMemoryReport = lastFrameTime;
+
+        // draw frames until the window closes; events are handled on the GLFW thread
+        SetPointSize(5);
+	while (!glfwWindowShouldClose(window))
+	{
+                //the latest input; snapshots published while the last frame was drawn are skipped
+                inputSnapshots.Acquire(&frameInput);
+                int sceneId = frameInput.sceneId;
+
+                if(offscreenMode){
+                        glBindFramebuffer(GL_FRAMEBUFFER, offscreen.framebuffer);
+                        glViewport(0, 0, offscreen.width, offscreen.height);
+                        frameInput.framebufferWidth = offscreen.width;
+                        frameInput.framebufferHeight = offscreen.height;
+                }else if(frameInput.recordToggles != recordToggles){
+                        recordToggles = frameInput.recordToggles;
+                        if(capture.Recording()) capture.End();
+                        else BeginRecording(&capture, CAPTURE_PNG);
+                }
 
-	if (!InitializeVAO(&geometry))
-		cout << "Program failed to intialize geometry!" << endl;
+                glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+
+                //the background shows up once its last band is in
+                textures.Update();
+                if(const MyTexture* image = textures.Texture(background))
+                        RenderBackground(backgroundProgram, backgroundArray, *image);
+
+                // the only per-frame upload is the 64 byte view matrix, and only when it moved
+                camera.SetView(frameInput.viewCentre, frameInput.viewZoom);
+                camera.Update();
+
+                //animated scenes move on the GPU: one uniform per program per frame
+                double now = glfwGetTime();
+                if(offscreenMode) animationTime += RECORD_FRAME_SECONDS;
+                else if(!frameInput.animationPaused) animationTime += now - lastFrameTime;
+                lastFrameTime = now;
+                for(GLuint animated : {program, program2, program3, strokeProgram})
+                        SetAnimationTime(animated, float(animationTime));
+
+                //finished builds are uploaded one per frame, so no frame pays for more than one
+                if(SceneData* built = builder.TakeFinished()){
+                        ResidentScene* resident = &residentScenes[built->id];
+                        if(resident == current) dragPoint = releasedPoint = -1;
+                        delete resident->data;
+                        resident->data = built;
+                        uploadResident(resident);
+                        cout << "scene " << built->id << " built in " << built->buildSeconds*1e3 << " ms, "
+                             << built->GpuBytes() << " bytes resident" << endl;
+                        enforceBudget(residentScenes, current);
+                }
 
-	if(!LoadGeometry(&geometry, vertices.data(), colours.data(), vertices.size()))
-		cout << "Failed to load geometry" << endl;
-	
-	glPatchParameteri(GL_PATCH_VERTICES, patchSize);
+                //k pressed again on the workload scene
+                if(frameInput.workloadAdvances != workloadAdvances){
+                        workloadIndex = (workloadIndex + int(frameInput.workloadAdvances - workloadAdvances)) % WORKLOAD_COUNT;
+                        workloadAdvances = frameInput.workloadAdvances;
+                        rebuildScene = true;
+                }
 
-        if (!InitializeVAO(&geometryControl))
-		cout << "Program failed to intialize geometry 2!" << endl;
+                //SCENE SELECTION
+                //resident scenes are a pointer swap; only the document and workloads build here
+                if(lastScene != sceneId || rebuildScene){
+                       rebuildScene = false;
+                       if(lastScene != sceneId) switchRequested = frameInput.sceneSwitchTime;
+
+                       if(sceneId == 5 && document.Empty()){ //document
+                                loadDocument(&document, documentFile);
+                       }else if(sceneId == 7){ //synthetic workload, generated and uploaded under the clock
+                                const WorkloadConfig& config = WORKLOADS[workloadIndex];
+                                if(config.glyphs > 0) workloadGenerator.LoadFonts("boilerplate");
+                                workloadGenerator.Generate(config, 453 + workloadIndex, &workload);
+
+                                glFinish();
+                                double start = glfwGetTime();
+                                LoadWorkload(&geometryWorkload, workload);
+                                glFinish();
+                                workloadReport = WorkloadReport();
+                                workloadReport.uploadSeconds = glfwGetTime() - start;
+                                workloadFrames = 0;
+                                workloadReported = false;
+
+                                //the GPU has its copy; 10M patches are 320 MB on the CPU side too
+                                vector<vec2>().swap(workload.vertices);
+                       }
+                       if(sceneId != 7 && geometryWorkload.elementCount > 0){
+                                LoadWorkload(&geometryWorkload, Workload()); //release the GPU copy
+                       }
+                       if(sceneId == 8 && sprites.Count() == 0){
+                                buildSprites(&spriteArray, &sprites);
+                       }
+                       if(sceneId == 6 && pathText.TextLength() == 0){
+                                FontSet fonts;
+                                if(fonts.AddFonts(FONT_CHAIN))
+                                        pathText.SetText("Bézier curves all the way around the mug ~ ", fonts, 0.06f);
+                       }
+
+                       current = residentSlot(sceneId) >= 0 ? &residentScenes[residentSlot(sceneId)] : 0;
+                       dragPoint = releasedPoint = -1;
+                       lastScene = sceneId;
+                }
 
-        if(!LoadGeometry(&geometryControl, verticesControl.data(), coloursControl.data(), verticesControl.size()))
-		cout << "Failed to load geometry" << endl;
+                //the font scenes are rebuilt in the background; the old ones stay on screen until then
+                if(frameInput.fontRebuilds != fontRebuilds){
+                        outlineTolerance = frameInput.outlineTolerance;
+                        for(int i = 2; i <= 4; i++)
+                                builder.Request(i);
+                        fontRebuilds = frameInput.fontRebuilds;
+                }
 
-        if (!InitializeVAO(&geometryControlPoints))
-		cout << "Program failed to intialize geometry 3!" << endl;
+                if(frameInput.scrollLines != scrolledLines){
+                        if(sceneId == 5) document.Scroll(frameInput.scrollLines - scrolledLines);
+                        scrolledLines = frameInput.scrollLines;
+                }
 
-        if(!LoadGeometry(&geometryControlPoints, verticesControlPoints.data(), coloursControlPoints.data(), verticesControlPoints.size()))
-		cout << "Failed to load geometry" << endl;
+                //a scene released for the budget comes back from its CPU half
+                if(current && current->data && !current->uploaded){
+                        uploadResident(current);
+                        enforceBudget(residentScenes, current);
+                }
+                bool ready = current && current->uploaded;
+                if(current) current->lastShown = glfwGetTime();
+                sceneBVH = ready ? &current->data->bvh : &noBVH;
+                editor = ready ? &current->editor : &noEditor;
+                if(ready) sceneModel = current->geometry.model;
+
+                //a left press grabs the control point under it, if any; the GLFW thread
+                //pans instead when told there was none
+                if(frameInput.leftPresses != leftPresses){
+                        leftPresses = frameInput.leftPresses;
+                        dragPoint = editor->Pick(NdcToObject(frameInput.leftPressCursor), PickRadius());
+                        dragCursor = frameInput.leftPressCursor;
+
+                        PressResult result;
+                        result.press = leftPresses;
+                        result.onPoint = (dragPoint >= 0);
+                        pressResults.Publish(result);
+                        glfwPostEmptyEvent();
+                }
+                if(dragPoint >= 0 && !frameInput.leftDown){
+                        releasedPoint = dragPoint;
+                        dragPoint = -1;
+                }else if(dragPoint >= 0 && frameInput.cursor != dragCursor){
+                        editor->Move(dragPoint, NdcToObject(frameInput.cursor));
+                        dragCursor = frameInput.cursor;
+                }
 
+                //right click reports what is under the cursor
+                if(frameInput.rightClicks != rightClicks){
+                        rightClicks = frameInput.rightClicks;
+                        vec2 p = NdcToObject(frameInput.rightClickCursor);
 
+                        int segment, point;
+                        if(sceneBVH->SegmentCount() > 0){
+                                if(sceneBVH->PickControlPoint(p, PickRadius(), &segment, &point))
+                                        cout << "control point " << point << " of segment " << segment << endl;
 
-        // run an event-triggered main loop
-        glPointSize(5);
-	while (!glfwWindowShouldClose(window))
-	{
-                glUseProgram(program);                
-
-                if(lastScene != sceneId){
-                       cout<<"changing"<<endl;
-                       glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-	               glClear(GL_COLOR_BUFFER_BIT);
-                       vertices.clear();
-                       colours.clear();
-                       verticesControl.clear();
-                       coloursControl.clear();
-                       verticesControlPoints.clear();
-                       coloursControlPoints.clear();
-                       fontPoints.clear();
-                       fontColors.clear();
-                       
-                       lastScene = sceneId;        
+                                CurveHit hit = sceneBVH->Nearest(p);
+                                cout << "nearest curve: segment " << hit.segment << " at t=" << hit.t
+                                     << ", distance " << hit.distance << endl;
+                                if(sceneBVH->Inside(p)) cout << "inside" << endl;
+                        }
                 }
 
-                 //SCENE SELECTION
-                if(sceneId == 0){ //mug
-                        mug(&vertices, &colours, &verticesControl, &coloursControl, &verticesControlPoints, &coloursControlPoints);
-                        patchSize = 4;
-                        LoadGeometry(&geometry, vertices.data(), colours.data(), vertices.size());
-                        glPatchParameteri(GL_PATCH_VERTICES, patchSize);
-                        LoadGeometry(&geometryControl, verticesControl.data(), coloursControl.data(), verticesControl.size());
-                        LoadGeometry(&geometryControlPoints, verticesControlPoints.data(), coloursControlPoints.data(), verticesControlPoints.size());
-                        RenderScene(&geometry, program, 0);
-                        RenderScene(&geometryControl, program2, 1);
-                        RenderScene(&geometryControlPoints, program3, 2);
-                       
-     
-                }else if(sceneId == 1){ //fish
-                        fish(&vertices, &colours, &verticesControl, &coloursControl, &verticesControlPoints, &coloursControlPoints);
-                        patchSize = 4;
-                        LoadGeometry(&geometry, vertices.data(), colours.data(), vertices.size());
-                        glPatchParameteri(GL_PATCH_VERTICES, patchSize);
-                        LoadGeometry(&geometryControl, verticesControl.data(), coloursControl.data(), verticesControl.size());
-                        LoadGeometry(&geometryControlPoints, verticesControlPoints.data(), coloursControlPoints.data(), verticesControlPoints.size());
-                        RenderScene(&geometry, program, 0);
-                        RenderScene(&geometryControl, program2, 1);
-                        RenderScene(&geometryControlPoints, program3, 2);
-                        
-                }else if(sceneId == 2){ //sans
-                        extractFont(&fontPoints, &fontColors, "SourceSansPro-Regular.otf");
-                        LoadGeometry(&geometryGlyph, fontPoints.data(), fontColors.data(), fontPoints.size());
-                        RenderScene(&geometryGlyph, program, 0);
-                }else if(sceneId == 3){ //lora
-                        extractFont(&fontPoints, &fontColors, "Lora-Regular.ttf");
-                        LoadGeometry(&geometryGlyph, fontPoints.data(), fontColors.data(), fontPoints.size()); 
-                        RenderScene(&geometryGlyph, program, 0);               
-                }else if(sceneId == 4){ //inconsolata
-                        extractFont(&fontPoints, &fontColors, "Inconsolata.otf");
-                        LoadGeometry(&geometryGlyph, fontPoints.data(), fontColors.data(), fontPoints.size()); 
-                        RenderScene(&geometryGlyph, program, 0);               
+                //only the vertex ranges touched by a drag are re-uploaded
+                editor->Flush();
+                if(releasedPoint >= 0 && ready){
+                        const SceneFile& file = current->data->file;
+                        editor->ForEachPatch(releasedPoint, [&](int patch){
+                                sceneBVH->UpdateSegment(patch, file.Segment(patch));
+                        });
+                        sceneBVH->Refit();
+                        releasedPoint = -1;
                 }
 
+                //thick outlines swap in the stroke program; its width is in pixels
+                GLuint curveProgram = program;
+                if(frameInput.stroke.width > 0){
+                        UseStrokeStyle(strokeProgram, frameInput.stroke, frameInput.framebufferWidth, frameInput.framebufferHeight);
+                        curveProgram = strokeProgram;
+                        SetBlend(true);
+                        SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                }
 
-		glfwSwapBuffers(window);
+                if(ready && current->data->file.IsOpen()){ //mug or fish
+                        const SceneFile& file = current->data->file;
+                        SetPatchVertices(patchSize);
+                        RenderSceneFile(&current->geometry, file, curveProgram, 0);
+                        SetBlend(false);
+                        RenderSceneFile(&current->geometry, file, program2, 1);
+                        RenderSceneFile(&current->geometry, file, program3, 2);
+                        if(sceneId == 6){ //text sliding along the mug, one uniform per frame
+                                pathText.SetPath(mugPath(file));
+                                pathText.Render(pathProgram, 0.15f*float(animationTime), current->geometry.model);
+                        }
+                }else if(ready){ //fonts
+                        RenderScene(&current->geometry, curveProgram, 0);
+                }else if(sceneId == 5){ //document
+                        //a new width or setting re-breaks the paragraphs around the view from cached word widths
+                        if(frameInput.wrapWidth != document.WrapWidth() || frameInput.alignment != document.Alignment() ||
+                           frameInput.lineBreaking != document.Breaking()){
+                                double start = glfwGetTime();
+                                size_t broken = document.SetWrapWidth(frameInput.wrapWidth);
+                                broken += document.SetAlignment(frameInput.alignment);
+                                broken += document.SetLineBreaking(frameInput.lineBreaking);
+                                cout << "document re-flowed to " << document.WrapWidth() << " EMs, "
+                                     << TextAlignmentName(document.Alignment()) << ", " << LineBreakingName(document.Breaking())
+                                     << " breaks: " << broken << " paragraphs in " << (glfwGetTime() - start)*1e3 << " ms" << endl;
+                        }
+                        document.SetViewHeight(2.0f/camera.Zoom());
+                        document.Update();
+                        document.Render(curveProgram);
+                }else if(sceneId == 8){ //sprites
+                        sprites.Render(spriteProgram, &spriteArray, mat4(1.0f));
+                }else if(sceneId == 7){ //workload: after a warm-up, frames are timed to glFinish until reported
+                        bool timing = !workloadReported && workloadFrames >= WORKLOAD_WARMUP_FRAMES;
+                        double start = glfwGetTime();
+                        RenderWorkload(&geometryWorkload, curveProgram, vec3(1.0f, 0.0f, 1.0f));
+                        if(timing){
+                                glFinish();
+                                workloadReport.frameSeconds += glfwGetTime() - start;
+                                workloadReport.frames++;
+                        }
+                        workloadFrames++;
+
+                        if(timing && (workloadReport.frames == WORKLOAD_TIMED_FRAMES || workloadReport.frameSeconds >= WORKLOAD_TIMED_SECONDS)){
+                                workloadReport.frameSeconds /= workloadReport.frames;
+                                workloadReport.Print(workload);
+                                workloadReported = true;
 
-		glfwPollEvents();
+                                if(benchmarkWorkloads){
+                                        if(workloadIndex + 1 == WORKLOAD_COUNT) glfwSetWindowShouldClose(window, GL_TRUE);
+                                        else { workloadIndex++; rebuildScene = true; }
+                                }
+                        }
+                }
+                SetBlend(false);
+
+                if(frameInput.slowFrames)
+                        this_thread::sleep_for(chrono::duration<double>(SLOW_FRAME_SECONDS));
+
+                //read back before the swap, while the frame is still in the back buffer
+                if(offscreenMode){
+                        ResolveOffscreen(offscreen);
+                        capture.Capture(offscreen.width, offscreen.height);
+                        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                        if(++recordedFrames == recordFrames) glfwSetWindowShouldClose(window, GL_TRUE);
+                }else{
+                        capture.Capture(frameInput.framebufferWidth, frameInput.framebufferHeight);
+                        glfwSwapBuffers(window);
+                }
+
+                //switch latency: key press to the first frame showing the new scene,
+                //against the typical frame
+                double frameTime = glfwGetTime() - now;
+                if(switchRequested >= 0 && (ready || !current)){
+                        cout << "switch to scene " << sceneId << ": " << (glfwGetTime() - switchRequested)*1e3
+                             << " ms from key press, frame " << frameTime*1e3 << " ms (steady "
+                             << steadyFrameTime*1e3 << " ms)" << endl;
+                        switchRequested = -1;
+                }else if(switchRequested < 0){
+                        steadyFrameTime = steadyFrameTime > 0 ? 0.95*steadyFrameTime + 0.05*frameTime : frameTime;
+                }
+
+                if(now - lastMemoryReport >= MEMORY_REPORT_SECONDS && MemoryChangedSinceReport()){
+                        PrintMemoryReport("after " + to_string(int(now)) + " s");
+                        lastMemoryReport = now;
+                }
 	}
 
+	if(offscreenMode){
+		double seconds = glfwGetTime() - recordStart;
+		cout << recordedFrames << " frames drawn at " << offscreen.width << "x" << offscreen.height << " in "
+		     << seconds << " s (" << recordedFrames/seconds << " frames/s)" << endl;
+		DestroyOffscreen(&offscreen);
+	}
+	capture.Destroy();
+
 	// clean up allocated resources before exit
-	DestroyGeometry(&geometry);
-	glUseProgram(0);
-	glDeleteProgram(program);
+	builder.Stop();
+	for(int i = 0; i < RESIDENT_SCENES; i++){
+		DestroyGeometry(&residentScenes[i].geometry);
+		delete residentScenes[i].data;
+	}
+	DestroyGeometry(&geometryWorkload);
+	document.Destroy();
+	pathText.Destroy();
+	textures.Destroy();
+	sprites.Destroy();
+	spriteArray.Destroy();
+	DeleteProgram(spriteProgram);
+	DeleteVertexArrays(1, &backgroundArray);
+	DeleteProgram(backgroundProgram);
+	camera.Destroy();
+	UseProgram(0);
+	DeleteProgram(program);
+	DeleteProgram(pathProgram);
+	DeleteProgram(strokeProgram);
+
+	//peaks are the session's highs; what is still counted now was not released
+	PrintMemoryReport("at exit, after clean-up");
+	PrintGLStateCounts("at exit");
+	return 0;
+}
+
+// ==========================================================================
+// MICROBENCHMARKS
+// run by bench.out (make bench), which builds this file without main()
+
+//text the layout benchmarks lay out, about a screenful of the document scene
+const size_t LAYOUT_BENCH_BYTES = 4096;
+
+//every weight of the font families shipped in boilerplate/
+const char* BENCH_FONT_DIRECTORIES[] = {"boilerplate/alex-brush", "boilerplate/lora", "boilerplate/source-sans-pro"};
+
+vector<string> benchFonts(){
+        vector<string> fonts;
+        for(const char* directory : BENCH_FONT_DIRECTORIES){
+                vector<string> found = FindFontFiles(directory);
+                if(found.empty()) cout << "no fonts in " << directory << endl;
+                fonts.insert(fonts.end(), found.begin(), found.end());
+        }
+        return fonts;
+}
+
+//times glyph extraction, scene building and, when a GL context is current, geometry upload
+void runMicrobenchmarks(Microbench* bench, bool gl){
+        //fonts: opening the face, then every printable ASCII glyph
+        for(const string& path : benchFonts()){
+                string font = path.substr(path.rfind('/') + 1);
+                GlyphExtractor extractor;
+                bench->Run("font/load/" + font, [&](){ extractor.LoadFontFile(path); }, 1, "fonts");
+                if(!extractor.LoadFontFile(path)) continue;
+                bench->Run("font/extract/" + font, [&](){
+                        for(int character = 32; character < 127; character++) extractor.ExtractGlyph(character);
+                }, 95, "glyphs");
+        }
+
+        //the font scenes, fallback chain and all, into fresh arrays as the builder does
+        for(const char* font : SCENE_FONTS){
+                ScenePoints points;
+                SceneColours colours;
+                extractFont(&points, &colours, font);
+                bench->Run(string("scene/extractFont/") + font, [&](){
+                        ScenePoints benchPoints;
+                        SceneColours benchColours;
+                        extractFont(&benchPoints, &benchColours, font);
+                }, points.size()/4, "patches");
+        }
+
+        //mug and fish: converting the text source, then the builder's mapping and BVH
+        const char* SCENE_NAMES[] = {"mug", "fish"};
+        for(int id = 0; id <= 1; id++){
+                string name = SCENE_NAMES[id];
+                SceneFile scene;
+                size_t patches = scene.Open(sceneFileName(id)) ? scene.PatchCount() : 0;
+                //into memory, so nothing is written to the tree and the time is the conversion's
+                string converted;
+                bench->Run("scene/convert/" + name, [&](){
+                        vector<SceneShapeSource> shapes;
+                        if(ParseScene("scenes/" + name + ".txt", &shapes)) EncodeScene(shapes, &converted);
+                }, patches, "patches");
+                bench->Run("scene/build/" + name, [&](){
+                        SceneData data(id);
+                        buildScene(&data);
+                }, patches, "patches");
+        }
+
+        //paragraph layout over a screen of the document scene's text: laid out from scratch,
+        //then re-flowed to another width each trial from the cached word widths
+        FontSet layoutFonts;
+        if(layoutFonts.AddFonts(FONT_CHAIN)){
+                string readmes;
+                for(const char* name : {"README", "ASSIGNMENT README.txt"}){
+                        ifstream input(name);
+                        readmes.append(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+                }
+                vector<pair<size_t, size_t> > paragraphs;
+                for(size_t start = 0, end; start < readmes.size() && start < LAYOUT_BENCH_BYTES; start = end + 1){
+                        end = std::min(readmes.find('\n', start), readmes.size());
+                        paragraphs.push_back(make_pair(start, end));
+                }
+
+                bench->Run("layout/measure", [&](){
+                        ParagraphLayout layout;
+                        layout.SetFonts(&layoutFonts);
+                        layout.SetText(readmes);
+                        for(const pair<size_t, size_t>& paragraph : paragraphs) layout.AddParagraph(paragraph.first, paragraph.second);
+                        layout.Update();
+                }, paragraphs.size(), "paragraphs");
+
+                ParagraphLayout layout;
+                layout.SetFonts(&layoutFonts);
+                layout.SetText(readmes);
+                for(const pair<size_t, size_t>& paragraph : paragraphs) layout.AddParagraph(paragraph.first, paragraph.second);
+                layout.Update();
+                const LineBreaking BREAKINGS[] = {BREAK_GREEDY, BREAK_OPTIMAL, BREAK_OPTIMAL};
+                const TextAlignment ALIGNMENTS[] = {ALIGN_LEFT, ALIGN_LEFT, ALIGN_JUSTIFIED};
+                for(int i = 0; i < 3; i++){
+                        layout.SetLineBreaking(BREAKINGS[i]);
+                        layout.SetAlignment(ALIGNMENTS[i]);
+                        int trial = 0;
+                        bench->Run(string("layout/reflow/") + LineBreakingName(BREAKINGS[i]) + "/" + TextAlignmentName(ALIGNMENTS[i]), [&](){
+                                layout.SetWidth(DOCUMENT_WRAP_WIDTH - WRAP_WIDTH_STEP*(++trial % 2));
+                                layout.Update();
+                        }, paragraphs.size(), "paragraphs");
+                }
+        }
+
+        //uploads finish with glFinish, so the rate is what reaches the GPU
+        if(gl){
+                Geometry geometry;
+                InitializeVAO(&geometry);
+                mt19937 random(453);
+                uniform_real_distribution<float> unit(-1.0f, 1.0f);
+                for(int vertices : {4096, 1 << 20}){
+                        vector<vec2> points(vertices);
+                        vector<vec3> colours(vertices);
+                        for(int i = 0; i < vertices; i++){
+                                points[i] = vec2(unit(random), unit(random));
+                                colours[i] = vec3(unit(random), unit(random), unit(random));
+                        }
+                        double megabytes = vertices*(sizeof(vec2) + sizeof(vec3))/1e6;
+                        bench->Run("gl/LoadGeometry/" + to_string(vertices), [&](){
+                                LoadGeometry(&geometry, points.data(), colours.data(), vertices);
+                                glFinish();
+                        }, megabytes, "MB");
+                }
+                DestroyGeometry(&geometry);
+        }
+
+        //the default document scrolled to its end, then re-flowed to another width each trial:
+        //only the paragraphs around the view are broken again, and their lines uploaded
+        const LineBreaking DOCUMENT_BREAKINGS[] = {BREAK_GREEDY, BREAK_OPTIMAL};
+        const TextAlignment DOCUMENT_ALIGNMENTS[] = {ALIGN_LEFT, ALIGN_JUSTIFIED};
+        string documentBenchmarks[2];
+        for(int i = 0; i < 2; i++)
+                documentBenchmarks[i] = string("gl/document/reflow-at-end/") + LineBreakingName(DOCUMENT_BREAKINGS[i]) + "/" +
+                                        TextAlignmentName(DOCUMENT_ALIGNMENTS[i]);
+        if(gl && (bench->Selected(documentBenchmarks[0]) || bench->Selected(documentBenchmarks[1]))){
+                Document benchDocument;
+                loadDocument(&benchDocument, "");
+                benchDocument.SetViewHeight(2.0f);
+                benchDocument.Scroll(1e12);
+                benchDocument.Update();
+                for(int i = 0; i < 2; i++){
+                        benchDocument.SetLineBreaking(DOCUMENT_BREAKINGS[i]);
+                        benchDocument.SetAlignment(DOCUMENT_ALIGNMENTS[i]);
+                        int trial = 0;
+                        bench->Run(documentBenchmarks[i], [&](){
+                                benchDocument.SetWrapWidth(DOCUMENT_WRAP_WIDTH - WRAP_WIDTH_STEP*(++trial % 2));
+                                benchDocument.Update();
+                                glFinish();
+                        }, 1, "re-flows");
+                }
+                cout << "document re-flow: " << benchDocument.ParagraphsResident() << " paragraphs and "
+                     << benchDocument.LinesResident() << " lines resident" << endl;
+                benchDocument.Destroy();
+        }
+}
+
+// ==========================================================================
+// PROGRAM ENTRY POINT
+
+//--simplify without font files: the script face and every Source Sans Pro weight
+const char* SIMPLIFY_FONT_DIRECTORIES[] = {"boilerplate/alex-brush", "boilerplate/source-sans-pro"};
+
+#ifndef BOILERPLATE_NO_MAIN
+int main(int argc, char *argv[])
+{
+	// command line tools that run without a window
+	if (argc > 1 && string(argv[1]) == "--bench-bezier") {
+		BenchmarkBezierBatch();
+		return 0;
+	}
+	if (argc > 3 && string(argv[1]) == "--cpu-render")
+		return renderSceneCpu(atoi(argv[2]), argv[3]);
+	if (argc > 3 && string(argv[1]) == "--convert-scene")
+		return ConvertScene(argv[2], argv[3]) ? 0 : -1;
+	if (argc > 3 && string(argv[1]) == "--convert-svg")
+		return ConvertSvgToScene(argv[2], argv[3]) ? 0 : -1;
+	if (argc > 3 && string(argv[1]) == "--convert-texture") {
+		BlockFormat format = BLOCK_FORMAT_COUNT;
+		if (argc > 4 && !ParseBlockFormat(argv[4], &format)) {
+			cout << "unknown block format " << argv[4] << ", expected bc1, bc3, bc4 or bc5" << endl;
+			return -1;
+		}
+		return ConvertTexture(argv[2], argv[3], format) ? 0 : -1;
+	}
+	if (argc > 1 && string(argv[1]) == "--bench-svg") {
+		BenchmarkSvgImport(argc > 2 ? atoi(argv[2]) : 256);
+		return 0;
+	}
+	if (argc > 1 && string(argv[1]) == "--bench-workload")
+		benchmarkWorkloads = true;
+	if (argc > 1 && argv[1][0] != '-')
+		documentFile = argv[1];
+	if (argc > 2 && string(argv[1]) == "--background") {
+		backgroundFile = argv[2];
+		if (argc > 3) documentFile = argv[3];
+	}
+	if (argc > 2 && string(argv[1]) == "--record") {
+		recordFrames = std::max(atoi(argv[2]), 1);
+		if (argc > 3) input.sceneId = atoi(argv[3]);
+		if (argc > 4 && string(argv[4]) == "ppm") recordFormat = CAPTURE_PPM;
+		else if (argc > 4 && string(argv[4]) != "png") {
+			cout << "unknown frame format " << argv[4] << ", expected png or ppm" << endl;
+			return -1;
+		}
+	}
+	if (argc > 2 && string(argv[1]) == "--simplify") {
+		vector<string> fonts(argv + 3, argv + argc);
+		if (fonts.empty()) {
+			for (const char* directory : SIMPLIFY_FONT_DIRECTORIES) {
+				vector<string> found = FindFontFiles(directory);
+				fonts.insert(fonts.end(), found.begin(), found.end());
+			}
+		}
+		ReportSimplification(fonts, atof(argv[2]));
+		return 0;
+	}
+
+	// initialize the _FW windowing system
+	if (!glfwInit()) {
+		cout << "ERROR: GLFW failed to initialize, TERMINATING" << endl;
+		return -1;
+	}
+	glfwSetErrorCallback(ErrorCallback);
+
+	// attempt to create a window with an OpenGL 4.1 core profile context
+	GLFWwindow *window = 0;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_SAMPLES, 4);
+	// --record draws offscreen, the window only holds the context
+	if (recordFrames > 0) glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	int width = 512, height = 512;
+	window = glfwCreateWindow(width, height, "CPSC 453 OpenGL Boilerplate", 0, 0);
+	if (!window) {
+		cout << "Program failed to create GLFW window, TERMINATING" << endl;
+		glfwTerminate();
+		return -1;
+	}
+
+	// set keyboard and mouse callback functions; the context is made current on the render thread
+	glfwSetKeyCallback(window, KeyCallback);
+	glfwSetMouseButtonCallback(window, MouseButtonCallback);
+	glfwSetCursorPosCallback(window, CursorPosCallback);
+	glfwSetScrollCallback(window, ScrollCallback);
+	// the render thread takes the context; this thread only turns events into
+	// input snapshots, so input is never held up by a slow frame
+	if (benchmarkWorkloads) input.sceneId = 7;
+	glfwGetFramebufferSize(window, &input.framebufferWidth, &input.framebufferHeight);
+	inputSnapshots.Publish(input);
+
+	int result = 0;
+	thread renderer([&]() {
+		result = RenderLoop(window);
+		glfwMakeContextCurrent(0);
+
+		// however the render thread stops (finished benchmark, failed set-up), the window closes
+		glfwSetWindowShouldClose(window, GL_TRUE);
+		glfwPostEmptyEvent();
+	});
+
+	// sleep until events arrive, then publish what they changed
+	while (!glfwWindowShouldClose(window))
+	{
+		glfwWaitEvents();
+
+		PressResult press;
+		pressResults.Acquire(&press);
+		ApplyPressResult(press);
+
+		input.viewCentre = inputView.Centre();
+		input.viewZoom = inputView.Zoom();
+		glfwGetFramebufferSize(window, &input.framebufferWidth, &input.framebufferHeight);
+		inputSnapshots.Publish(input);
+	}
+	renderer.join();
+
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
 	cout << "Goodbye!" << endl;
-	return 0;
+	return result;
 }
+#endif // BOILERPLATE_NO_MAIN
 
 // ==========================================================================
 // SUPPORT FUNCTION DEFINITIONS
@@ -808,7 +2043,7 @@ GLuint CompileShader(GLenum shaderType, const string &source)
 }
 
 // creates and returns a program object linked from vertex and fragment shaders
-GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader, GLuint tesShader)
+GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader, GLuint tesShader, GLuint gsShader)
 {
 	// allocate program object name
 	GLuint programObject = glCreateProgram();
@@ -818,6 +2053,7 @@ GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader,
 	if (fragmentShader) glAttachShader(programObject, fragmentShader);
 	if (tcsShader) glAttachShader(programObject, tcsShader);
 	if (tesShader) glAttachShader(programObject, tesShader);
+	if (gsShader) glAttachShader(programObject, gsShader);
 
 	// try linking the program with given attachments
 	glLinkProgram(programObject);
@@ -834,6 +2070,7 @@ GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, GLuint tcsShader,
 		cout << "ERROR linking shader program:" << endl;
 		cout << info << endl;
 	}
+	else CacheUniformLocations(programObject);
 
 	return programObject;
 }
@@ -1,4 +1,7 @@
 #include "texture.h"
+#include "CompressedTexture.h"
+#include "GLState.h"
+#include "MemoryAccount.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 #include <iostream>
@@ -35,8 +38,51 @@ MyTexture::MyTexture() : textureID(0), target(0), width(0), height(0)
 	{}
 
 
+// uploads every level of a KTX or DDS file as it is stored, with no decoding
+static bool InitializeCompressedTexture(MyTexture* texture, const char* filename, GLenum target)
+{
+	CompressedImage image;
+	if (!LoadCompressedImage(filename, &image))
+		return false;
+
+	if (!BlockFormatSupported(image.format)) {
+		cout << "S3TC textures are not supported here, cannot load " << filename << endl;
+		return false;
+	}
+	if (target != GL_TEXTURE_2D) {
+		cout << "Compressed textures must be GL_TEXTURE_2D: " << filename << endl;
+		return false;
+	}
+
+	texture->target = target;
+	texture->width = image.levels[0].width;
+	texture->height = image.levels[0].height;
+	glGenTextures(1, &texture->textureID);
+	BindTexture(texture->target, texture->textureID);
+
+	GLenum format = BlockInternalFormat(image.format);
+	for (size_t i = 0; i < image.levels.size(); i++) {
+		const CompressedLevel& level = image.levels[i];
+		glCompressedTexImage2D(texture->target, i, format, level.width, level.height, 0, level.data.size(), level.data.data());
+	}
+	CountGpuTexture(MEMORY_TEXTURES, texture->textureID, image.Bytes());
+
+	// the chain may stop short of 1x1; sampling must not look past its last level
+	glTexParameteri(texture->target, GL_TEXTURE_MAX_LEVEL, image.levels.size() - 1);
+	glTexParameteri(texture->target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(texture->target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(texture->target, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(texture->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	BindTexture(texture->target, 0);
+
+	return !CheckGLErrors( (string("Loading texture: ")+filename).c_str() );
+}
+
 bool InitializeTexture(MyTexture* texture, const char* filename, GLenum target)
 {
+	if (IsCompressedTextureFile(filename))
+		return InitializeCompressedTexture(texture, filename, target);
+
 	int numComponents;
 	stbi_set_flip_vertically_on_load(true);
 	unsigned char *data = stbi_load(filename, &texture->width, &texture->height, &numComponents, 0);
@@ -46,7 +92,7 @@ bool InitializeTexture(MyTexture* texture, const char* filename, GLenum target)
 
 		texture->target = target;
 		glGenTextures(1, &texture->textureID);
-		glBindTexture(texture->target, texture->textureID);
+		BindTexture(texture->target, texture->textureID);
 
 		//Set number of components by format of the texture
 		GLuint format = GL_RGB;
@@ -70,6 +116,7 @@ bool InitializeTexture(MyTexture* texture, const char* filename, GLenum target)
 		};
 		//Loads texture data into bound texture
 		glTexImage2D(texture->target, 0, format, texture->width, texture->height, 0, format, GL_UNSIGNED_BYTE, data);
+		CountGpuTexture(MEMORY_TEXTURES, texture->textureID, TextureBytes(texture->width, texture->height, 1, numComponents, false));
 
 		//Modifies behaviour for bound texture
 		// Note: Only wrapping modes supported for GL_TEXTURE_RECTANGLE when defining
@@ -80,7 +127,7 @@ bool InitializeTexture(MyTexture* texture, const char* filename, GLenum target)
 		glTexParameteri(texture->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 		// Clean up
-		glBindTexture(texture->target, 0);
+		BindTexture(texture->target, 0);
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//Return to default alignment
 		stbi_image_free(data);
 
@@ -93,7 +140,8 @@ bool InitializeTexture(MyTexture* texture, const char* filename, GLenum target)
 // deallocate texture-related objects
 void DestroyTexture(MyTexture *texture)
 {
-	glBindTexture(texture->target, 0);
-	glDeleteTextures(1, &texture->textureID);
+	BindTexture(texture->target, 0);
+	ForgetGpuTexture(texture->textureID);
+	DeleteTextures(1, &texture->textureID);
 }
 
@@ -23,6 +23,8 @@ struct MyTexture
 //	Sets default behaviour texture, wrapping behaviour, etc...
 //		You may want to change this depending on your needs
 //	Loads bytes into texture object
+//Files ending in .ktx or .dds hold BC1, BC3, BC4 or BC5 blocks with their mip
+//chain (see CompressedTexture.h); they are uploaded as they are, compressed
 // ARGS:
 //	texture - Properties of created texture is returned here
 //	filename - Name of image file to create texture from
@@ -0,0 +1,17 @@
+// ==========================================================================
+// Fragment program for the background image
+// ==========================================================================
+#version 410
+
+// interpolated texture coordinates received from the vertex stage
+in vec2 TextureCoordinates;
+
+// the image, loaded by the TextureLoader
+uniform sampler2D image;
+
+out vec4 FragmentColour;
+
+void main(void)
+{
+    FragmentColour = texture(image, TextureCoordinates);
+}
@@ -0,0 +1,18 @@
+// ==========================================================================
+// Vertex program for the background image
+//
+// Draws a quad over the whole window from gl_VertexID alone, so it needs no
+// vertex buffer; the view transform is not applied.
+// ==========================================================================
+#version 410
+
+// texture coordinates to be interpolated and passed to the fragment stage
+out vec2 TextureCoordinates;
+
+void main()
+{
+    // a triangle strip through the corners (0,0), (1,0), (0,1), (1,1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    TextureCoordinates = corner;
+    gl_Position = vec4(2.0 * corner - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,48 @@
+// ==========================================================================
+// Vertex program for text laid along a Bezier path
+//
+// Each vertex is a glyph patch control point in glyph-local coordinates,
+// tagged with the arc length of its glyph's centre. The curve frame at that
+// arc length is read from a table built on the CPU (see TextOnPath.cpp),
+// and the glyph is rotated onto the tangent and moved to the curve point.
+// ==========================================================================
+#version 410
+
+// location indices for these attributes correspond to those specified in
+// PathText::Initialize()
+layout(location = 0) in vec2 VertexPosition;
+layout(location = 1) in vec3 VertexColour;
+layout(location = 2) in float GlyphCentre;
+
+// frames (position, unit tangent) at evenly spaced arc lengths along the path
+uniform samplerBuffer arcTable;
+uniform float pathLength;
+
+// arc length the whole string has slid along the path
+uniform float shift;
+
+// output to be passed to the tessellation stages
+out vec3 tcColour;
+
+// linearly interpolated frame at arc length s
+vec4 FrameAt(float s)
+{
+    int last = textureSize(arcTable) - 1;
+    float f = clamp(s / pathLength, 0.0, 1.0) * float(last);
+    int i = min(int(f), last - 1);
+    return mix(texelFetch(arcTable, i), texelFetch(arcTable, i + 1), f - float(i));
+}
+
+void main()
+{
+    // wrap around so the text keeps sliding past the end of the path
+    vec4 frame = FrameAt(mod(GlyphCentre + shift, pathLength));
+    vec2 tangent = normalize(frame.zw);
+    vec2 normal = vec2(-tangent.y, tangent.x);
+
+    // object space position; tessEval.glsl applies the model and view
+    vec2 position = frame.xy + VertexPosition.x * tangent + VertexPosition.y * normal;
+    gl_Position = vec4(position, 0.0, 1.0);
+
+    tcColour = VertexColour;
+}
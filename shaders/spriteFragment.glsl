@@ -0,0 +1,17 @@
+// ==========================================================================
+// Fragment program for instanced sprites
+// ==========================================================================
+#version 410
+
+// texture coordinates and layer received from the vertex stage
+in vec3 TextureCoordinates;
+
+// every sprite image, one per layer (see TextureArray)
+uniform sampler2DArray sprites;
+
+out vec4 FragmentColour;
+
+void main(void)
+{
+    FragmentColour = texture(sprites, TextureCoordinates);
+}
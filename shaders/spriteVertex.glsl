@@ -0,0 +1,34 @@
+// ==========================================================================
+// Vertex program for instanced sprites
+//
+// Every attribute is per instance (see SpriteBatch); the four corners of
+// each sprite come from gl_VertexID.
+// ==========================================================================
+#version 410
+
+layout(location = 0) in vec2 SpriteCentre;
+layout(location = 1) in vec2 SpriteSize;
+layout(location = 2) in vec4 SpriteRect;    // texture coordinates u0, v0, u1, v1
+layout(location = 3) in float SpriteLayer;  // layer of the texture array
+
+// view transform shared by every program, written by the Camera class
+layout(std140) uniform Camera
+{
+    mat4 view;
+};
+
+// placement of the sprites as a whole
+uniform mat4 model;
+
+// texture coordinates and layer, interpolated for the fragment stage
+out vec3 TextureCoordinates;
+
+void main()
+{
+    // a triangle strip through the corners (0,0), (1,0), (0,1), (1,1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    TextureCoordinates = vec3(mix(SpriteRect.xy, SpriteRect.zw, corner), SpriteLayer);
+
+    vec2 position = SpriteCentre + (corner - 0.5) * SpriteSize;
+    gl_Position = view * model * vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,29 @@
+// ==========================================================================
+// Fragment program for thick strokes from strokeGeometry.glsl
+//
+// Coverage is computed analytically from the pixel's distance to the stroke
+// edge, giving a one pixel anti-aliased ramp. Draw with alpha blending on.
+// ==========================================================================
+#version 410
+
+// interpolated colour and offset from the curve, in pixels
+in vec3 StrokeColour;
+noperspective in vec3 StrokeCoord;
+
+uniform float halfWidth;
+
+// first output is mapped to the framebuffer's colour index by default
+out vec4 FragmentColour;
+
+void main(void)
+{
+    // round pieces measure euclidean distance, everything else the larger
+    // of the along and across offsets (which is just |across| on the body)
+    float square = max(abs(StrokeCoord.x), abs(StrokeCoord.y));
+    float offset = mix(square, length(StrokeCoord.xy), StrokeCoord.z);
+
+    float coverage = clamp(halfWidth + 0.5 - offset, 0.0, 1.0);
+    if (coverage <= 0.0) discard;
+
+    FragmentColour = vec4(StrokeColour, coverage);
+}
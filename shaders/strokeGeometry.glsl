@@ -0,0 +1,259 @@
+#version 410
+/**
+* Stroke Geometry Shader
+*	Expands the isolines from tessEval.glsl into thick strokes
+*	Receives one line segment of a tessellated patch at a time, with the
+*	curve's tangent at both ends, and emits triangle strips in pixel space:
+*	a body quad, plus a join or cap where the segment ends its patch
+*/
+
+layout(lines) in;
+layout(triangle_strip, max_vertices = 12) out;
+
+//From tessEval.glsl
+in vec3 Colour[];
+in vec2 Tangent[];		//Curve derivative, in clip space
+in float Parameter[];		//Position along the patch, exactly 0 and 1 at its ends
+flat in int Patch[];		//Patch number within the current draw
+
+//To strokeFragment.glsl; StrokeCoord is the offset from the curve in pixels,
+//measured along (x) and across (y) the curve, and z picks round (1) or square (0) ends
+out vec3 StrokeColour;
+noperspective out vec3 StrokeCoord;
+
+layout(std140) uniform Camera
+{
+	mat4 view;
+};
+uniform mat4 model;
+
+//The vertex buffer being drawn, read as 4 texels per patch, so joins can look at neighbouring patches.
+//Indexed draws read the 4 vertices of a patch through its element buffer instead.
+uniform samplerBuffer patches;
+uniform usamplerBuffer patchIndices;
+uniform bool indexedPatches;
+//Per vertex motion of animated scenes (see vertex.glsl), so neighbours move with the curve
+uniform samplerBuffer animations;
+uniform bool animatedPatches;
+uniform float time;
+uniform int patchFirst;		//Patch of the buffer the draw starts at
+uniform int patchCount;		//Patches in the draw
+
+uniform vec2 viewport;		//Framebuffer size in pixels
+uniform float halfWidth;	//Half the stroke width in pixels
+uniform int joinStyle;		//0 miter, 1 round, 2 bevel (see Stroke.h)
+uniform int capStyle;		//0 butt, 1 round, 2 square
+uniform float miterLimit;	//Longest miter, as a multiple of the stroke width
+
+//Pixels of coverage ramp drawn outside the stroke for anti-aliasing
+const float FRINGE = 1.0;
+
+//Patch ends closer than this (in object units) are treated as connected
+const float WELD = 1e-5;
+
+//Longest contour searched when looking for the patch that closes a loop
+const int MAX_CONTOUR = 256;
+
+// --------------------------------------------------------------------------
+// Neighbouring patches, with the tessEval.glsl rule that a fourth vertex of
+// exactly (0,0) marks a quadratic
+
+vec2 ControlPoint(int id, int i)
+{
+	int vertex = 4*(patchFirst + id) + i;
+	if (indexedPatches) vertex = int(texelFetch(patchIndices, vertex).r);
+	vec2 point = texelFetch(patches, vertex).xy;
+	if (animatedPatches) {
+		vec4 animation = texelFetch(animations, vertex);
+		point += animation.xy * sin(6.28318531 * animation.w * time + animation.z);
+	}
+	return point;
+}
+
+bool IsQuadratic(int id)
+{
+	return ControlPoint(id, 3) == vec2(0.0);
+}
+
+vec2 StartPoint(int id)
+{
+	return ControlPoint(id, 0);
+}
+
+vec2 EndPoint(int id)
+{
+	return IsQuadratic(id) ? ControlPoint(id, 2) : ControlPoint(id, 3);
+}
+
+bool Welded(vec2 a, vec2 b)
+{
+	return all(lessThan(abs(a - b), vec2(WELD)));
+}
+
+//Direction the curve leaves its first point, skipping coincident control points
+vec2 StartTangent(int id)
+{
+	vec2 p0 = ControlPoint(id, 0);
+	vec2 d = ControlPoint(id, 1) - p0;
+	if (dot(d, d) < 1e-12) d = ControlPoint(id, 2) - p0;
+	if (dot(d, d) < 1e-12 && !IsQuadratic(id)) d = ControlPoint(id, 3) - p0;
+	return d;
+}
+
+//The patch that continues where this one ends, or -1 at an open end.
+//A contour that closes on itself continues into its first patch.
+int Successor(int id)
+{
+	vec2 end = EndPoint(id);
+	if (id + 1 < patchCount && Welded(StartPoint(id + 1), end)) return id + 1;
+
+	int first = id;
+	for (int i = 0; i < MAX_CONTOUR && first > 0 && Welded(EndPoint(first - 1), StartPoint(first)); ++i)
+		--first;
+	return Welded(StartPoint(first), end) ? first : -1;
+}
+
+//True if some patch ends where this one starts, in which case that patch draws the join
+bool HasPredecessor(int id)
+{
+	vec2 start = StartPoint(id);
+	if (id > 0 && Welded(EndPoint(id - 1), start)) return true;
+
+	int last = id;
+	for (int i = 0; i < MAX_CONTOUR && last + 1 < patchCount && Welded(StartPoint(last + 1), EndPoint(last)); ++i)
+		++last;
+	return Welded(EndPoint(last), start);
+}
+
+// --------------------------------------------------------------------------
+// Pixel space helpers
+
+vec2 ToPixels(vec4 clip)
+{
+	return (clip.xy / clip.w * 0.5 + 0.5) * viewport;
+}
+
+//Unit direction in pixels of a clip space direction, or fallback if it vanishes
+vec2 PixelDirection(vec2 clipDirection, vec2 fallback)
+{
+	vec2 d = clipDirection * viewport;
+	if (dot(d, d) < 1e-12) d = fallback;
+	return dot(d, d) > 0.0 ? normalize(d) : vec2(1.0, 0.0);
+}
+
+vec2 Perpendicular(vec2 d)
+{
+	return vec2(-d.y, d.x);
+}
+
+void Emit(vec2 pixel, vec3 coord, vec3 colour)
+{
+	gl_Position = vec4(pixel / viewport * 2.0 - 1.0, 0.0, 1.0);
+	StrokeCoord = coord;
+	StrokeColour = colour;
+	EmitVertex();
+}
+
+// --------------------------------------------------------------------------
+// Joins and caps
+
+//Square around p whose round metric cuts out a disc; used for round joins and caps
+void RoundPiece(vec2 p, vec3 colour)
+{
+	float r = halfWidth + FRINGE;
+	Emit(p + vec2(-r, -r), vec3(-r, -r, 1.0), colour);
+	Emit(p + vec2( r, -r), vec3( r, -r, 1.0), colour);
+	Emit(p + vec2(-r,  r), vec3(-r,  r, 1.0), colour);
+	Emit(p + vec2( r,  r), vec3( r,  r, 1.0), colour);
+	EndPrimitive();
+}
+
+//Cap at p, where direction points away from the stroke
+void Cap(vec2 p, vec2 direction, vec3 colour)
+{
+	float r = halfWidth + FRINGE;
+	vec2 n = Perpendicular(direction) * r;
+	vec2 e = direction * r;
+
+	if (capStyle == 1) {
+		RoundPiece(p, colour);
+	} else if (capStyle == 2) {
+		Emit(p + n, vec3(0.0, r, 0.0), colour);
+		Emit(p - n, vec3(0.0, -r, 0.0), colour);
+		Emit(p + n + e, vec3(r, r, 0.0), colour);
+		Emit(p - n + e, vec3(r, -r, 0.0), colour);
+		EndPrimitive();
+	}
+}
+
+//Fills the wedge on the outside of the turn from tangent t0 to t1 at p
+void Join(vec2 p, vec2 t0, vec2 t1, vec3 colour)
+{
+	if (dot(t0, t1) > 0.99999) return;
+	if (joinStyle == 1) {
+		RoundPiece(p, colour);
+		return;
+	}
+
+	//outside of a left turn is on the right
+	float side = (t0.x*t1.y - t0.y*t1.x) > 0.0 ? -1.0 : 1.0;
+	vec2 o0 = Perpendicular(t0) * side;
+	vec2 o1 = Perpendicular(t1) * side;
+	float r = halfWidth + FRINGE;
+
+	//the miter's outer edges continue the stroke edges, so the same
+	//across-the-curve coordinate gives them an exact anti-aliased edge
+	if (joinStyle == 0 && dot(o0, o1) > -0.99999) {
+		vec2 m = normalize(o0 + o1);
+		float cosHalf = dot(m, o0);
+		if (cosHalf * miterLimit >= 1.0) {
+			Emit(p + o0*r, vec3(0.0, r, 0.0), colour);
+			Emit(p, vec3(0.0), colour);
+			Emit(p + m*(r/cosHalf), vec3(0.0, r, 0.0), colour);
+			Emit(p + o1*r, vec3(0.0, r, 0.0), colour);
+			EndPrimitive();
+			return;
+		}
+	}
+
+	//bevel, also used past the miter limit
+	Emit(p + o0*r, vec3(0.0, r, 0.0), colour);
+	Emit(p, vec3(0.0), colour);
+	Emit(p + o1*r, vec3(0.0, r, 0.0), colour);
+	EndPrimitive();
+}
+
+// --------------------------------------------------------------------------
+
+void main()
+{
+	vec2 a = ToPixels(gl_in[0].gl_Position);
+	vec2 b = ToPixels(gl_in[1].gl_Position);
+	vec2 ta = PixelDirection(Tangent[0], b - a);
+	vec2 tb = PixelDirection(Tangent[1], b - a);
+
+	//Body: offsetting along the curve's own normals keeps neighbouring
+	//segments of a patch sharing edges, so no joins are needed inside a patch
+	float r = halfWidth + FRINGE;
+	vec2 na = Perpendicular(ta) * r;
+	vec2 nb = Perpendicular(tb) * r;
+	Emit(a + na, vec3(0.0, r, 0.0), Colour[0]);
+	Emit(a - na, vec3(0.0, -r, 0.0), Colour[0]);
+	Emit(b + nb, vec3(0.0, r, 0.0), Colour[1]);
+	Emit(b - nb, vec3(0.0, -r, 0.0), Colour[1]);
+	EndPrimitive();
+
+	int id = Patch[0];
+	if (Parameter[0] <= 0.0 && !HasPredecessor(id))
+		Cap(a, -ta, Colour[0]);
+
+	if (Parameter[1] >= 1.0) {
+		int next = Successor(id);
+		if (next < 0) {
+			Cap(b, tb, Colour[1]);
+		} else {
+			vec2 t = (view * model * vec4(StartTangent(next), 0.0, 0.0)).xy;
+			Join(b, tb, PixelDirection(t, tb), Colour[1]);
+		}
+	}
+}
@@ -16,8 +16,23 @@ in vec3 teColour[];
 //Will be interpolated as if sent from vertex shader
 out vec3 Colour;
 
+//Only read when strokeGeometry.glsl follows this stage: the curve's derivative
+//in clip space, the parameter u, and which patch of the draw this is
+out vec2 Tangent;
+out float Parameter;
+flat out int Patch;
+
 uniform int n;
 
+//View transform shared by every program, written by the Camera class
+layout(std140) uniform Camera
+{
+	mat4 view;
+};
+
+//Placement of the object being drawn
+uniform mat4 model;
+
 void main()
 {
 	//gl_TessCoord.x will parameterize the segments of the line from 0 to 1
@@ -33,8 +48,10 @@ void main()
                 vec2 p2 = gl_in[2].gl_Position.xy;
 
 	        vec2 position = (1-u)*(1-u)*p0 + 2*u*(1-u)*p1 + u*u*p2;
+                vec2 derivative = 2*(1-u)*(p1-p0) + 2*u*(p2-p1);
                 
-                gl_Position = vec4(position, 0, 1);
+                gl_Position = view * model * vec4(position, 0, 1);
+                Tangent = (view * model * vec4(derivative, 0, 0)).xy;
 	        Colour = (1-u)*startColour + u*endColour;
         
         }else{
@@ -44,12 +61,15 @@ void main()
                 vec2 p3 = gl_in[3].gl_Position.xy;
 
 	        vec2 position = (1-u)*(1-u)*(1-u)*p0 + 3*u*(1-u)*(1-u)*p1 + 3*u*u*(1-u)*p2 + u*u*u*p3; 
+                vec2 derivative = 3*(1-u)*(1-u)*(p1-p0) + 6*u*(1-u)*(p2-p1) + 3*u*u*(p3-p2);
         
-                gl_Position = vec4(position, 0, 1);
+                gl_Position = view * model * vec4(position, 0, 1);
+                Tangent = (view * model * vec4(derivative, 0, 0)).xy;
 	        Colour = (1-u)*startColour + u*endColour;       
                 
         }
 
-	
+        Parameter = u;
+        Patch = gl_PrimitiveID;
 
 }
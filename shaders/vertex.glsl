@@ -11,13 +11,25 @@
 layout(location = 0) in vec2 VertexPosition;
 layout(location = 1) in vec3 VertexColour;
 
+// amplitude (xy), phase and frequency of the point's motion, see SceneFile.h;
+// unanimated geometry leaves the attribute disabled, so the amplitude is 0
+layout(location = 2) in vec4 VertexAnimation;
+
+// seconds on the animation clock, the only per frame input
+uniform float time;
+
 // output to be interpolated between vertices and passed to the fragment stage
 out vec3 tcColour;
 
 void main()
 {
-    // assign vertex position without modification
-    gl_Position = vec4(VertexPosition, 0.0, 1.0);
+    // displace the control point, but otherwise leave it in object space; the
+    // patch is evaluated and transformed in tessEval.glsl, which relies on the
+    // (0,0) fourth control point to recognise quadratic segments, so that
+    // marker is never animated
+    float angle = 6.28318531 * VertexAnimation.w * time + VertexAnimation.z;
+    vec2 position = VertexPosition + VertexAnimation.xy * sin(angle);
+    gl_Position = vec4(position, 0.0, 1.0);
 
     // assign output colour to be interpolated
     tcColour = VertexColour;
@@ -11,13 +11,29 @@
 layout(location = 0) in vec2 VertexPosition;
 layout(location = 1) in vec3 VertexColour;
 
+// the control point's motion, as in vertex.glsl, so the polygon and points
+// stay on the animated curve
+layout(location = 2) in vec4 VertexAnimation;
+uniform float time;
+
+// view transform shared by every program, written by the Camera class
+layout(std140) uniform Camera
+{
+    mat4 view;
+};
+
+// placement of the object being drawn
+uniform mat4 model;
+
 // output to be interpolated between vertices and passed to the fragment stage
 out vec3 Colour;
 
 void main()
 {
-    // assign vertex position without modification
-    gl_Position = vec4(VertexPosition, 0.0, 1.0);
+    // move the point, place it in the world, then in the camera's view
+    float angle = 6.28318531 * VertexAnimation.w * time + VertexAnimation.z;
+    vec2 position = VertexPosition + VertexAnimation.xy * sin(angle);
+    gl_Position = view * model * vec4(position, 0.0, 1.0);
 
     // assign output colour to be interpolated
     Colour = VertexColour;